@@ -12,12 +12,19 @@ STARRY_MONO_64 = 1
 STARRY_MONO_128 = 2
 STARRY_SPECTRAL_64 = 4
 STARRY_SPECTRAL_128 = 8
+STARRY_MONO_32 = 16
 
 # Custom compiler flags
 macros = dict(STARRY_NMULTI=32,
               STARRY_IJ_MAX_ITER=200,
               STARRY_ELLIP_MAX_ITER=200,
-              STARRY_KEPLER_MAX_ITER=100)
+              STARRY_KEPLER_MAX_ITER=100,
+              STARRY_LD_BLOCK_SIZE=64,
+              STARRY_APPROX_ORDER=8,
+              STARRY_LD_TABLE_INIT_NODES=16,
+              STARRY_LD_TABLE_MAX_DEPTH=30,
+              STARRY_MIN_RESTARTS=1,
+              STARRY_PROFILE=0)
 
 # Override with user values
 for key, value in macros.items():
@@ -27,13 +34,17 @@ for key, value in macros.items():
 optimize = int(os.getenv('STARRY_O', 2))
 assert optimize in [0, 1, 2, 3], "Invalid optimization flag."
 
+# Compile for the host CPU? This enables AVX2/AVX-512 code
+# generation in the batched (vectorized) kernels
+native = int(os.getenv('STARRY_NATIVE', 0))
+
 # Debug mode?
 debug = bool(int(os.getenv('STARRY_DEBUG', 0)))
 if debug:
     optimize = 0
 
-# Module bitsum (1 + 2 + 4 + 8 = 15)
-bitsum = int(os.getenv('STARRY_BITSUM', 15))
+# Module bitsum (1 + 2 + 4 + 8 + 16 = 31)
+bitsum = int(os.getenv('STARRY_BITSUM', 31))
 
 class get_pybind_include(object):
     """
@@ -86,6 +97,8 @@ if (bitsum & STARRY_SPECTRAL_64):
     ext_modules.append(get_ext('starry._starry_spectral_64', 'STARRY_SPECTRAL_64'))
 if (bitsum & STARRY_SPECTRAL_128):
     ext_modules.append(get_ext('starry._starry_spectral_128', 'STARRY_SPECTRAL_128'))
+if (bitsum & STARRY_MONO_32):
+    ext_modules.append(get_ext('starry._starry_mono_32', 'STARRY_MONO_32'))
 
 # As of Python 3.6, CCompiler has a `has_flag` method.
 # cf http://bugs.python.org/issue26689
@@ -139,6 +152,12 @@ class BuildExt(build_ext):
         for ext in self.extensions:
             ext.extra_compile_args = list(opts + ext.extra_compile_args)
             ext.extra_compile_args += ["-O%d" % optimize]
+            if ct == 'unix':
+                # Needed by the threaded ensemble evaluation
+                ext.extra_compile_args += ["-pthread"]
+                ext.extra_link_args += ["-pthread"]
+                if native and sys.platform != "darwin":
+                    ext.extra_compile_args += ["-march=native"]
             ext.extra_compile_args += ["-Wextra",
                                        "-Wpedantic",
                                        "-Wno-unused-parameter",
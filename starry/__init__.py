@@ -1,13 +1,20 @@
 # -*- coding: utf-8 -*-
 from ._starry_mono_64 import __version__
 from . import _starry_mono_64, _starry_mono_128, \
-              _starry_spectral_64, _starry_spectral_128
+              _starry_spectral_64, _starry_spectral_128, \
+              _starry_mono_32
 from . import kepler
 
 
 # Class factory
-def Map(lmax=2, nwav=1, multi=False):
-    if (nwav == 1) and (not multi):
+def Map(lmax=2, nwav=1, multi=False, single=False):
+    if single:
+        if (nwav == 1) and (not multi):
+            return _starry_mono_32.Map(lmax, nwav)
+        else:
+            raise ValueError("Single precision is only available for " +
+                             "monochromatic, non-multiprecision maps.")
+    elif (nwav == 1) and (not multi):
         return _starry_mono_64.Map(lmax, nwav)
     elif (nwav == 1) and (multi):
         return _starry_mono_128.Map(lmax, nwav)
@@ -21,3 +28,48 @@ def Map(lmax=2, nwav=1, multi=False):
 
 # Hack the docstring
 Map.__doc__ = _starry_mono_64.Map.__doc__
+
+
+def profile(reset=False):
+    """
+    Return the hot-path instrumentation counters, summed over all
+    compiled modules. See :py:func:`_starry_mono_64.profile`.
+    Each cache entry also gets a :py:obj:`hit_rate` and each series a
+    :py:obj:`mean` number of terms per evaluation (:py:obj:`nan` if
+    they were never used).
+
+    Args:
+        reset (bool): Reset the counters after reading them? \
+            Default :py:obj:`False`.
+    """
+    modules = [_starry_mono_64, _starry_mono_128,
+               _starry_spectral_64, _starry_spectral_128,
+               _starry_mono_32]
+    res = None
+    for module in modules:
+        prof = module.profile(reset)
+        if res is None:
+            res = prof
+            continue
+        for name, stage in prof["stages"].items():
+            for key in ["calls", "ticks"]:
+                res["stages"][name][key] += stage[key]
+        for name, cache in prof["caches"].items():
+            for key in ["hits", "misses"]:
+                res["caches"][name][key] += cache[key]
+        res["depth"] = [a + b for a, b in zip(res["depth"], prof["depth"])]
+        for name, count in prof["branches"].items():
+            res["branches"][name] += count
+        for name, series in prof["series"].items():
+            for key in ["calls", "terms"]:
+                res["series"][name][key] += series[key]
+            res["series"][name]["histogram"] = \
+                [a + b for a, b in zip(res["series"][name]["histogram"],
+                                       series["histogram"])]
+    for cache in res["caches"].values():
+        total = cache["hits"] + cache["misses"]
+        cache["hit_rate"] = cache["hits"] / float(total) if total else float("nan")
+    for series in res["series"].values():
+        series["mean"] = series["terms"] / float(series["calls"]) \
+            if series["calls"] else float("nan")
+    return res
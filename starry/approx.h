@@ -0,0 +1,329 @@
+/**
+Small-occultor expansion of the occulted flux.
+
+For an occultor of radius `ro` centered at `(xo, yo)` well inside the
+limb of the occulted body, the flux blocked by the occultor is the
+integral of the surface intensity over a small disk, which we expand
+in powers of `ro` about the intensity at the center of the occultor.
+
+For general maps, we expand each term of the polynomial basis about
+`(xo, yo)` and integrate it over the disk term by term. The `x^a y^b`
+factors are integrated exactly; the `z` factor is expanded as a Taylor
+series of order `STARRY_APPROX_ORDER` in the offsets from the center
+of the occultor. For radially symmetric (limb-darkened) maps we
+instead use the mean value expansion of the disk integral,
+
+    int f dA = pi ro^2 sum_k (ro^2 / 4)^k lap^k f / (k! (k + 1)!),
+
+where `lap` is the Laplacian, truncated at the same order.
+
+In both cases the error scales as a high power of `ro / (1 - b^2)`.
+The two highest order terms are tracked separately and serve as an
+estimate of the error.
+
+*/
+
+#ifndef _STARRY_APPROX_H_
+#define _STARRY_APPROX_H_
+
+#include <cmath>
+#include <Eigen/Core>
+#include "utils.h"
+
+namespace starry {
+namespace approx {
+
+    using namespace utils;
+
+    /**
+    Integrals of the polynomial and limb darkening
+    bases over a small occultor.
+
+    */
+    template <class T>
+    class SmallPlanet {
+
+        protected:
+
+            const int lmax;                                                     /**< The highest degree of the map */
+            const int N;                                                        /**< The number of map coefficients */
+            static constexpr int K = STARRY_APPROX_ORDER;                       /**< Order of the expansion */
+            static constexpr int NQ = (K / 2 + 1) * (K / 2 + 2) / 2;            /**< Number of terms in the mean value expansion */
+            const int M;                                                        /**< Highest order of the disk moments */
+            Matrix<T> mom0;                                                     /**< Moments of the unit disk */
+            Matrix<T> mom;                                                      /**< Moments of the occultor disk */
+            Matrix<T> binom;                                                    /**< Binomial coefficients */
+            Matrix<T> Z;                                                        /**< Taylor coefficients of `z` about the occultor center */
+            Matrix<T> Mz;                                                       /**< Moments of `z` over the occultor disk */
+            Matrix<T> Mz_err;                                                   /**< Contribution of the two highest orders to `Mz` */
+            Vector<T> xpow;                                                     /**< Powers of `xo` */
+            Vector<T> ypow;                                                     /**< Powers of `yo` */
+            Vector<T> rpow;                                                     /**< Powers of `ro` */
+            Vector<T> recip;                                                    /**< Reciprocals of the integers */
+            Eigen::Matrix<T, Eigen::Dynamic, NQ, Eigen::RowMajor> lapcoeff;    /**< Coefficients of the mean value expansion of `z^n` */
+            Vector<T> qpow;                                                     /**< Powers of `ro^2 / z^2` */
+            Vector<T> spow;                                                     /**< Powers of `1 / z^2` */
+            Eigen::Matrix<T, NQ, 1> qspow;                                      /**< Products of the powers of `ro^2 / z^2` and `1 / z^2` */
+            Vector<T> Dz;                                                       /**< Integral of `z^n` over the occultor */
+            Vector<T> Dz_err;                                                   /**< Estimate of the error in `Dz` */
+
+        public:
+
+            VectorT<T> D;                                                       /**< Integral of each polynomial basis term over the occultor */
+            VectorT<T> D_err;                                                   /**< Estimate of the error in `D` */
+            VectorT<T> S;                                                       /**< Visible flux in each term of the limb darkening basis */
+            VectorT<T> S_err;                                                   /**< Estimate of the error in `S` */
+
+            //! Constructor
+            explicit SmallPlanet(int lmax) :
+                    lmax(lmax),
+                    N((lmax + 1) * (lmax + 1)),
+                    M(lmax + STARRY_APPROX_ORDER),
+                    mom0(M + 1, M + 1),
+                    mom(M + 1, M + 1),
+                    binom(lmax + 1, lmax + 1),
+                    Z(K + 1, K + 1),
+                    Mz(lmax + 1, lmax + 1),
+                    Mz_err(lmax + 1, lmax + 1),
+                    xpow(lmax + 1),
+                    ypow(lmax + 1),
+                    rpow(M + 3),
+                    recip(K + 1),
+                    lapcoeff(lmax + 1, NQ),
+                    qpow(K / 2 + 1),
+                    spow(K / 2 + 1),
+                    Dz(lmax + 1),
+                    Dz_err(lmax + 1),
+                    D(N),
+                    D_err(N),
+                    S(lmax + 1),
+                    S_err(lmax + 1) {
+
+                // Moments of the unit disk: the integral of `x^i y^j`
+                // is nonzero only if both `i` and `j` are even, in which
+                // case it is `Gamma((i + 1) / 2) Gamma((j + 1) / 2) /
+                // Gamma((i + j) / 2 + 2)`
+                mom0.setZero();
+                mom0(0, 0) = pi<T>();
+                for (int i = 0; i <= M; i += 2) {
+                    if (i > 0)
+                        mom0(i, 0) = mom0(i - 2, 0) * (i - 1) / (i + 2);
+                    for (int j = 2; i + j <= M; j += 2)
+                        mom0(i, j) = mom0(i, j - 2) * (j - 1) / (i + j + 2);
+                }
+                mom.setZero();
+                for (int i = 1; i <= K; ++i)
+                    recip(i) = T(1) / i;
+
+                // Binomial coefficients
+                binom.setZero();
+                for (int a = 0; a <= lmax; ++a) {
+                    binom(a, 0) = 1;
+                    for (int i = 1; i <= a; ++i)
+                        binom(a, i) = binom(a - 1, i - 1) +
+                                      (i < a ? binom(a - 1, i) : T(0));
+                }
+
+                // Repeated Laplacians of `z^n`. For a radial function of
+                // `t = z^2 = 1 - x^2 - y^2`, the Laplacian takes `t^beta`
+                // to `4 beta (beta - 1) t^(beta - 2) - 4 beta^2 t^(beta - 1)`,
+                // so `lap^k z^n` is a sum of `z^n t^-(k + m)` for `m <= k`.
+                // We store the coefficients of these sums, multiplied by
+                // the factors `pi / (4^k k! (k + 1)!)` of the mean value
+                // expansion, in `lapcoeff(n, k (k + 1) / 2 + m)`.
+                Matrix<T> c(K / 2 + 1, K + 1);
+                for (int n = 0; n <= lmax; ++n) {
+                    c.setZero();
+                    c(0, 0) = 1;
+                    for (int k = 1; k <= K / 2; ++k) {
+                        for (int m = k - 1; m <= 2 * (k - 1); ++m) {
+                            T beta = T(n) / 2 - m;
+                            c(k, m + 2) += 4 * beta * (beta - 1) * c(k - 1, m);
+                            c(k, m + 1) -= 4 * beta * beta * c(k - 1, m);
+                        }
+                    }
+                    T fac = pi<T>();
+                    int idx = 0;
+                    for (int k = 0; k <= K / 2; ++k) {
+                        for (int m = 0; m <= k; ++m)
+                            lapcoeff(n, idx++) = fac * c(k, k + m);
+                        fac /= 4 * (k + 1) * (k + 2);
+                    }
+                }
+
+            }
+
+            inline void compute(const T& xo, const T& yo, const T& ro);
+            inline void computeLD(const T& b, const T& ro);
+
+    };
+
+    /**
+    Compute the integrals `D` of the polynomial basis terms
+    over the occultor disk, and the error estimate `D_err`.
+    The occultor must lie entirely within the disk of the
+    occulted body, `sqrt(xo^2 + yo^2) < 1 - ro`.
+
+    */
+    template <class T>
+    inline void SmallPlanet<T>::compute(const T& xo, const T& yo,
+                                        const T& ro) {
+
+        // Moments of the occultor disk
+        rpow(0) = 1;
+        for (int d = 1; d <= M + 2; ++d)
+            rpow(d) = rpow(d - 1) * ro;
+        for (int i = 0; i <= M; i += 2) {
+            for (int j = 0; i + j <= M; j += 2)
+                mom(i, j) = mom0(i, j) * rpow(i + j + 2);
+        }
+
+        // Taylor coefficients of `z = sqrt(w)` in the offsets `(u, v)`
+        // from the occultor center, where `w = z0^2 - 2 xo u - 2 yo v
+        // - u^2 - v^2`. Since `w` is quadratic, matching terms in
+        // `2 w dz/du = z dw/du` (and likewise for `v`) gives a short
+        // recurrence for the coefficients.
+        T z0sq = 1 - xo * xo - yo * yo;
+        T fac = 0.5 / z0sq;
+        T wx = -2 * xo;
+        T wy = -2 * yo;
+        Z(0, 0) = sqrt(z0sq);
+        for (int j = 0; j < K; ++j) {
+            T res = wy * (1 - 2 * j) * Z(0, j);
+            if (j > 0)
+                res -= 2 * (2 - j) * Z(0, j - 1);
+            Z(0, j + 1) = res * fac * recip(j + 1);
+        }
+        for (int i = 0; i < K; ++i) {
+            for (int j = 0; i + j < K; ++j) {
+                T res = wx * (1 - 2 * i) * Z(i, j);
+                if (i > 0)
+                    res -= 2 * (2 - i) * Z(i - 1, j);
+                if (j > 0)
+                    res -= 2 * (i + 1) * wy * Z(i + 1, j - 1);
+                if (j > 1)
+                    res += 2 * (i + 1) * Z(i + 1, j - 2);
+                Z(i + 1, j) = res * fac * recip(i + 1);
+            }
+        }
+
+        // Moments of `u^i v^j z` over the occultor disk. Only the
+        // terms with `i + k` and `j + l` both even contribute.
+        for (int i = 0; i < lmax; ++i) {
+            for (int j = 0; i + j < lmax; ++j) {
+                T res = 0, res_err = 0;
+                for (int k = i % 2; k <= K; k += 2) {
+                    int l = j % 2;
+                    for (; k + l < K - 1; l += 2)
+                        res += Z(k, l) * mom(i + k, j + l);
+                    for (; k + l <= K; l += 2)
+                        res_err += Z(k, l) * mom(i + k, j + l);
+                }
+                Mz(i, j) = res + res_err;
+                Mz_err(i, j) = res_err;
+            }
+        }
+
+        // Powers of the occultor position
+        xpow(0) = 1;
+        ypow(0) = 1;
+        for (int i = 1; i <= lmax; ++i) {
+            xpow(i) = xpow(i - 1) * xo;
+            ypow(i) = ypow(i - 1) * yo;
+        }
+
+        // Integrate each basis term `x^a y^b z^c` by expanding
+        // `x^a y^b` binomially about the occultor center
+        int n = 0;
+        for (int l = 0; l < lmax + 1; ++l) {
+            for (int m = -l; m < l + 1; ++m) {
+                int mu = l - m;
+                int nu = l + m;
+                bool c = (nu % 2) != 0;
+                int a = c ? (mu - 1) / 2 : mu / 2;
+                int b = c ? (nu - 1) / 2 : nu / 2;
+                T res = 0, res_err = 0;
+                if (c) {
+                    for (int i = 0; i <= a; ++i) {
+                        T cx = binom(a, i) * xpow(a - i);
+                        for (int j = 0; j <= b; ++j) {
+                            T cxy = cx * binom(b, j) * ypow(b - j);
+                            res += cxy * Mz(i, j);
+                            res_err += cxy * Mz_err(i, j);
+                        }
+                    }
+                } else {
+                    for (int i = 0; i <= a; i += 2) {
+                        T cx = binom(a, i) * xpow(a - i);
+                        for (int j = 0; j <= b; j += 2)
+                            res += cx * binom(b, j) * ypow(b - j) * mom(i, j);
+                    }
+                }
+                D(n) = res;
+                D_err(n) = res_err;
+                ++n;
+            }
+        }
+
+    }
+
+    /**
+    Compute the visible flux `S` in each term of the Agol & Luger (2018)
+    limb darkening basis during an occultation by a small occultor at
+    impact parameter `b`, and the error estimate `S_err`. The basis
+    terms are `1`, `z`, and `(n + 2) z^n - n z^(n - 2)` for `n >= 2`.
+    The occultor must lie entirely within the disk of the occulted
+    body, `b < 1 - ro`.
+
+    */
+    template <class T>
+    inline void SmallPlanet<T>::computeLD(const T& b, const T& ro) {
+
+        // Powers of `1 / z^2` and `ro^2 / z^2` at the occultor center
+        T zsq = 1 - b * b;
+        T z = sqrt(zsq);
+        T rsq = ro * ro;
+        T s = 1 / zsq;
+        T q = rsq * s;
+        qpow(0) = 1;
+        spow(0) = 1;
+        for (int k = 1; k <= K / 2; ++k) {
+            qpow(k) = qpow(k - 1) * q;
+            spow(k) = spow(k - 1) * s;
+        }
+
+        // Integrate `z^n` over the occultor using the mean value
+        // expansion. The last `K + 1` terms are the two highest orders.
+        int idx = 0;
+        for (int k = 0; k <= K / 2; ++k) {
+            for (int m = 0; m <= k; ++m)
+                qspow(idx++) = qpow(k) * spow(m);
+        }
+        T fac = rsq;
+        for (int n = 0; n <= lmax; ++n) {
+            Dz(n) = fac * lapcoeff.row(n).dot(qspow.transpose());
+            Dz_err(n) = fac * lapcoeff.row(n).template tail<K + 1>().dot(
+                                  qspow.template tail<K + 1>().transpose());
+            fac *= z;
+        }
+
+        // Subtract from the flux of the unocculted disk, which
+        // is `pi` for `n = 0`, `2 pi / 3` for `n = 1`, and zero
+        // for all higher order terms
+        S(0) = pi<T>() - Dz(0);
+        S_err(0) = Dz_err(0);
+        if (lmax > 0) {
+            S(1) = 2 * pi<T>() / 3 - Dz(1);
+            S_err(1) = Dz_err(1);
+        }
+        for (int n = 2; n <= lmax; ++n) {
+            S(n) = n * Dz(n - 2) - (n + 2) * Dz(n);
+            S_err(n) = n * Dz_err(n - 2) - (n + 2) * Dz_err(n);
+        }
+
+    }
+
+} // namespace approx
+} // namespace starry
+
+#endif
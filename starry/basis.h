@@ -14,6 +14,7 @@ TODO: Use legendre polynomial recurrence relation for numerical stability
 #include <Eigen/Dense>
 #include <Eigen/SparseLU>
 #include <limits>
+#include <vector>
 #include "errors.h"
 #include "utils.h"
 #include "tables.h"
@@ -400,130 +401,140 @@ namespace basis {
     }
 
     /**
-    Multiply two polynomials
+    A precompiled product table for multiplying a polynomial map of
+    degree `lmax1` by one of degree `lmax2`, truncated at degree `lmax12`.
 
-    */
-    template <typename T>
-    inline void polymul(int lmax1, const T& p1, int lmax2,
-                        const T& p2, int lmax12, T& p1p2) {
-        int n1, n2, l1, m1, l2, m2, l, n;
-        bool odd1;
-        resize(p1p2, (lmax12 + 1) * (lmax12 + 1), p1.cols());
-        p1p2.setZero();
-        Row<T> mult;
-        n1 = 0;
-        for (l1 = 0; l1 < lmax1 + 1; ++l1) {
-            for (m1 = -l1; m1 < l1 + 1; ++m1) {
-                odd1 = (l1 + m1) % 2 == 0 ? false : true;
-                n2 = 0;
-                for (l2 = 0; l2 < lmax2 + 1; ++l2) {
-                    if (l1 + l2 > lmax12) break;
-                    for (m2 = -l2; m2 < l2 + 1; ++m2) {
-                        l = l1 + l2;
-                        n = l * l + l + m1 + m2;
-                        mult = cwiseProduct(getRow(p1, n1), getRow(p2, n2));
-                        if (odd1 && ((l2 + m2) % 2 != 0)) {
-                            setRow(p1p2, n - 4 * l + 2,
-                                   Row<T>(getRow(p1p2, n - 4 * l + 2) + mult));
-                            setRow(p1p2, n - 2,
-                                   Row<T>(getRow(p1p2, n - 2) - mult));
-                            setRow(p1p2, n + 2,
-                                   Row<T>(getRow(p1p2, n + 2) - mult));
-                        } else {
-                            setRow(p1p2, n, Row<T>(getRow(p1p2, n) + mult));
-                        }
-                        ++n2;
-                    }
-                }
-                ++n1;
-            }
-        }
-        return;
-    }
+    Each entry adds the product of term `n1` of the first factor and
+    term `n2` of the second factor to term `n` of the result; the
+    entries that subtract it (which arise because `z^2 = 1 - x^2 - y^2`
+    when both terms are odd in `z`) are stored after the first `npos`
+    entries. Since the product is bilinear, the same table also gives
+    the products of its Jacobians with arbitrary vectors, so the
+    dense `N x N` gradient matrices never need to be formed.
 
-    /**
-    Multiply two polynomials and manually compute the gradients
+    */
+    class PolyMul {
 
-    Since the inputs and outputs are both (in the most general case) matrices,
-    the derivative of `p1p2` with respect to either `p1` or `p2`
-    is a matrix of matrices, which is pretty gnarly. Fortunately,
-    the wavelength bins are all independent of each other, so we can get away
-    with setting each element of the matrix `p1p2` to be a *vector* corresponding
-    to the derivative of the product with respect to the polynomial coefficients
-    *at that particular wavelength*.
+        public:
 
-    For reference, `grad_p1(i)(j, k)` is the derivative of the j^th
-    polynomial coefficient of `p1p2` with respect to the k^th polynomial
-    coefficient of `p1`, both in the i^th wavelength bin.
+            int lmax1;                                                          /**< Degree of the first factor */
+            int lmax2;                                                          /**< Degree of the second factor */
+            int lmax12;                                                         /**< Degree of the product */
+            std::vector<int> n1;                                                /**< Index of the term in the first factor */
+            std::vector<int> n2;                                                /**< Index of the term in the second factor */
+            std::vector<int> n;                                                 /**< Index of the term in the product */
+            size_t npos;                                                        /**< Number of entries with a positive sign */
 
-    Yuck.
+            PolyMul() : lmax1(-1), lmax2(-1), lmax12(-1), npos(0) {}
 
-    */
-    template <typename T>
-    inline void polymul(int lmax1, const T& p1, int lmax2,
-                        const T& p2, int lmax12, T& p1p2,
-                        VectorT<Matrix<Scalar<T>>>& grad_p1,
-                        VectorT<Matrix<Scalar<T>>>& grad_p2) {
-        int n1, n2, l1, m1, l2, m2, l, n, i;
-        bool odd1;
-        int nwav = p1.cols();
-        int N = (lmax12 + 1) * (lmax12 + 1);
-        resize(p1p2, N, nwav);
-        p1p2.setZero();
-        Row<T> mult;
-        n1 = 0;
-
-        // Initialize the gradients
-        grad_p1.resize(nwav);
-        grad_p2.resize(nwav);
-        for (i = 0; i < nwav; ++i){
-            grad_p1(i) = Matrix<Scalar<T>>::Zero(N, N);
-            grad_p2(i) = Matrix<Scalar<T>>::Zero(N, N);
-        }
+            /**
+            Compile the table; this is a no-op if the degrees
+            have not changed since the last call.
 
-        // Note that our loops go up to `lmax12` for both polynomials
-        // so we can compute the gradients for all coefficients, including
-        // those above `y_deg` and `u_deg`.
-        for (l1 = 0; l1 < lmax12 + 1; ++l1) {
-            for (m1 = -l1; m1 < l1 + 1; ++m1) {
-                odd1 = (l1 + m1) % 2 == 0 ? false : true;
-                n2 = 0;
-                for (l2 = 0; l2 < lmax12 + 1; ++l2) {
-                    if (l1 + l2 > lmax12) break;
-                    for (m2 = -l2; m2 < l2 + 1; ++m2) {
-                        l = l1 + l2;
-                        n = l * l + l + m1 + m2;
-                        mult = cwiseProduct(getRow(p1, n1), getRow(p2, n2));
-                        if (odd1 && ((l2 + m2) % 2 != 0)) {
-                            setRow(p1p2, n - 4 * l + 2,
-                                   Row<T>(getRow(p1p2, n - 4 * l + 2) + mult));
-                            setRow(p1p2, n - 2,
-                                   Row<T>(getRow(p1p2, n - 2) - mult));
-                            setRow(p1p2, n + 2,
-                                   Row<T>(getRow(p1p2, n + 2) - mult));
-                            for (i = 0; i < nwav; ++i) {
-                                grad_p1(i)(n - 4 * l + 2, n1) += p2(n2, i);
-                                grad_p2(i)(n - 4 * l + 2, n2) += p1(n1, i);
-                                grad_p1(i)(n - 2, n1) -= p2(n2, i);
-                                grad_p2(i)(n - 2, n2) -= p1(n1, i);
-                                grad_p1(i)(n + 2, n1) -= p2(n2, i);
-                                grad_p2(i)(n + 2, n2) -= p1(n1, i);
-                            }
-                        } else {
-                            setRow(p1p2, n, Row<T>(getRow(p1p2, n) + mult));
-                            for (i = 0; i < nwav; ++i) {
-                                grad_p1(i)(n, n1) += p2(n2, i);
-                                grad_p2(i)(n, n2) += p1(n1, i);
+            */
+            inline void compile(int lmax1_, int lmax2_, int lmax12_) {
+                if ((lmax1_ == lmax1) && (lmax2_ == lmax2) &&
+                    (lmax12_ == lmax12))
+                    return;
+                lmax1 = lmax1_;
+                lmax2 = lmax2_;
+                lmax12 = lmax12_;
+                std::vector<int> neg1, neg2, neg;
+                n1.clear();
+                n2.clear();
+                n.clear();
+                int i1 = 0;
+                for (int l1 = 0; l1 < lmax1 + 1; ++l1) {
+                    for (int m1 = -l1; m1 < l1 + 1; ++m1) {
+                        bool odd1 = (l1 + m1) % 2 != 0;
+                        int i2 = 0;
+                        for (int l2 = 0; l2 < lmax2 + 1; ++l2) {
+                            if (l1 + l2 > lmax12) break;
+                            for (int m2 = -l2; m2 < l2 + 1; ++m2) {
+                                int l = l1 + l2;
+                                int i = l * l + l + m1 + m2;
+                                if (odd1 && ((l2 + m2) % 2 != 0)) {
+                                    n1.push_back(i1);
+                                    n2.push_back(i2);
+                                    n.push_back(i - 4 * l + 2);
+                                    for (int j : {i - 2, i + 2}) {
+                                        neg1.push_back(i1);
+                                        neg2.push_back(i2);
+                                        neg.push_back(j);
+                                    }
+                                } else {
+                                    n1.push_back(i1);
+                                    n2.push_back(i2);
+                                    n.push_back(i);
+                                }
+                                ++i2;
                             }
                         }
-                        ++n2;
+                        ++i1;
                     }
                 }
-                ++n1;
+                npos = n.size();
+                n1.insert(n1.end(), neg1.begin(), neg1.end());
+                n2.insert(n2.end(), neg2.begin(), neg2.end());
+                n.insert(n.end(), neg.begin(), neg.end());
+            }
+
+            /**
+            Accumulate the product of the polynomials `p1` and `p2`
+            into `p1p2`. This is also the product of the Jacobian
+            of `p1p2` with respect to `p1` and the vector `p1`.
+
+            */
+            template <typename S>
+            inline void product(const S* p1, const S* p2, S* p1p2) const {
+                size_t e = 0;
+                for (; e < npos; ++e)
+                    p1p2[n[e]] += p1[n1[e]] * p2[n2[e]];
+                for (; e < n.size(); ++e)
+                    p1p2[n[e]] -= p1[n1[e]] * p2[n2[e]];
+            }
+
+            /**
+            Accumulate `v^T . d(p1p2) / d(p1)` into `result`.
+
+            */
+            template <typename S>
+            inline void gradp1(const S* v, const S* p2, S* result) const {
+                size_t e = 0;
+                for (; e < npos; ++e)
+                    result[n1[e]] += v[n[e]] * p2[n2[e]];
+                for (; e < n.size(); ++e)
+                    result[n1[e]] -= v[n[e]] * p2[n2[e]];
+            }
+
+            /**
+            Accumulate `v^T . d(p1p2) / d(p2)` into `result`.
+
+            */
+            template <typename S>
+            inline void gradp2(const S* v, const S* p1, S* result) const {
+                size_t e = 0;
+                for (; e < npos; ++e)
+                    result[n2[e]] += v[n[e]] * p1[n1[e]];
+                for (; e < n.size(); ++e)
+                    result[n2[e]] -= v[n[e]] * p1[n1[e]];
             }
-        }
-        return;
-    }
+
+            /**
+            Multiply two polynomial maps, one wavelength bin at a time.
+
+            */
+            template <typename T>
+            inline void operator()(const T& p1, const T& p2, T& p1p2) const {
+                resize(p1p2, (lmax12 + 1) * (lmax12 + 1), p1.cols());
+                p1p2.setZero();
+                for (int i = 0; i < p1.cols(); ++i)
+                    product(p1.data() + i * p1.rows(),
+                            p2.data() + i * p2.rows(),
+                            p1p2.data() + i * p1p2.rows());
+            }
+
+    };
 
     /**
     Basis transform matrices
@@ -569,6 +580,14 @@ namespace basis {
                 }
                 */
 
+                compute(norm, tag<T>());
+            }
+
+        protected:
+
+            //! Compute the matrices in the native precision
+            template <class S>
+            inline void compute(const T& norm, tag<S>) {
                 computeA1(lmax, A1, norm);
                 computeA(lmax, A1, A2, A);
                 computeA1Inv(lmax, A1, A1Inv);
@@ -578,6 +597,23 @@ namespace basis {
                 rTU1 = rT * U1;
             }
 
+            //! Compute the matrices in double precision and round them
+            //! to single precision. The factorials in the normalization
+            //! overflow and the sparse inversions lose several digits
+            //! in single precision.
+            inline void compute(const T& norm, tag<float>) {
+                Basis<double> B(lmax, norm);
+                A1 = B.A1.template cast<float>();
+                A1Inv = B.A1Inv.template cast<float>();
+                A2 = B.A2.template cast<float>();
+                A = B.A.template cast<float>();
+                rT = B.rT.template cast<float>();
+                rTA1 = B.rTA1.template cast<float>();
+                rTU1 = B.rTU1.template cast<float>();
+                U1 = B.U1.template cast<float>();
+                U = B.U.template cast<float>();
+            }
+
     };
 
 } // namespace basis
@@ -0,0 +1,365 @@
+/**
+Micro-benchmarks for the hot paths in starry.
+
+Build and run with
+
+    make benchmark
+    ./benchmark [filter] [--min-time=SECONDS] [--repetitions=N] > out.json
+
+Only benchmarks whose name contains `filter` are run. Each benchmark is
+timed over enough iterations to take at least `--min-time` seconds
+(default 0.1), and this is repeated `--repetitions` times (default 3).
+The output is a JSON document on stdout, laid out like the output of
+Google Benchmark, so that two runs can be diffed across versions:
+
+    {
+      "context": {...},
+      "benchmarks": [
+        {"name": "GreensLimbDark/lmax:2/r:0.1/gradient:0",
+         "iterations": ..., "real_time": ..., "mean_time": ...,
+         "time_unit": "ns"},
+        ...
+      ]
+    }
+
+`real_time` is the fastest of the repetitions and `mean_time` their
+average, both in nanoseconds per iteration.
+
+*/
+
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include "utils.h"
+#include "basis.h"
+#include "rotation.h"
+#include "solver.h"
+#include "limbdark.h"
+#include "maps.h"
+#include "kepler.h"
+
+using namespace starry;
+using namespace starry::utils;
+
+namespace benchmark {
+
+    //! Keeps the optimizer from discarding the benchmarked work
+    volatile double sink;
+
+    //! Run-time options
+    struct Options {
+        std::string filter;
+        double min_time = 0.1;
+        int repetitions = 3;
+    };
+
+    //! The result of a single benchmark
+    struct Result {
+        std::string name;
+        long iterations;
+        double real_time;
+        double mean_time;
+    };
+
+    /**
+    Time `func`, which performs one iteration per call, and
+    append the result to `results`.
+
+    */
+    void run(const std::string& name, const std::function<void()>& func,
+             const Options& opts, std::vector<Result>& results) {
+
+        if (name.find(opts.filter) == std::string::npos)
+            return;
+
+        // Warm up and find the number of iterations that takes `min_time`
+        using clock = std::chrono::steady_clock;
+        func();
+        long iterations = 1;
+        double elapsed;
+        while (true) {
+            auto start = clock::now();
+            for (long i = 0; i < iterations; ++i)
+                func();
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            if ((elapsed >= opts.min_time) || (iterations >= (1L << 30)))
+                break;
+            if (elapsed <= 0.01 * opts.min_time)
+                iterations *= 100;
+            else
+                iterations = static_cast<long>(1.2 * iterations *
+                                               opts.min_time / elapsed) + 1;
+        }
+
+        // Time it
+        double best = elapsed / iterations;
+        double total = best;
+        for (int r = 1; r < opts.repetitions; ++r) {
+            auto start = clock::now();
+            for (long i = 0; i < iterations; ++i)
+                func();
+            double t = std::chrono::duration<double>(clock::now() - start).count() /
+                       iterations;
+            best = std::min(best, t);
+            total += t;
+        }
+        results.push_back({name, iterations, 1e9 * best,
+                           1e9 * total / std::max(1, opts.repetitions)});
+        std::cerr << std::left << std::setw(56) << name << " "
+                  << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(1) << 1e9 * best << " ns" << std::endl;
+
+    }
+
+    //! Format a benchmark parameter
+    template <typename T>
+    std::string param(const std::string& key, const T& value) {
+        std::ostringstream os;
+        os << "/" << key << ":" << value;
+        return os.str();
+    }
+
+    //! A map row with the same `value` in all `nwav` wavelength bins
+    template <typename T>
+    Row<T> constantRow(double value, int nwav) {
+        Row<T> row;
+        resize(row, 1, nwav);
+        setOnes(row);
+        return Row<T>(row * value);
+    }
+
+    /* ---------------- */
+    /*    BENCHMARKS    */
+    /* ---------------- */
+
+    //! Occultation solution vector for Ylm maps
+    void greens(const Options& opts, std::vector<Result>& results) {
+        for (int lmax : {2, 5, 10, 20}) {
+            for (double r : {0.01, 0.1, 0.5}) {
+                solver::Greens<double> G(lmax);
+                double b = 0.5;
+                run("Greens" + param("lmax", lmax) + param("r", r), [&]() {
+                    b = (b > 0.9) ? 0.1 : b + 1e-3;
+                    G.compute(b, r);
+                    sink = G.sT(0);
+                }, opts, results);
+            }
+        }
+    }
+
+    //! Occultation solution vector for limb-darkened maps
+    void greensLimbDark(const Options& opts, std::vector<Result>& results) {
+        for (int lmax : {2, 5, 10, 20}) {
+            for (double r : {0.01, 0.1, 0.5}) {
+                for (bool gradient : {false, true}) {
+                    limbdark::GreensLimbDark<double> L(lmax);
+                    double b = 0.5;
+                    run("GreensLimbDark" + param("lmax", lmax) +
+                        param("r", r) + param("gradient", gradient), [&]() {
+                        b = (b > 0.9) ? 0.1 : b + 1e-3;
+                        L.compute(b, r, gradient);
+                        sink = L.S(0);
+                    }, opts, results);
+                }
+            }
+        }
+    }
+
+    //! Rotation of a map and explicit rotation matrices
+    template <typename T>
+    void wigner(int nwav, const Options& opts, std::vector<Result>& results) {
+        for (int lmax : {5, 15, 30}) {
+            int N = (lmax + 1) * (lmax + 1);
+            T y, yout;
+            resize(y, N, nwav);
+            resize(yout, N, nwav);
+            y.setConstant(1.0);
+            UnitVector<double> axis;
+            axis << 1, 2, 3;
+            axis /= axis.norm();
+            rotation::Wigner<T> W(lmax, nwav, y, axis);
+            W.update();
+            double theta = 0;
+            run("Wigner::rotate" + param("lmax", lmax) +
+                param("nwav", nwav), [&]() {
+                theta += 1e-3;
+                W.rotate(cos(theta), sin(theta), yout);
+                sink = yout(0);
+            }, opts, results);
+            run("Wigner::compute" + param("lmax", lmax) +
+                param("nwav", nwav), [&]() {
+                theta += 1e-3;
+                W.compute(cos(theta), sin(theta));
+                sink = W.R[lmax](0, 0);
+            }, opts, results);
+        }
+    }
+
+    //! Limb darkening polynomial multiplication
+    void polymul(const Options& opts, std::vector<Result>& results) {
+        for (auto deg : std::vector<std::pair<int, int>>{{2, 2}, {4, 2},
+                                                         {10, 4}, {15, 5}}) {
+            int lmax = deg.first + deg.second;
+            basis::PolyMul P;
+            P.compile(deg.first, deg.second, lmax);
+            Vector<double> p1 = Vector<double>::Zero((lmax + 1) * (lmax + 1));
+            Vector<double> p2 = Vector<double>::Zero((lmax + 1) * (lmax + 1));
+            Vector<double> p1p2;
+            p1.head((deg.first + 1) * (deg.first + 1)).setOnes();
+            p2.head((deg.second + 1) * (deg.second + 1)).setOnes();
+            run("polymul" + param("y_deg", deg.first) +
+                param("u_deg", deg.second), [&]() {
+                P(p1, p2, p1p2);
+                sink = p1p2(0);
+            }, opts, results);
+        }
+    }
+
+    //! Construction of the change of basis matrices
+    void changeOfBasis(const Options& opts, std::vector<Result>& results) {
+        for (int lmax : {2, 5, 10, 15}) {
+            run("Basis" + param("lmax", lmax), [&]() {
+                basis::Basis<double> B(lmax);
+                sink = B.rT(0);
+            }, opts, results);
+        }
+    }
+
+    //! Kepler solver
+    void eccentricAnomaly(const Options& opts, std::vector<Result>& results) {
+        for (double ecc : {0.0, 0.1, 0.5, 0.7}) {
+            double M = 0;
+            run("EccentricAnomaly" + param("ecc", ecc), [&]() {
+                M += 0.01;
+                if (M > 2 * pi<double>()) M -= 2 * pi<double>();
+                sink = kepler::EccentricAnomaly(M, ecc);
+            }, opts, results);
+        }
+    }
+
+    //! Full light curve of a star and a planet over a transit
+    template <typename T>
+    void keplerSystem(int nwav, const Options& opts, std::vector<Result>& results) {
+        const int NT = 1000;
+        Vector<double> time = Vector<double>::LinSpaced(NT, -0.1, 0.1);
+        for (int lmax : {2, 5, 10}) {
+            for (double r : {0.01, 0.1}) {
+                for (bool gradient : {false, true}) {
+                    kepler::Primary<T> star(2, nwav);
+                    star.setU(1, constantRow<T>(0.4, nwav));
+                    star.setU(2, constantRow<T>(0.26, nwav));
+                    kepler::Secondary<T> planet(lmax, nwav);
+                    planet.setRadius(r);
+                    planet.setSemi(10);
+                    planet.setOrbPer(3);
+                    planet.setInc(89.5);
+                    planet.setRotPer(3);
+                    planet.setLuminosity(constantRow<T>(1e-3, nwav));
+                    for (int l = 1; l < lmax + 1; ++l)
+                        planet.setY(l, 0, constantRow<T>(0.1 / l, nwav));
+                    kepler::System<T> sys(&star, &planet);
+                    run("System::compute" + param("lmax", lmax) +
+                        param("nwav", nwav) + param("r", r) +
+                        param("gradient", gradient) + param("ncad", NT), [&]() {
+                        sys.compute(time, gradient);
+                        sink = sys.getLightcurve()(0);
+                    }, opts, results);
+                }
+            }
+        }
+    }
+
+    //! Escape a string for JSON
+    std::string quote(const std::string& s) {
+        std::ostringstream os;
+        os << "\"";
+        for (char c : s) {
+            if ((c == '"') || (c == '\\')) os << '\\';
+            os << c;
+        }
+        os << "\"";
+        return os.str();
+    }
+
+    //! Print the results as JSON
+    void report(const std::vector<Result>& results, const Options& opts) {
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S",
+                      std::localtime(&now));
+        std::cout << std::setprecision(6) << std::fixed;
+        std::cout << "{\n";
+        std::cout << "  \"context\": {\n";
+        std::cout << "    \"date\": " << quote(date) << ",\n";
+#ifdef VERSION_INFO
+        std::cout << "    \"version\": " << quote(VERSION_INFO) << ",\n";
+#endif
+        std::cout << "    \"compiler\": " << quote(__VERSION__) << ",\n";
+        std::cout << "    \"num_cpus\": "
+                  << std::thread::hardware_concurrency() << ",\n";
+        std::cout << "    \"min_time\": " << opts.min_time << ",\n";
+        std::cout << "    \"repetitions\": " << opts.repetitions << ",\n";
+        std::cout << "    \"STARRY_LD_BLOCK_SIZE\": "
+                  << STARRY_LD_BLOCK_SIZE << ",\n";
+        std::cout << "    \"STARRY_KEPLER_MAX_ITER\": "
+                  << STARRY_KEPLER_MAX_ITER << "\n";
+        std::cout << "  },\n";
+        std::cout << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& res = results[i];
+            std::cout << (i ? ",\n" : "\n");
+            std::cout << "    {\"name\": " << quote(res.name)
+                      << ", \"iterations\": " << res.iterations
+                      << ", \"real_time\": " << res.real_time
+                      << ", \"mean_time\": " << res.mean_time
+                      << ", \"time_unit\": \"ns\"}";
+        }
+        std::cout << "\n  ]\n}" << std::endl;
+    }
+
+} // namespace benchmark
+
+int main(int argc, char* argv[]) {
+
+    using namespace benchmark;
+
+    // Parse the arguments
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.find("--min-time=") == 0)
+            opts.min_time = atof(arg.substr(11).c_str());
+        else if (arg.find("--repetitions=") == 0)
+            opts.repetitions = std::max(1, atoi(arg.substr(14).c_str()));
+        else if ((arg == "-h") || (arg == "--help")) {
+            std::cerr << "Usage: " << argv[0] << " [filter] "
+                      << "[--min-time=SECONDS] [--repetitions=N]"
+                      << std::endl;
+            return 0;
+        } else
+            opts.filter = arg;
+    }
+
+    // Run the benchmarks
+    std::vector<Result> results;
+    greens(opts, results);
+    greensLimbDark(opts, results);
+    wigner<Vector<double>>(1, opts, results);
+    wigner<Matrix<double>>(3, opts, results);
+    polymul(opts, results);
+    changeOfBasis(opts, results);
+    eccentricAnomaly(opts, results);
+    keplerSystem<Vector<double>>(1, opts, results);
+    keplerSystem<Matrix<double>>(3, opts, results);
+
+    // Print the report
+    report(results, opts);
+    return 0;
+
+}
@@ -19,6 +19,52 @@ namespace docstrings {
             with a sleek Python interface.
         )pbdoc";
 
+        const char* profile = R"pbdoc(
+            Return the hot-path instrumentation counters as a dictionary.
+            The counters are only collected if :py:mod:`starry` was
+            compiled with :py:obj:`STARRY_PROFILE=1`; otherwise they are
+            all zero and :py:obj:`enabled` is :py:obj:`False`.
+
+            The dictionary has the following keys:
+
+            - :py:obj:`stages`: the number of :py:obj:`calls` to and the
+              cumulative clock :py:obj:`ticks` spent in the Wigner
+              rotation (:py:obj:`rotate`), limb darkening
+              (:py:obj:`limbDarken`), the occultation solvers
+              (:py:obj:`G`, :py:obj:`G_grad` and :py:obj:`L`), the Kepler
+              solver (:py:obj:`kepler`) and the exposure time integration
+              (:py:obj:`integrate`). Timings are inclusive. A batched
+              :py:obj:`L` evaluation over a light curve counts as a
+              single call, as does a lookup in the interpolation table.
+            - :py:obj:`caches`: the number of :py:obj:`hits` and
+              :py:obj:`misses` of the map cache, of the Wigner
+              rotation, axis and matrix caches and of the limb darkening
+              interpolation table (:py:obj:`ld_table`; a miss is a
+              rebuild of the table).
+            - :py:obj:`depth`: a histogram of the recursion depth at
+              which the exposure time integration terminated.
+            - :py:obj:`branches`: the number of times each numerical
+              branch of the occultation solvers was taken: tabulated
+              values, upward or downward recursion for the :py:obj:`I`
+              and :py:obj:`J` integrals of :py:obj:`G` and :py:obj:`L`,
+              and the regime of the linear limb darkening term
+              (:py:obj:`s2_stable` or the reparametrized
+              :py:obj:`s2_r_gt_one`, :py:obj:`s2_bmr_zero`,
+              :py:obj:`s2_bmr_one` and :py:obj:`s2_bpr_one`, which are
+              controlled by the :py:obj:`STARRY_EPS_*` thresholds).
+            - :py:obj:`series`: for the :py:obj:`I` and :py:obj:`J`
+              series and the elliptic integral loops (:py:obj:`ellip`),
+              the number of evaluations (:py:obj:`calls`), the total
+              number of terms or iterations (:py:obj:`terms`) and a
+              :py:obj:`histogram` of the number of terms per evaluation.
+            - :py:obj:`clock`: the clock used for the timings
+              (:py:obj:`rdtsc` cycles or :py:obj:`ns`).
+
+            Args:
+                reset (bool): Reset the counters after reading them? \
+                    Default :py:obj:`False`.
+        )pbdoc";
+
     }
 
     namespace Map {
@@ -80,16 +126,43 @@ namespace docstrings {
                     defaults to 32-digit (approximately 128-bit) floating \
                     point precision. This can be adjusted by changing the \
                     :py:obj:`STARRY_NMULTI` compiler macro.
-
-            .. automethod:: __call__(theta=0, x=0, y=0)
-            .. automethod:: flux(theta=0, xo=0, yo=0, ro=0, gradient=False)
+                single (bool): Use single (32-bit) precision for fast, \
+                    approximate calculations? Default :py:obj:`False`. \
+                    Only available for monochromatic maps; see below.
+
+            Single precision maps evaluate the intensity and the
+            (limb-darkened) flux in 32-bit floating point, which roughly
+            doubles the number of values per SIMD register in the batched
+            evaluation and limb darkening kernels. The change of basis
+            matrices and the occultation integrals of spherical harmonic
+            maps are computed in double precision. Measured against the
+            64-bit module over occultor radii between 0.01 and 2, the
+            maximum error in the flux relative to the unocculted flux is
+
+            - below :math:`3 \times 10^{-6}` for pure limb-darkened maps
+              up to eighth order,
+            - below :math:`3 \times 10^{-6}` for :py:obj:`lmax` up to 10,
+            - below :math:`5 \times 10^{-5}` for :py:obj:`lmax` up to 15,
+            - about :math:`3 \times 10^{-3}` for :py:obj:`lmax = 20`,
+
+            so single precision is not recommended above :py:obj:`lmax = 15`.
+            Points within about :math:`10^{-7}` of the limb may be
+            classified differently than in double precision.
+            The :py:mod:`kepler` module is not available in single
+            precision, since the orbital solutions require times in
+            double precision.
+
+            .. automethod:: __call__(theta=0, x=0, y=0, out=None)
+            .. automethod:: flux(theta=0, xo=0, yo=0, ro=0, gradient=False, out=None)
             .. automethod:: rotate(theta=0)
+            .. automethod:: render(theta=0, res=300, nthreads=0)
             .. automethod:: show(cmap='plasma', res=300)
             .. automethod:: animate(cmap='plasma', res=150, frames=50, interval=75, gif='')
             .. automethod:: load_image(image, lmax=None)
             .. automethod:: load_healpix(image, lmax=None)
             .. automethod:: add_gaussian(sigma=0.1, amp=1, lat=0, lon=0, lmax=None)
             .. automethod:: reset()
+            .. automethod:: batch()
             .. autoattribute:: lmax
             .. autoattribute:: nwav
             .. autoattribute:: multi
@@ -101,6 +174,9 @@ namespace docstrings {
             .. autoattribute:: r
             .. autoattribute:: s
             .. autoattribute:: axis
+            .. autoattribute:: approx_tol
+            .. autoattribute:: table_tol
+            .. autoattribute:: table_dr
         )pbdoc";
 
         const char* reset = R"pbdoc(
@@ -108,6 +184,21 @@ namespace docstrings {
             which is set to unity.
         )pbdoc";
 
+        const char* batch = R"pbdoc(
+            Return a context manager that defers the update of the map
+            until the end of the block, so that several coefficient
+            assignments trigger a single recomputation:
+
+            .. code-block:: python
+
+                with map.batch():
+                    map[1, 0] = 0.5
+                    map[2, 1] = 0.1
+                    map[1] = 0.4
+
+            The map should not be evaluated inside the block.
+        )pbdoc";
+
         const char* lmax = R"pbdoc(
             The highest spherical harmonic degree of the map. *Read-only.*
         )pbdoc";
@@ -176,16 +267,54 @@ namespace docstrings {
             rotation for the map. Default :math:`\hat{y} = (0, 1, 0)`.
         )pbdoc";
 
+        const char* approx_tol = R"pbdoc(
+            Tolerance of the small-occultor approximation of the flux.
+            If positive, the flux during an occultation by a body lying
+            entirely inside the disk is computed from an expansion in
+            powers of the occultor radius whenever the estimated error
+            is smaller than this value, and exactly otherwise. This can
+            be much faster for small occultors (such as planets) and
+            does not apply to gradients or numerical fluxes. Default 0
+            (always exact).
+        )pbdoc";
+
+        const char* table_tol = R"pbdoc(
+            Tolerance of the interpolation table for limb-darkened maps.
+            If positive, the occultation flux of a purely limb-darkened
+            map is interpolated from a table of the solution vector in
+            the impact parameter, built for the current occultor radius
+            the first time it is needed. This is much faster for long
+            light curves with a fixed occultor radius. The table is
+            rebuilt when the radius changes by more than :py:attr:`table_dr`.
+            It does not apply to gradients. Default 0 (no table).
+        )pbdoc";
+
+        const char* table_dr = R"pbdoc(
+            The largest change in the occultor radius for which the
+            interpolation table is reused, with a first order correction
+            in the radius. Larger values avoid rebuilding the table
+            when the radius changes slightly (e.g., during sampling)
+            but add an error that grows quadratically with the change
+            in radius. Default 0 (rebuild whenever the radius changes).
+        )pbdoc";
+
         const char* evaluate = R"pbdoc(
             Return the specific intensity at a point :py:obj:`(x, y)` on the
             map. Users may optionally provide a rotation state. Note that this
-            does not rotate the base map.
+            does not rotate the base map. Vectors of points are evaluated
+            in blocks that share a rotation angle, so it is fastest to
+            group points with the same :py:obj:`theta` together.
 
             Args:
                 theta (float or ndarray): Angle of rotation in degrees. \
                     Default 0.
                 x (float or ndarray): Position scalar or vector.
                 y (float or ndarray): Position scalar or vector.
+                out (ndarray): Optional pre-allocated C-contiguous array \
+                    of doubles into which the result will be written. \
+                    Default :py:obj:`None`.
+                nthreads (int): Number of threads. Default 0 (one per \
+                    hardware thread).
 
             Returns:
                 The specific intensity at :py:obj:`(x, y)`.
@@ -232,6 +361,10 @@ namespace docstrings {
                     body's radius. Default 0 (no occultation).
                 gradient (bool): Compute and return the gradient of the \
                     flux as well? Default :py:obj:`False`.
+                out (ndarray): Optional pre-allocated C-contiguous array \
+                    of doubles into which the flux will be written. Useful \
+                    to avoid allocating memory in tight loops. \
+                    Default :py:obj:`None`.
 
             Returns:
                 The flux received by the observer (a scalar or a vector). \
@@ -262,9 +395,13 @@ namespace docstrings {
             is monotonically decreasing toward the limb by using Sturm's
             theorem on the *derivative* of the intensity profile.
             For pure spherical harmonic maps up to
-            :py:obj:`l = 1`, the solution is analytic. For all
+            :py:obj:`l = 2`, the solution is analytic. Maps of degree
+            :py:obj:`l = 3` and :py:obj:`l = 4` are first checked against
+            a sufficient condition for positivity. For all
             other cases, this routine attempts to find the global minimum
-            numerically and checks if it is negative. For maps with
+            numerically and checks if it is negative: it evaluates the map
+            on a coarse grid and refines the lowest local minima of the grid
+            with gradient descent. For maps with
             :py:obj:`nwav > 1`, this routine returns an array of boolean values,
             one per wavelength bin.
 
@@ -272,6 +409,34 @@ namespace docstrings {
                 epsilon (float): Numerical tolerance. Default :math:`10^{-6}`
                 max_iterations (int): Maximum number of iterations for the \
                     numerical solver. Default 100
+                restarts (int): Number of local minima of the grid search \
+                    to refine. More restarts are more robust to maps with \
+                    many shallow minima, at a higher cost. Default 1
+                nthreads (int): Number of threads over which to distribute \
+                    the restarts. Default 1; 0 means one per hardware thread.
+        )pbdoc";
+
+        const char* render = R"pbdoc(
+            Return the specific intensity of the map on a square grid of
+            pixels spanning :py:obj:`[-1, 1]` in :py:obj:`x` and
+            :py:obj:`y`. This is equivalent to (but much faster than)
+            evaluating the map at every pixel, and is what
+            :py:meth:`show()` and :py:meth:`animate()` use internally.
+
+            Args:
+                theta (float or ndarray): Angle of rotation in degrees. \
+                    Default 0.
+                res (int): The resolution of the grid in pixels on a side. \
+                    Default 300.
+                nthreads (int): Number of threads. Default 0 (one per \
+                    hardware thread).
+
+            Returns:
+                An array of shape :py:obj:`(res, res)`, indexed by \
+                :py:obj:`(y, x)`, with one extra leading dimension of \
+                length :py:obj:`len(theta)` if :py:obj:`theta` is an array \
+                and one of length :py:obj:`nwav` if :py:obj:`nwav > 1`. \
+                Pixels off the disk are :py:obj:`NaN`.
         )pbdoc";
 
         const char* show = R"pbdoc(
@@ -321,7 +486,10 @@ namespace docstrings {
 
             .. note:: For maps with :py:obj:`nwav > 1`, users may specify a
                 :py:obj:`nwav` keyword argument indicating the wavelength bin
-                into which the image or array will be loaded.
+                into which the image or array will be loaded. Users may also
+                provide a list (or a 3D array) of images, which are loaded
+                into consecutive wavelength bins starting at :py:obj:`nwav`.
+                This is much faster than loading them one at a time.
 
         )pbdoc";
 
@@ -336,12 +504,12 @@ namespace docstrings {
                 lmax (int): The maximum degree of the spherical harmonic \
                     expansion of the image. Default :py:attr:`lmax`.
 
-            .. todo:: This routine has not been tested. If you have any \
-                      problems with it, please submit an issue on GitHub.
-
             .. note:: For maps with :py:obj:`nwav > 1`, users may specify a
                       :py:obj:`nwav` keyword argument indicating the wavelength bin
-                      into which the image or array will be loaded.
+                      into which the image or array will be loaded. Users may
+                      also provide a 2D array of shape :py:obj:`(nbins, npix)`,
+                      which is loaded into consecutive wavelength bins starting
+                      at :py:obj:`nwav`.
 
         )pbdoc";
 
@@ -390,6 +558,8 @@ namespace docstrings {
         const char* gradient = R"pbdoc(
             The gradient of the body's light curve. This is a dictionary of
             vectors (:py:obj:`nwav = 1`) or matrices (:py:obj:`nwav > 1`).
+            The arrays are read directly from the internal gradient buffer
+            without copying.
             The dictionary keys are the names of all parameters of all bodies
             in the current :py:class:`System` object, formatted as \
             :py:obj:`body.parameter`, where :py:obj:`body` is :py:obj:`A`
@@ -591,6 +761,8 @@ namespace docstrings {
             .. autoattribute:: primary
             .. autoattribute:: secondaries
             .. automethod:: compute(time, gradient=False)
+            .. automethod:: compute_stream(time, sink, chunk_size=10000, gradient=False, numerical=False, positions=False)
+            .. automethod:: compute_ensemble(params, time, names, nthreads=0)
             .. autoattribute:: lightcurve
             .. autoattribute:: gradient
             .. autoattribute:: exposure_time
@@ -623,6 +795,69 @@ namespace docstrings {
                     with respect to all body parameters? Default :py:obj:`False`
         )pbdoc";
 
+        const char* compute_stream = R"pbdoc(
+            Compute the system light curve in chunks, for time series too
+            long to hold in memory. The light curve is computed for at most
+            :py:obj:`chunk_size` cadences at a time, and each chunk is
+            handed to :py:obj:`sink` before the next one is computed, so
+            memory use does not grow with the length of the time series.
+            After the call, :py:attr:`lightcurve` and :py:attr:`gradient`
+            hold the values for the last chunk only.
+
+            Args:
+                time (ndarray or iterable): Time array, measured in days, \
+                    or an iterable (e.g., a generator) yielding time arrays, \
+                    which are processed as they come.
+                sink (ndarray or callable): Either a (possibly \
+                    memory-mapped) array with one row per cadence, into \
+                    which the light curve is written, or a function called \
+                    as :py:obj:`sink(start, lightcurve, **kwargs)` for each \
+                    chunk, where :py:obj:`start` is the index of the first \
+                    cadence in the chunk. If :py:obj:`gradient` is \
+                    :py:obj:`True`, the gradient dictionary is passed as the \
+                    :py:obj:`gradient` keyword; if :py:obj:`positions` is \
+                    :py:obj:`True`, a list of :py:obj:`(x, y, z)` tuples, one \
+                    per secondary, is passed as the :py:obj:`positions` \
+                    keyword. These two options raise a \
+                    :py:obj:`ValueError` if :py:obj:`sink` is an array.
+                chunk_size (int): Maximum number of cadences per chunk when \
+                    :py:obj:`time` is an array. Default 10000.
+                gradient (bool): Compute the gradient of the light curve? \
+                    Default :py:obj:`False`.
+                positions (bool): Pass the positions of the secondaries to \
+                    :py:obj:`sink`? Default :py:obj:`False`.
+
+            Returns:
+                The total number of cadences processed.
+        )pbdoc";
+
+        const char* compute_ensemble = R"pbdoc(
+            Compute the system light curve for many parameter vectors at once.
+            This is useful for ensemble samplers such as :py:obj:`emcee`:
+            instead of setting the parameters and calling :py:meth:`compute`
+            once per walker, pass all walkers at once. The light curves are
+            computed in parallel on independent copies of the system, so the
+            state of the bodies in this system is not modified.
+
+            Args:
+                params (ndarray): Array of shape :py:obj:`(nwalkers, nparams)` \
+                    containing the parameter values for each walker.
+                time (ndarray): Time array, measured in days.
+                names (list): The :py:obj:`nparams` parameter names, formatted \
+                    as in :py:attr:`gradient` (e.g., :py:obj:`b.r`, \
+                    :py:obj:`b.porb`, :py:obj:`A.prot`). Map coefficients \
+                    are specified as :py:obj:`b.y[n]`, where \
+                    :math:`n = l^2 + l + m`, and :py:obj:`b.u[l]`. \
+                    Parameters not listed take their current values.
+                nthreads (int): Number of threads. Default 0 (one per \
+                    hardware thread).
+
+            Returns:
+                An array of shape :py:obj:`(nwalkers, NT)` \
+                (or :py:obj:`(nwalkers, NT, nwav)` if :py:obj:`nwav > 1`) \
+                containing the light curve for each walker.
+        )pbdoc";
+
         const char* lightcurve = R"pbdoc(
             The computed light curve for the system, equal to the sum
             of the light curves of each of the bodies. If :py:obj:`nwav = 1`,
@@ -643,18 +878,22 @@ namespace docstrings {
         const char* exposure_time = R"pbdoc(
             Exposure time for each data point in the light curve. Default 0.
             If nonzero, integrates the light curve over the exposure time
-            using a recursive technique to approximate the integral.
+            using adaptive Simpson quadrature. Exposures are only refined
+            near occultations, and the flux at the boundary between
+            contiguous exposures is computed only once.
         )pbdoc";
 
         const char* exposure_tol = R"pbdoc(
-            Tolerance of the recursive exposure time algorithm. Default
-            is square root of machine epsilon.
+            Tolerance of the recursive exposure time algorithm. An
+            interval close to an occultation is bisected if the flux at its
+            midpoint differs from the linear interpolant by more than this
+            amount. Default is square root of machine epsilon.
         )pbdoc";
 
         const char* exposure_max_depth = R"pbdoc(
             Maximum number of recursions in the exposure time algorithm.
             Default 4. Increase this for higher accuracy (and longer
-            run times).
+            run times). Must be non-negative.
         )pbdoc";
 
     }
@@ -15,6 +15,7 @@ Adapted from DFM's AstroFlow: https://github.com/dfm/AstroFlow/
 #include <unsupported/Eigen/AutoDiff>
 #include "utils.h"
 #include "errors.h"
+#include "profile.h"
 
 namespace starry {
 
@@ -30,12 +31,17 @@ namespace ellip {
 
     // EA: Elliptic integral convergence tolerance should be sqrt of machine precision
     static const double tol_double = sqrt(std::numeric_limits<double>::epsilon());
+    static const float tol_float = sqrt(std::numeric_limits<float>::epsilon());
     static const Multi tol_Multi = sqrt(std::numeric_limits<Multi>::epsilon());
 
     //! Elliptic integral convergence tolerance
     template <typename T>
     inline T tol(){ return T(tol_double); }
 
+    //! Elliptic integral convergence tolerance (single precision)
+    template <>
+    inline float tol(){ return tol_float; }
+
     //! Elliptic integral convergence tolerance (multi-precision)
     template <>
     inline Multi tol(){ return tol_Multi; }
@@ -50,7 +56,10 @@ namespace ellip {
         for (int i = 0; i < STARRY_ELLIP_MAX_ITER; ++i) {
             h = m;
             m += kc;
-            if (abs(h - kc) / h <= tol<T>()) return pi<T>() / m;
+            if (abs(h - kc) / h <= tol<T>()) {
+                STARRY_PROFILE_TERMS(profile::SERIES_ELLIP, i + 1);
+                return pi<T>() / m;
+            }
             kc = sqrt(h * kc);
             m *= 0.5;
         }
@@ -70,7 +79,10 @@ namespace ellip {
             m0 = m;
             m += kc;
             a += b / m;
-            if (abs(m0 - kc) / m0 <= tol<T>()) return 0.25 * pi<T>() * a / m;
+            if (abs(m0 - kc) / m0 <= tol<T>()) {
+                STARRY_PROFILE_TERMS(profile::SERIES_ELLIP, i + 1);
+                return 0.25 * pi<T>() * a / m;
+            }
             kc = 2.0 * sqrt(kc * m0);
         }
         throw errors::ConvergenceError("Elliptic integral E did not converge.");
@@ -98,8 +110,10 @@ namespace ellip {
             p = g + p;
             g = m0;
             m0 = kc + m0;
-            if (abs(1.0 - kc / g) <= tol<T>())
+            if (abs(1.0 - kc / g) <= tol<T>()) {
+                STARRY_PROFILE_TERMS(profile::SERIES_ELLIP, i + 1);
                 return 0.5 * pi<T>() * (c * m0 + d) / (m0 * (m0 + p));
+            }
             kc = 2.0 * sqrt(e);
             e = kc * m0;
         }
@@ -180,8 +194,10 @@ namespace ellip {
             p += g;
             g = m;
             m += kc;
-            if (abs(g - kc) < g * ca)
+            if (abs(g - kc) < g * ca) {
+                STARRY_PROFILE_TERMS(profile::SERIES_ELLIP, i + 1);
                 return 0.5 * pi<T>() * (a * m + b) / (m * (m + p));
+            }
         }
         throw errors::ConvergenceError("Elliptic integral CEL did not converge.");
     }
@@ -294,6 +310,7 @@ namespace ellip {
         }
         if (iter == STARRY_ELLIP_MAX_ITER)
             throw errors::ConvergenceError("Elliptic integral CEL did not converge.");
+        STARRY_PROFILE_TERMS(profile::SERIES_ELLIP, iter);
         Piofk = 0.5 * pi<T>() * (a1 * m + b1) / (m * (m + p));
         Eofk = 0.5 * pi<T>() * (a2 * m + b2) / (m * (m + p1));
         Em1mKdm = 0.5 * pi<T>() * (a3 * m + b3) / (m * (m + p1));
@@ -21,10 +21,16 @@ TODO: The biggest speedup may come from only computing the total flux
 #include <unsupported/Eigen/AutoDiff>
 #include <string>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include "errors.h"
 #include "maps.h"
 #include "utils.h"
 #include "rotation.h"
+#include "profile.h"
 
 
 namespace starry {
@@ -41,6 +47,7 @@ namespace kepler {
     using namespace utils;
     using maps::Map;
     using rotation::Wigner;
+    using rotation::BlockDiagonal;
     using std::abs;
     using utils::isInfinite;
 
@@ -49,6 +56,27 @@ namespace kepler {
     template <class T> class Primary;
     template <class T> class Secondary;
     template <class T> class System;
+    template <class T> class EnsembleWorker;
+
+    /**
+    Storage for the gradient of a light curve. All derivatives live in a
+    single column-major `(NT * nwav, ngrad)` matrix, so the `(NT, nwav)`
+    block corresponding to each parameter is contiguous in memory and
+    can be handed to Python without copying. The buffer is reference
+    counted so that any such views outlive subsequent calls to `compute`.
+
+    */
+    template <class T>
+    using Gradient = std::shared_ptr<Matrix<Scalar<T>>>;
+
+    //! Allocate a gradient buffer, reusing the old one if no one else holds it
+    template <class T>
+    inline void allocateGradient(Gradient<T>& dL, size_t NT, int nwav,
+                                 size_t ngrad) {
+        if (!dL || (dL.use_count() > 1))
+            dL = std::make_shared<Matrix<Scalar<T>>>();
+        dL->resize(NT * nwav, ngrad);
+    }
 
     // Gradient labels
     static const std::vector<std::string> PRIMARY_GRAD_NAMES({"prot", "tref"});
@@ -67,6 +95,7 @@ namespace kepler {
     */
     template <typename T>
     T EccentricAnomaly(const T& M, const T& ecc) {
+        STARRY_PROFILE_SCOPE(profile::KEPLER);
         // Initial condition
         T E = M;
         T tol = 10 * mach_eps<T>();
@@ -221,7 +250,9 @@ namespace kepler {
     }
 
     /**
-    Flux container for exposure time integration.
+    Flux container for exposure time integration. Instances are
+    allocated once per call to `System::compute` and updated in place,
+    so the integrator does not touch the heap at every node.
 
     */
     template <class T>
@@ -229,45 +260,58 @@ namespace kepler {
 
         public:
 
-            std::vector<Row<T>> flux;
-            std::vector<T> gradient;
+            using S = Scalar<T>;
+            std::vector<Row<T>> flux;                                           /**< The flux from each body at this node */
+            std::vector<T> gradient;                                            /**< The gradient of the flux from each body */
+            std::vector<S> x;                                                   /**< Sky x position of each secondary */
+            std::vector<S> y;                                                   /**< Sky y position of each secondary */
             size_t nsec;
             bool grad;
 
-            explicit Exposure(size_t nsec, bool grad) :
-                    nsec(nsec), grad(grad) {
+            Exposure() : nsec(0), grad(false) {}
+
+            explicit Exposure(size_t nsec, bool grad) {
+                reset(nsec, grad);
+            }
+
+            //! Resize the containers
+            inline void reset(size_t nsec_, bool grad_) {
+                nsec = nsec_;
+                grad = grad_;
                 flux.resize(nsec + 1);
-                if (grad) gradient.resize(nsec + 1);
+                gradient.resize(grad ? nsec + 1 : 0);
+                x.resize(nsec);
+                y.resize(nsec);
             }
 
-            inline Exposure<T> operator+(const Exposure<T>& exposure) const {
-                Exposure<T> result(*this);
+            //! Zero out the fluxes and gradients, keeping the shapes of `ref`
+            inline void setZero(const Exposure<T>& ref) {
                 for (size_t n = 0; n < nsec + 1; ++n) {
-                    result.flux[n] += exposure.flux[n];
-                    if (grad)
-                        result.gradient[n] += exposure.gradient[n];
+                    flux[n] = ref.flux[n];
+                    utils::setZero(flux[n]);
+                    if (grad) {
+                        gradient[n] = ref.gradient[n];
+                        utils::setZero(gradient[n]);
+                    }
                 }
-                return result;
             }
 
-            inline Exposure<T> operator-(const Exposure<T>& exposure) const {
-                Exposure<T> result(*this);
+            //! In-place `this += weight * exposure`
+            inline void add(const Exposure<T>& exposure, const S& weight) {
                 for (size_t n = 0; n < nsec + 1; ++n) {
-                    result.flux[n] -= exposure.flux[n];
+                    flux[n] += weight * exposure.flux[n];
                     if (grad)
-                        result.gradient[n] -= exposure.gradient[n];
+                        gradient[n] += weight * exposure.gradient[n];
                 }
-                return result;
             }
 
-            inline Exposure<T> operator*(const Scalar<T>& mult) const {
-                Exposure<T> result(*this);
+            //! In-place `this *= mult`
+            inline void scale(const S& mult) {
                 for (size_t n = 0; n < nsec + 1; ++n) {
-                    result.flux[n] *= mult;
+                    flux[n] *= mult;
                     if (grad)
-                        result.gradient[n] *= mult;
+                        gradient[n] *= mult;
                 }
-                return result;
             }
 
     };
@@ -384,6 +428,7 @@ namespace kepler {
     class Body : public Map<T> {
 
         friend class System<T>;
+        friend class EnsembleWorker<T>;
 
         protected:
 
@@ -407,7 +452,7 @@ namespace kepler {
             bool computed;                                                      /**< Did the user call `compute()`? */
 
             Matrix<Scalar<T>> lightcurve;                                       /**< The body's full light curve */
-            Vector<T> dL;                                                       /**< The gradient of the body's light curve */
+            Gradient<T> dL;                                                     /**< The gradient of the body's light curve */
             std::vector<std::string> dL_names;                                  /**< Names of each of the params in the light curve gradient */
 
             // Private methods
@@ -465,7 +510,7 @@ namespace kepler {
             void setRefTime(const S& tref_);
             S getRefTime() const;
             const Matrix<Scalar<T>>& getLightcurve() const;
-            const Vector<T>& getLightcurveGradient() const;
+            const Gradient<T>& getLightcurveGradient() const;
             const std::vector<std::string>& getLightcurveGradientNames() const;
 
     };
@@ -577,7 +622,7 @@ namespace kepler {
 
     //! Get the gradient of the body's light curve
     template <class T>
-    const Vector<T>& Body<T>::getLightcurveGradient() const {
+    const Gradient<T>& Body<T>::getLightcurveGradient() const {
         if (!computed)
             throw errors::ValueError("Please call the `compute` method first.");
         return dL;
@@ -604,6 +649,7 @@ namespace kepler {
     class Primary : public Body<T> {
 
         friend class System<T>;
+        friend class EnsembleWorker<T>;
 
         protected:
 
@@ -728,6 +774,7 @@ namespace kepler {
     class Secondary : public Body<T> {
 
         friend class System<T>;
+        friend class EnsembleWorker<T>;
 
         protected:
 
@@ -767,7 +814,9 @@ namespace kepler {
             UnitVector<S> axis2;                                                /**< Instance of the zhat unit vector */
             Wigner<T> W1;                                                       /**< First sky transform (xhat) */
             Wigner<T> W2;                                                       /**< Second sky transform (zhat) */
-            Matrix<S>* RSky;                                                    /**< The rotation matrix into the sky plane */
+            BlockDiagonal<S> RSky;                                              /**< The rotation matrix into the sky plane */
+            S RSky_inc;                                                         /**< Inclination for which `RSky` was last computed */
+            S RSky_Omega;                                                       /**< Longitude of ascending node for which `RSky` was last computed */
 
             // The orbital elements
             S a;                                                                /**< The semi-major axis in units of the primary radius */
@@ -852,6 +901,9 @@ namespace kepler {
                 axis2(zhat<S>()),
                 W1(lmax, nwav, y, axis1),
                 W2(lmax, nwav, y, axis2),
+                RSky(lmax),
+                RSky_inc(NAN),
+                RSky_Omega(NAN),
                 AD()
 
             {
@@ -872,21 +924,11 @@ namespace kepler {
                 setOmega(0.0);
                 setLambda0(90.0);
 
-                // Initialize the sky rotation matrix
-                RSky = new Matrix<S>[lmax + 1];
-                for (int l = 0; l < lmax + 1; ++l)
-                    RSky[l].resize(2 * l + 1, 2 * l + 1);
-
                 // Sync the maps
                 syncSkyMap();
 
             }
 
-            //! Destructor
-            ~Secondary() {
-                delete [] RSky;
-            }
-
     };
 
 
@@ -913,16 +955,18 @@ namespace kepler {
         if ((Omega != 0) || (sini < 1. - 2 * mach_eps<Scalar<T>>())) {
 
             // Let's store the rotation matrices: we'll need them to correctly
-            // transform the derivatives of the map back to the user coordinates
-            W1.update();
-            W1.compute(sini, cosi);
-            W2.update();
-            W2.compute(cosO, sinO);
-            for (int l = 0; l < lmax + 1; ++l) {
-                RSky[l] = W1.R[l] * W2.R[l];
-                skyY.block(l * l, 0, 2 * l + 1, nwav) =
-                    RSky[l] * y.block(l * l, 0, 2 * l + 1, nwav);
+            // transform the derivatives of the map back to the user coordinates.
+            // These depend only on `inc` and `Omega`, so we cache them.
+            if ((inc != RSky_inc) || (Omega != RSky_Omega)) {
+                W1.updateAxis();
+                W1.compute(sini, cosi);
+                W2.updateAxis();
+                W2.compute(cosO, sinO);
+                RSky.setProduct(W1.R, W2.R);
+                RSky_inc = inc;
+                RSky_Omega = Omega;
             }
+            RSky.apply(y, skyY);
 
             // Update the sky map
             skyMap.setY(skyY);
@@ -930,8 +974,9 @@ namespace kepler {
         } else {
 
             // The transformation is the identity matrix
-            for (int l = 0; l < lmax + 1; ++l)
-                RSky[l] = Matrix<Scalar<T>>::Identity(2 * l + 1, 2 * l + 1);
+            RSky.setIdentity();
+            RSky_inc = NAN;
+            RSky_Omega = NAN;
 
             // Update the sky map
             skyMap.setY(y);
@@ -970,11 +1015,8 @@ namespace kepler {
         if ((gradient) && (y_deg > 0)) {
             // dF / d{y} = dF / d{ysky} * d{ysky} / d{y}
             // And since ysky = R y, we have d{ysky} / d{y} = R
-            for (int l = 0; l < lmax + 1; ++l) {
-                dF.block(4 + l * l, 0, 2 * l + 1, nwav) =
-                    RSky[l].transpose() *
-                    sky_dF.block(4 + l * l, 0, 2 * l + 1, nwav);
-            }
+            RSky.applyTranspose(sky_dF.block(4, 0, N, nwav),
+                                dF.block(4, 0, N, nwav));
         }
 
         return F;
@@ -1227,6 +1269,205 @@ namespace kepler {
         return std::string(os.str());
     }
 
+    /* ----------------- */
+    /*      ENSEMBLE     */
+    /* ----------------- */
+
+    /**
+    A parameter varied in an ensemble evaluation. Parameters are named
+    as in the light curve gradient (i.e., `A.prot`, `b.r`, `b.porb`, ...),
+    and map coefficients are addressed by index: `b.y[n]` is the
+    spherical harmonic coefficient with `n = l^2 + l + m` and `b.u[l]` is
+    the limb darkening coefficient of order `l`.
+
+    */
+    struct EnsembleParam {
+        size_t body;                                                            /**< 0 for the primary, `n` for the `n`-th secondary */
+        std::string name;                                                       /**< Name of the parameter, without the body prefix */
+        int index;                                                              /**< Index of the map coefficient (`y` and `u` only) */
+    };
+
+    //! Parse the name of an ensemble parameter
+    inline EnsembleParam parseEnsembleParam(const std::string& label) {
+        EnsembleParam par;
+        if ((label.size() < 3) || (label[1] != '.'))
+            throw errors::ValueError("Invalid parameter name `" + label + "`.");
+        if (label[0] == 'A')
+            par.body = 0;
+        else if ((label[0] >= 'b') && (label[0] <= 'z'))
+            par.body = label[0] - 'a';
+        else
+            throw errors::ValueError("Invalid body in parameter `" + label + "`.");
+        par.name = label.substr(2);
+        par.index = -1;
+        size_t bracket = par.name.find('[');
+        if (bracket != std::string::npos) {
+            if (par.name.back() != ']')
+                throw errors::ValueError("Invalid parameter name `" + label + "`.");
+            par.index = std::stoi(par.name.substr(bracket + 1,
+                                  par.name.size() - bracket - 2));
+            par.name = par.name.substr(0, bracket);
+        }
+        if ((par.name == "y") || (par.name == "u")) {
+            if (par.index < 1)
+                throw errors::ValueError("Map coefficients must be specified "
+                                         "as `y[n]` or `u[l]` with an index "
+                                         "of at least one.");
+            return par;
+        } else if (par.index != -1) {
+            throw errors::ValueError("Invalid parameter name `" + label + "`.");
+        }
+        const std::vector<std::string>& valid = (par.body == 0) ?
+            PRIMARY_GRAD_NAMES : SECONDARY_GRAD_NAMES;
+        if (std::find(valid.begin(), valid.end(), par.name) == valid.end())
+            throw errors::ValueError("Parameter `" + label + "` cannot be "
+                                     "varied in an ensemble.");
+        return par;
+    }
+
+    /**
+    An independent copy of a Keplerian system, used by the worker
+    threads in `System::computeEnsemble`. The bodies are only rebuilt
+    if the structure of the parent system (number of bodies, their
+    degrees and wavelength grids) changes; otherwise their state is
+    simply synced from the parent before each ensemble evaluation.
+
+    */
+    template <class T>
+    class EnsembleWorker {
+
+        public:
+
+            std::unique_ptr<Primary<T>> primary;                                /**< Copy of the primary */
+            std::vector<std::unique_ptr<Secondary<T>>> secondaries;             /**< Copies of the secondaries */
+            std::unique_ptr<System<T>> system;                                  /**< The system made up of the copies */
+
+            //! Constructor
+            explicit EnsembleWorker(const System<T>& parent) {
+                primary.reset(new Primary<T>(parent.primary->lmax,
+                                             parent.primary->nwav));
+                std::vector<Secondary<T>*> ptrs;
+                for (auto sec : parent.secondaries) {
+                    secondaries.emplace_back(new Secondary<T>(sec->lmax,
+                                                              sec->nwav));
+                    ptrs.push_back(secondaries.back().get());
+                }
+                system.reset(new System<T>(primary.get(), ptrs));
+            }
+
+            //! Does this worker have the same structure as `parent`?
+            bool matches(const System<T>& parent) const {
+                if ((primary->lmax != parent.primary->lmax) ||
+                    (primary->nwav != parent.primary->nwav) ||
+                    (secondaries.size() != parent.secondaries.size()))
+                    return false;
+                for (size_t i = 0; i < secondaries.size(); ++i) {
+                    if ((secondaries[i]->lmax != parent.secondaries[i]->lmax) ||
+                        (secondaries[i]->nwav != parent.secondaries[i]->nwav))
+                        return false;
+                }
+                return true;
+            }
+
+            //! Copy the state of all bodies in `parent` into this worker
+            void sync(const System<T>& parent) {
+                syncMap(*parent.primary, *primary);
+                primary->setRotPer(parent.primary->getRotPer());
+                primary->setRefTime(parent.primary->getRefTime());
+                primary->setRadiusInMeters(parent.primary->getRadiusInMeters());
+                for (size_t i = 0; i < secondaries.size(); ++i) {
+                    const Secondary<T>& src = *parent.secondaries[i];
+                    Secondary<T>& dst = *secondaries[i];
+                    syncMap(src, dst);
+                    dst.setRadius(src.getRadius());
+                    dst.setLuminosity(src.getLuminosity());
+                    dst.setRotPer(src.getRotPer());
+                    dst.setRefTime(src.getRefTime());
+                    dst.setSemi(src.getSemi());
+                    dst.setOrbPer(src.getOrbPer());
+                    dst.setInc(src.getInc());
+                    dst.setEcc(src.getEcc());
+                    dst.setVarPi(src.getVarPi());
+                    dst.setOmega(src.getOmega());
+                    dst.setLambda0(src.getLambda0());
+                }
+                system->setExposureTime(parent.getExposureTime());
+                system->setExposureTol(parent.getExposureTol());
+                system->setExposureMaxDepth(parent.getExposureMaxDepth());
+            }
+
+            //! Set the parameters for a single ensemble member
+            template <typename Derived>
+            void apply(const std::vector<EnsembleParam>& pars,
+                       const Eigen::MatrixBase<Derived>& values) {
+                for (size_t b = 0; b < secondaries.size() + 1; ++b) {
+                    Body<T>* body = (b == 0) ? static_cast<Body<T>*>(primary.get()) :
+                                               static_cast<Body<T>*>(secondaries[b - 1].get());
+                    Secondary<T>* sec = (b == 0) ? nullptr : secondaries[b - 1].get();
+                    T y, u;
+                    bool sety = false, setu = false;
+                    for (size_t k = 0; k < pars.size(); ++k) {
+                        const EnsembleParam& par = pars[k];
+                        const Scalar<T> value = values(k);
+                        if (par.body != b) continue;
+                        if (par.name == "y") {
+                            if (!sety) y = body->getY();
+                            if (par.index >= body->N)
+                                throw errors::IndexError("Invalid map coefficient index.");
+                            setRow(y, par.index, value);
+                            sety = true;
+                        } else if (par.name == "u") {
+                            if (!setu) u = body->getU();
+                            if (par.index > body->lmax)
+                                throw errors::IndexError("Invalid limb darkening coefficient index.");
+                            setRow(u, par.index, value);
+                            setu = true;
+                        } else if (par.name == "prot") {
+                            body->setRotPer(value);
+                        } else if (par.name == "tref") {
+                            body->setRefTime(value);
+                        } else if (par.name == "r") {
+                            sec->setRadius(value);
+                        } else if (par.name == "L") {
+                            Row<T> L;
+                            resize(L, 1, sec->nwav);
+                            setOnes(L);
+                            sec->setLuminosity(Row<T>(L * value));
+                        } else if (par.name == "a") {
+                            sec->setSemi(value);
+                        } else if (par.name == "porb") {
+                            sec->setOrbPer(value);
+                        } else if (par.name == "inc") {
+                            sec->setInc(value);
+                        } else if (par.name == "ecc") {
+                            sec->setEcc(value);
+                        } else if (par.name == "w") {
+                            sec->setVarPi(value);
+                        } else if (par.name == "Omega") {
+                            sec->setOmega(value);
+                        } else if (par.name == "lambda0") {
+                            sec->setLambda0(value);
+                        }
+                    }
+                    if (sety) body->setY(y);
+                    if (setu) body->setU(u);
+                }
+            }
+
+        protected:
+
+            //! Copy the surface map of a body
+            void syncMap(const Map<T>& src, Map<T>& dst) {
+                dst.setAxis(src.getAxis());
+                dst.setU(src.getU());
+                dst.setY(src.getY());
+                dst.setApproxTol(src.getApproxTol());
+                dst.setTableTol(src.getTableTol());
+                dst.setTableDr(src.getTableDr());
+            }
+
+    };
+
     /* ----------------- */
     /*       SYSTEM      */
     /* ----------------- */
@@ -1239,22 +1480,32 @@ namespace kepler {
 
             using S = Scalar<T>;                                                /**< Shorthand for the scalar type (double, Multi, ...) */
             Matrix<Scalar<T>> lightcurve;                                       /**< The full system light curve */
-            Vector<T> dL;                                                       /**< The gradient of the system light curve */
+            Gradient<T> dL;                                                     /**< The gradient of the system light curve */
             std::vector<std::string> dL_names;                                  /**< The names of each of the derivatives in the gradient */
             Scalar<T> exptime;                                                  /**< Exposure time in days */
             Scalar<T> exptol;                                                   /**< Exposure integration tolerance */
             int expmaxdepth;                                                    /**< Maximum recursion depth in the exposure integration */
+            std::vector<Exposure<T>> expmid;                                    /**< Preallocated midpoint evaluations, one per recursion depth */
+            Exposure<T> expleft;                                                /**< Flux at the start of the current exposure */
+            Exposure<T> expright;                                               /**< Flux at the end of the current exposure */
+            Exposure<T> expsum;                                                 /**< Accumulator for the exposure integral */
+            Scalar<T> exptprev;                                                 /**< End time of the previous exposure */
+            bool expcached;                                                     /**< Can we reuse `expright` as the next `expleft`? */
             size_t t;                                                           /** The current index in the time array */
             size_t ngrad;                                                       /** Number of derivatives to compute */
             size_t g;                                                           /** The current gradient index */
             bool computed;                                                      /** Did the user call `compute()` yet? */
+            std::vector<std::unique_ptr<EnsembleWorker<T>>> workers;            /**< Independent copies of the system for `computeEnsemble` */
 
             // Protected methods
             inline void step(const S& time_cur, bool gradient, bool numerical);
-            Exposure<T> step(const S& time_cur, bool gradient, bool numerical, bool store_xyz);
-            Exposure<T> integrate(const Exposure<T>& f1, const Exposure<T>& f2,
-                                  const S& t1, const S& t2,
-                                  int depth, bool gradient, bool numerical);
+            inline void step(const S& time_cur, bool gradient, bool numerical,
+                             bool store_xyz, Exposure<T>& exposure);
+            inline bool nearContact(const Exposure<T>& f1,
+                                    const Exposure<T>& f2) const;
+            void integrate(const Exposure<T>& f1, const Exposure<T>& f2,
+                           const S& t1, const S& t2,
+                           int depth, bool gradient, bool numerical);
             inline void integrate(const S& time_cur, bool gradient, bool numerical);
 
             inline void computePrimaryTotalGradient(const S& time_cur);
@@ -1297,9 +1548,13 @@ namespace kepler {
             }
 
             // Public methods
-            void compute(const Vector<S>& time, bool gradient=false, bool numerical=false);
+            void compute(const Eigen::Ref<const Vector<S>>& time, bool gradient=false, bool numerical=false);
+            void computeEnsemble(const Matrix<S>& params,
+                                 const std::vector<std::string>& names,
+                                 const Eigen::Ref<const Vector<S>>& time,
+                                 Matrix<S>& result, int nthreads=0);
             const Matrix<S>& getLightcurve() const;
-            const Vector<T>& getLightcurveGradient() const;
+            const Gradient<T>& getLightcurveGradient() const;
             const std::vector<std::string>& getLightcurveGradientNames() const;
             std::string info();
             void setExposureTime(const S& t_);
@@ -1338,7 +1593,9 @@ namespace kepler {
     //! Set the maximum exposure depth
     template <class T>
     void System<T>::setExposureMaxDepth(const int d_) {
-        expmaxdepth = d_;
+        if (d_ >= 0) expmaxdepth = d_;
+        else throw errors::ValueError("The maximum exposure depth "
+                                      "cannot be negative.");
     }
 
     //! Get the maximum exposure depth
@@ -1363,7 +1620,7 @@ namespace kepler {
 
     //! Return the gradient of the light curve
     template <class T>
-    const Vector<T>& System<T>::getLightcurveGradient() const {
+    const Gradient<T>& System<T>::getLightcurveGradient() const {
         if (!computed)
             throw errors::ValueError("Please call the `compute` method first.");
         return dL;
@@ -1377,59 +1634,124 @@ namespace kepler {
     }
 
     /**
-    Recursive exposure time integration function (single iteration)
+    Check whether any pair of bodies may be in contact (i.e., past
+    first contact) at some point between two integration nodes. The
+    sky separation of each pair at either node is compared to the
+    chord traversed by the pair over the interval; if first contact
+    cannot be reached, there are no occultations and the flux is a
+    smooth function of time, so there is no need to refine the
+    quadrature.
 
     */
     template <class T>
-    Exposure<T> System<T>::integrate(const Exposure<T>& f1,
-                                     const Exposure<T>& f2,
-                                     const Scalar<T>& t1,
-                                     const Scalar<T>& t2,
-                                     int depth, bool gradient,
-                                     bool numerical) {
+    inline bool System<T>::nearContact(const Exposure<T>& f1,
+                                       const Exposure<T>& f2) const {
+        size_t NS = secondaries.size();
+        Scalar<T> x1, y1, x2, y2, sep, travel, rsum;
+        for (size_t i = 0; i < NS; ++i) {
+            for (size_t j = i; j < NS; ++j) {
+                if (j == i) {
+                    // Secondary `i` and the primary
+                    x1 = f1.x[i];
+                    y1 = f1.y[i];
+                    x2 = f2.x[i];
+                    y2 = f2.y[i];
+                    rsum = 1 + secondaries[i]->r;
+                } else {
+                    // Secondaries `i` and `j`
+                    x1 = f1.x[i] - f1.x[j];
+                    y1 = f1.y[i] - f1.y[j];
+                    x2 = f2.x[i] - f2.x[j];
+                    y2 = f2.y[i] - f2.y[j];
+                    rsum = secondaries[i]->r + secondaries[j]->r;
+                }
+                sep = std::min(sqrt(x1 * x1 + y1 * y1),
+                               sqrt(x2 * x2 + y2 * y2));
+                travel = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+                if (sep - travel <= rsum)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+    Adaptive Simpson exposure time integration (single iteration).
+    The weighted integral over `[t1, t2]` is accumulated into `expsum`.
+    Intervals are only bisected if an occultation may be in progress
+    within them *and* the midpoint flux deviates from the linear
+    interpolant by more than `exptol`. Away from occultations the flux
+    is smooth and the three-point rule is already accurate to O(dt^5).
+
+    */
+    template <class T>
+    void System<T>::integrate(const Exposure<T>& f1,
+                              const Exposure<T>& f2,
+                              const Scalar<T>& t1,
+                              const Scalar<T>& t2,
+                              int depth, bool gradient,
+                              bool numerical) {
         Scalar<T> tmid = (t1 + t2) * 0.5;
         // If this is the first time we're recursing (depth == 0),
         // store the xyz position of the bodies in the output vectors
-        Exposure<T> fmid = step(tmid, gradient, numerical, depth == 0);
-        Exposure<T> fapprox = (f1 + f2) * 0.5;
-        Exposure<T> d = fmid - fapprox;
-        Exposure<T> a(secondaries.size(), gradient);
-        Exposure<T> b(secondaries.size(), gradient);
-        if (depth < expmaxdepth) {
+        Exposure<T>& fmid = expmid[depth];
+        step(tmid, gradient, numerical, depth == 0, fmid);
+        if ((depth < expmaxdepth) &&
+                (nearContact(f1, fmid) || nearContact(fmid, f2))) {
             for (size_t i = 0; i < secondaries.size() + 1; ++i) {
                 for (int n = 0; n < primary->nwav; ++n) {
-                    if (abs(getIndex(d.flux[i], n)) > exptol) {
-                        a = integrate(f1, fmid, t1, tmid, depth + 1, gradient, numerical);
-                        b = integrate(fmid, f2, tmid, t2, depth + 1, gradient, numerical);
-                        return a + b;
+                    if (abs(getIndex(fmid.flux[i], n) -
+                            0.5 * (getIndex(f1.flux[i], n) +
+                                   getIndex(f2.flux[i], n))) > exptol) {
+                        // Note that `fmid` is only overwritten by calls
+                        // at the same depth, so it's safe to reuse it
+                        // as an endpoint for both halves.
+                        integrate(f1, fmid, t1, tmid, depth + 1, gradient, numerical);
+                        integrate(fmid, f2, tmid, t2, depth + 1, gradient, numerical);
+                        return;
                     }
                 }
             }
         }
-        return fapprox * (t2 - t1);
+        STARRY_PROFILE_DEPTH(depth);
+        Scalar<T> h = (t2 - t1) / 6.;
+        expsum.add(f1, h);
+        expsum.add(fmid, 4 * h);
+        expsum.add(f2, h);
     }
 
     /**
-    Recursive exposure time integration function
+    Exposure time integration. If the start of this exposure coincides
+    with the end of the previous one (contiguous cadences), the flux at
+    the shared endpoint is reused rather than recomputed.
 
     */
     template <class T>
     inline void System<T>::integrate(const Scalar<T>& time_cur, bool gradient, bool numerical) {
-        Exposure<T> exposure(secondaries.size(), gradient);
+        STARRY_PROFILE_SCOPE(profile::INTEGRATE);
         Scalar<T> dt = 0.5 * exptime,
                   t1 = time_cur - dt,
                   t2 = time_cur + dt,
                   invdt = 1. / (t2 - t1);
-        exposure = integrate(step(t1, gradient, numerical, false),
-                             step(t2, gradient, numerical, false),
-                             t1, t2, 0, gradient, numerical) * invdt;
-        primary->flux_cur = exposure.flux[0];
+        if (expcached && (abs(t1 - exptprev) <=
+                          10 * mach_eps<Scalar<T>>() * abs(t1))) {
+            std::swap(expleft, expright);
+        } else {
+            step(t1, gradient, numerical, false, expleft);
+        }
+        step(t2, gradient, numerical, false, expright);
+        exptprev = t2;
+        expcached = true;
+        expsum.setZero(expleft);
+        integrate(expleft, expright, t1, t2, 0, gradient, numerical);
+        expsum.scale(invdt);
+        primary->flux_cur = expsum.flux[0];
         if (gradient)
-            primary->dflux_cur = exposure.gradient[0];
+            primary->dflux_cur = expsum.gradient[0];
         for (size_t i = 0; i < secondaries.size(); ++i) {
-            secondaries[i]->flux_cur = exposure.flux[i + 1];
+            secondaries[i]->flux_cur = expsum.flux[i + 1];
             if (gradient)
-                secondaries[i]->dflux_cur = exposure.gradient[i + 1];
+                secondaries[i]->dflux_cur = expsum.gradient[i + 1];
         }
     }
 
@@ -1512,17 +1834,17 @@ namespace kepler {
 
     */
     template <class T>
-    inline Exposure<T> System<T>::step(const Scalar<T>& time, bool gradient,
-                                       bool numerical, bool store_xyz) {
+    inline void System<T>::step(const Scalar<T>& time, bool gradient,
+                                bool numerical, bool store_xyz,
+                                Exposure<T>& exposure) {
 
         // Take the step
         step(time, gradient, numerical);
 
-        // Collect the current values of the flux for each body
-        // We compare them to the previous iteration to determine
-        // whether we need to recurse.
+        // Collect the current values of the flux and the sky
+        // position of each body. We compare them to the neighboring
+        // nodes to determine whether we need to recurse.
         size_t NS = secondaries.size();
-        Exposure<T> exposure(NS, gradient);
         exposure.flux[0] = primary->flux_cur;
         if (gradient)
             exposure.gradient[0] = primary->dflux_cur;
@@ -1534,14 +1856,13 @@ namespace kepler {
                 secondaries[n]->yvec(t) = secondaries[n]->y_cur;
                 secondaries[n]->zvec(t) = secondaries[n]->z_cur;
             }
+            exposure.x[n] = secondaries[n]->x_cur;
+            exposure.y[n] = secondaries[n]->y_cur;
             exposure.flux[n + 1] = secondaries[n]->flux_cur;
             if (gradient)
                 exposure.gradient[n + 1] = secondaries[n]->dflux_cur;
         }
 
-        // Return the flux from each of the bodies
-        return exposure;
-
     }
 
     /**
@@ -1549,10 +1870,11 @@ namespace kepler {
 
     */
     template <class T>
-    void System<T>::compute(const Vector<Scalar<T>>& time_, bool gradient, bool numerical) {
+    void System<T>::compute(const Eigen::Ref<const Vector<Scalar<T>>>& time_,
+                            bool gradient, bool numerical) {
 
         size_t NT = time_.size();
-        Vector<Scalar<T>> time = time_ * units::DayToSeconds;
+        Scalar<T> time;
         int iletter = 98;                                                       // This is the ASCII code for 'b'
         std::string letter;                                                     // The secondary letter designation
         computed = true;
@@ -1564,9 +1886,7 @@ namespace kepler {
         primary->lightcurve.resize(NT, primary->nwav);
         primary->computed = true;
         if (gradient) {
-            // Resize the outer arrays and
-            // populate the primary gradient names
-            dL.resize(NT);
+            // Populate the primary gradient names
             primary->resizeGradient();
             dL_names.clear();
             dL_names.push_back("time");
@@ -1607,8 +1927,7 @@ namespace kepler {
             secondary->c_light = &(primary->c_light);
             secondary->computed = true;
             if (gradient) {
-                // Resize the outer arrays
-                // and populate the secondary gradient names
+                // Populate the secondary gradient names
                 letter = (char) iletter++;
                 secondary->resizeGradient();
                 for (std::string name : SECONDARY_GRAD_NAMES)
@@ -1623,24 +1942,40 @@ namespace kepler {
 
         // Sync the derivs across all bodies
         if (gradient) {
-            primary->dL.resize(NT);
+            allocateGradient<T>(dL, NT, primary->nwav, ngrad);
+            allocateGradient<T>(primary->dL, NT, primary->nwav, ngrad);
             primary->dL_names = dL_names;
             primary->ngrad = ngrad;
             for (auto secondary : secondaries) {
-                secondary->dL.resize(NT);
+                allocateGradient<T>(secondary->dL, NT, primary->nwav, ngrad);
                 secondary->dL_names = dL_names;
                 secondary->ngrad = ngrad;
             }
         }
 
+        // Allocate the exposure time integration buffers. These
+        // are invalidated on every call, since the body parameters
+        // may have changed since the last one.
+        expcached = false;
+        if (exptime > 0) {
+            size_t NS = secondaries.size();
+            expmid.resize(expmaxdepth + 1);
+            for (auto& exposure : expmid)
+                exposure.reset(NS, gradient);
+            expleft.reset(NS, gradient);
+            expright.reset(NS, gradient);
+            expsum.reset(NS, gradient);
+        }
+
         // Loop through the timeseries
         for (t = 0; t < NT; ++t){
 
             // Take an orbital step and compute the fluxes
+            time = time_(t) * units::DayToSeconds;
             if (exptime == 0)
-                step(time(t), gradient, numerical);
+                step(time, gradient, numerical);
             else
-                integrate(time(t), gradient, numerical);
+                integrate(time, gradient, numerical);
 
             // Update the light curves and orbital positions
             for (int n = 0; n < primary->nwav; ++n) {
@@ -1648,8 +1983,10 @@ namespace kepler {
                 lightcurve(t, n) = getColumn(primary->flux_cur, n);
             }
             if (gradient) {
-                primary->dL(t) = primary->dflux_cur;
-                dL(t) = primary->dL(t);
+                primary->dL->block(t * primary->nwav, 0, primary->nwav, ngrad) =
+                    primary->dflux_cur.transpose();
+                dL->block(t * primary->nwav, 0, primary->nwav, ngrad) =
+                    primary->dflux_cur.transpose();
             }
             for (auto secondary : secondaries) {
                 if (exptime == 0) {
@@ -1663,14 +2000,99 @@ namespace kepler {
                     lightcurve(t, n) += getColumn(secondary->flux_cur, n);
                 }
                 if (gradient) {
-                    secondary->dL(t) = secondary->dflux_cur;
-                    dL(t) += secondary->dL(t);
+                    secondary->dL->block(t * primary->nwav, 0,
+                                         primary->nwav, ngrad) =
+                        secondary->dflux_cur.transpose();
+                    dL->block(t * primary->nwav, 0, primary->nwav, ngrad) +=
+                        secondary->dflux_cur.transpose();
                 }
             }
 
         }
     }
 
+    /**
+    Compute the system light curve for an ensemble of parameter
+    vectors, such as the walkers of an MCMC sampler. Row `k` of
+    `params` holds the values of the parameters named in `names` for
+    the `k`-th member of the ensemble; all other parameters are taken
+    from the current state of the system. The members are distributed
+    over `nthreads` threads (default: one per hardware thread), each of
+    which operates on its own copy of the system. On return, row `k`
+    of `result` is the flattened `(NT, nwav)` light curve of member `k`.
+
+    */
+    template <class T>
+    void System<T>::computeEnsemble(const Matrix<Scalar<T>>& params,
+                                    const std::vector<std::string>& names,
+                                    const Eigen::Ref<const Vector<Scalar<T>>>& time,
+                                    Matrix<Scalar<T>>& result, int nthreads) {
+
+        // Parse the parameter names
+        if (static_cast<size_t>(params.cols()) != names.size())
+            throw errors::ValueError("The number of columns in `params` "
+                                     "must match the number of names.");
+        std::vector<EnsembleParam> pars;
+        for (auto name : names) {
+            pars.push_back(parseEnsembleParam(name));
+            if (pars.back().body > secondaries.size())
+                throw errors::ValueError("Parameter `" + name + "` refers to "
+                                         "a body not in the system.");
+        }
+
+        // Figure out how many workers we need
+        size_t nmembers = params.rows();
+        if (nthreads <= 0)
+            nthreads = std::thread::hardware_concurrency();
+        if (nthreads <= 0)
+            nthreads = 1;
+        size_t nworkers = std::max(size_t(1),
+                                   std::min(size_t(nthreads), nmembers));
+
+        // Set up the workers. These persist across calls, so we only
+        // pay the cost of instantiating the bodies once.
+        if (workers.size() && !workers[0]->matches(*this))
+            workers.clear();
+        while (workers.size() < nworkers)
+            workers.emplace_back(new EnsembleWorker<T>(*this));
+        for (size_t w = 0; w < nworkers; ++w)
+            workers[w]->sync(*this);
+
+        // Dispatch the ensemble members to the workers
+        int nwav = primary->nwav;
+        size_t NT = time.size();
+        result.resize(nmembers, NT * nwav);
+        std::atomic<size_t> next(0);
+        std::vector<std::exception_ptr> exceptions(nworkers);
+        auto work = [&](size_t w) {
+            try {
+                EnsembleWorker<T>& worker = *workers[w];
+                for (size_t k = next++; k < nmembers; k = next++) {
+                    worker.apply(pars, params.row(k));
+                    worker.system->compute(time);
+                    const Matrix<Scalar<T>>& lc = worker.system->lightcurve;
+                    for (size_t t = 0; t < NT; ++t) {
+                        for (int n = 0; n < nwav; ++n)
+                            result(k, t * nwav + n) = lc(t, n);
+                    }
+                }
+            } catch (...) {
+                exceptions[w] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t w = 1; w < nworkers; ++w)
+            threads.emplace_back(work, w);
+        work(0);
+        for (auto& thread : threads)
+            thread.join();
+        for (auto& exception : exceptions) {
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+
+    }
+
     /**
     Compute the gradient of the primary's total flux.
 
@@ -1778,15 +2200,10 @@ namespace kepler {
             // `dF / dinc` in `computeSecondaryOccultationGradient()`
             if (secondary->y_deg > 0) {
                 T y_transf(secondary->N, secondary->nwav);
-                for (int n = 0; n < secondary->nwav; ++n) {
-                    for (int l = 0; l < secondary->lmax + 1; ++l) {
-                        y_transf.block(l * l, n, 2 * l + 1, 1) =
-                            secondary->skyMap.W.R[l] *
-                            secondary->W1.dRdtheta[l] *
-                            secondary->W2.R[l] *
-                            secondary->y.block(l * l, n, 2 * l + 1, 1);
-                    }
-                }
+                T y_tmp(secondary->N, secondary->nwav);
+                secondary->W2.R.apply(secondary->y, y_transf);
+                secondary->W1.dRdtheta.apply(y_transf, y_tmp);
+                secondary->skyMap.W.applyR(y_tmp, y_transf);
                 setRow(secondary->dflux_tot, g++,
                        Row<T>(cwiseProduct(secondary->L, dot(secondary->B.rTA1, y_transf)) *
                               (-pi<Scalar<T>>() / 180.) +
@@ -1814,15 +2231,10 @@ namespace kepler {
             // `dF / dOmega` in `computeSecondaryOccultationGradient()`
             if (secondary->y_deg > 0) {
                 T y_transf(secondary->N, secondary->nwav);
-                for (int n = 0; n < secondary->nwav; ++n) {
-                    for (int l = 0; l < secondary->lmax + 1; ++l) {
-                        y_transf.block(l * l, n, 2 * l + 1, 1) =
-                            secondary->skyMap.W.R[l] *
-                            secondary->W1.R[l] *
-                            secondary->W2.dRdtheta[l] *
-                            secondary->y.block(l * l, n, 2 * l + 1, 1);
-                    }
-                }
+                T y_tmp(secondary->N, secondary->nwav);
+                secondary->W2.dRdtheta.apply(secondary->y, y_transf);
+                secondary->W1.R.apply(y_transf, y_tmp);
+                secondary->skyMap.W.applyR(y_tmp, y_transf);
                 setRow(secondary->dflux_tot, g++,
                        Row<T>(cwiseProduct(secondary->L, dot(secondary->B.rTA1, y_transf)) *
                               (pi<Scalar<T>>() / 180.)));
@@ -11,10 +11,16 @@ TODO: Test all special cases
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <mutex>
+#include <vector>
 #include <Eigen/Core>
 #include "ellip.h"
 #include "errors.h"
 #include "tables.h"
+#include "profile.h"
 
 namespace starry {
 namespace limbdark {
@@ -307,6 +313,11 @@ namespace limbdark {
             std::vector<Vector<T>> Jcoeff_smallk;
             std::vector<Vector<T>> dJdkcoeff_largek;
             std::vector<Vector<T>> dJdkcoeff_smallk;
+            bool use_cheb;
+            std::vector<Vector<T>> Jcheb_largek;
+            std::vector<Vector<T>> Jcheb_smallk;
+            std::vector<Vector<T>> dJdkcheb_largek;
+            std::vector<Vector<T>> dJdkcheb_smallk;
 
             // The solution vector
             VectorT<T> S;
@@ -320,6 +331,11 @@ namespace limbdark {
                 Jcoeff_smallk(2),
                 dJdkcoeff_largek(2),
                 dJdkcoeff_smallk(2),
+                use_cheb(std::is_same<T, double>::value),
+                Jcheb_largek(4),
+                Jcheb_smallk(4),
+                dJdkcheb_largek(4),
+                dJdkcheb_smallk(4),
                 S(VectorT<T>::Zero(lmax + 1)),
                 dSdb(VectorT<T>::Zero(lmax + 1)),
                 dSdr(VectorT<T>::Zero(lmax + 1)) {
@@ -342,6 +358,7 @@ namespace limbdark {
                     // Pre-tabulate I and J coeffs
                     computeIcoeffs();
                     computeJcoeffs();
+                    if (use_cheb) computeJcheb();
 
                     // Pre-tabulate I for ksq >= 1
                     ivgamma.resize(ivmax + 1);
@@ -356,10 +373,15 @@ namespace limbdark {
             }
 
             inline void compute(const T& b_, const T& r_, bool gradient=false);
+            inline bool computeLowOrder(const T& b_, const T& r_, bool gradient=false);
             inline void computeI(bool gradient=false);
             inline void computeJ(bool gradient=false);
             inline void computeIcoeffs();
             inline void computeJcoeffs();
+            inline void computeJcheb();
+            inline Vector<T> chebfit(const Vector<T>& coeff, int piece);
+            inline T chebval(const std::vector<Vector<T>>& cheb, int j,
+                             const T& x) const;
 
     };
 
@@ -386,6 +408,7 @@ namespace limbdark {
 
         if (ksq >= 1) {
 
+            STARRY_PROFILE_BRANCH(profile::L_I_TABULATED);
             I = ivgamma;
 
         } else {
@@ -418,6 +441,8 @@ namespace limbdark {
                 if (n == STARRY_IJ_MAX_ITER)
                     throw errors::ConvergenceError("Primitive integral "
                                                    "`I` did not converge.");
+                STARRY_PROFILE_BRANCH(profile::L_I_DOWN);
+                STARRY_PROFILE_TERMS(profile::SERIES_I, n);
 
                 I[ivmax] = pow_ksq[ivmax] * k * res;
 
@@ -428,6 +453,7 @@ namespace limbdark {
             // Upward recursion
             } else {
 
+                STARRY_PROFILE_BRANCH(profile::L_I_UP);
                 I[0] = kap0;
                 for (int v = 1; v <= ivmax; ++v)
                     I[v] = (0.5 * (2 * v - 1) * I[v - 1] - pow_ksq[v - 1] * kkc) / v;
@@ -494,6 +520,114 @@ namespace limbdark {
 
     }
 
+    /**
+    Fit a Chebyshev series to the power series with coefficients
+    `coeff` on one piece of `0 <= x <= 1/2`: either `x <= 1/8`
+    (`piece = 0`) or `x >= 1/8` (`piece = 1`). The fit is computed
+    in extended precision and truncated once the Chebyshev coefficients
+    drop below a tenth of the machine precision of `T`. The nodes and
+    the cosine table are shared by all fits.
+
+    */
+    template <class T>
+    inline Vector<T> GreensLimbDark<T>::chebfit(const Vector<T>& coeff, int piece) {
+
+        // The Chebyshev nodes on [-1, 1] and the cosine table
+        const int N = STARRY_IJ_CHEB_NODES;
+        using Real = long double;
+        static const Matrix<Real> cosines = [N] {
+            Matrix<Real> C(N, N);
+            Real pi_ = 3.141592653589793238462643383279502884L;
+            for (int j = 0; j < N; ++j) {
+                for (int i = 0; i < N; ++i)
+                    C(j, i) = std::cos(pi_ * j * (i + 0.5L) / N);
+            }
+            return C;
+        }();
+
+        // Evaluate the power series at the nodes
+        Real lo = piece ? 0.125L : 0.0L;
+        Real hi = piece ? 0.5L : 0.125L;
+        Vector<Real> f(N);
+        for (int i = 0; i < N; ++i) {
+            Real x = lo + 0.5L * (hi - lo) * (cosines(1, i) + 1);
+            f(i) = 0;
+            for (int n = coeff.size() - 1; n >= 0; --n)
+                f(i) = f(i) * x + static_cast<Real>(coeff(n));
+        }
+
+        // Compute the Chebyshev coefficients
+        Vector<Real> c = cosines * f;
+        Vector<T> cheb(N);
+        for (int j = 0; j < N; ++j)
+            cheb(j) = T(c(j) * (j == 0 ? 1 : 2) / N);
+
+        // Truncate
+        T tol = 0.1 * mach_eps<T>() * cheb.cwiseAbs().maxCoeff();
+        int ncheb = N;
+        while ((ncheb > 1) && (abs(cheb(ncheb - 1)) < tol))
+            --ncheb;
+        return cheb.head(ncheb);
+
+    }
+
+    /**
+    Evaluate the piecewise Chebyshev fit `cheb[2 * j + piece]`
+    computed by `chebfit` at `x`.
+
+    */
+    template <class T>
+    inline T GreensLimbDark<T>::chebval(const std::vector<Vector<T>>& cheb,
+                                        int j, const T& x) const {
+        bool piece = (x >= 0.125);
+        const Vector<T>& c = cheb[2 * j + piece];
+        T t = piece ? T((16 * x - 5) / 3) : T(16 * x - 1);
+        T b0 = 0, b1 = 0, b2;
+        for (int n = c.size() - 1; n >= 1; --n) {
+            b2 = b1;
+            b1 = b0;
+            b0 = c(n) + 2 * t * b1 - b2;
+        }
+        return c(0) + t * b0 - b1;
+    }
+
+    /**
+    Pre-compute piecewise Chebyshev fits to the series for the two
+    highest order `J` integrals in the downward recursion regimes,
+    where the expansion variable (`ksq` or `1 / ksq`) is less than 1/2.
+    This replaces a series of up to `STARRY_IJ_MAX_ITER` terms with a
+    fixed-length evaluation. Only used in double precision.
+
+    The fits only depend on `jvmax`, so they are computed once per
+    process for each value and shared by all instances.
+
+    */
+    template <class T>
+    inline void GreensLimbDark<T>::computeJcheb() {
+        typedef std::array<std::vector<Vector<T>>, 4> Fits;
+        static std::map<int, Fits> cache;
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(jvmax);
+        if (it == cache.end()) {
+            for (int j = 0; j < 2; ++j) {
+                for (int piece = 0; piece < 2; ++piece) {
+                    Jcheb_smallk[2 * j + piece] = chebfit(Jcoeff_smallk[j], piece);
+                    Jcheb_largek[2 * j + piece] = chebfit(Jcoeff_largek[j], piece);
+                    dJdkcheb_smallk[2 * j + piece] = chebfit(dJdkcoeff_smallk[j], piece);
+                    dJdkcheb_largek[2 * j + piece] = chebfit(dJdkcoeff_largek[j], piece);
+                }
+            }
+            cache[jvmax] = Fits{{Jcheb_smallk, Jcheb_largek,
+                                 dJdkcheb_smallk, dJdkcheb_largek}};
+        } else {
+            Jcheb_smallk = it->second[0];
+            Jcheb_largek = it->second[1];
+            dJdkcheb_smallk = it->second[2];
+            dJdkcheb_largek = it->second[3];
+        }
+    }
+
     /**
 
     */
@@ -502,7 +636,9 @@ namespace limbdark {
 
         // Downward recursion
         if ((ksq < 0.5) || (ksq > 2)) {
-            
+
+            STARRY_PROFILE_BRANCH(use_cheb ? profile::L_J_CHEB :
+                                  profile::L_J_SERIES);
             T tol;
             T Jv, dJvdk;
             T k2n, term, dtermdk;
@@ -512,7 +648,19 @@ namespace limbdark {
             // Compute the highest two values
             for (int j = 0; j < 2; ++j) {
                 v = jvmax - j;
-                if (ksq < 1) {
+                n = 0;
+                if (use_cheb) {
+                    if (ksq < 1) {
+                        Jv = chebval(Jcheb_smallk, j, ksq);
+                        dJvdk = gradient ? chebval(dJdkcheb_smallk, j, ksq) : T(0);
+                        term = pow(ksq, v);
+                        dJvdk *= term;
+                        Jv *= term * k;
+                    } else {
+                        Jv = chebval(Jcheb_largek, j, invksq);
+                        dJvdk = gradient ? T(chebval(dJdkcheb_largek, j, invksq) / k) : T(0);
+                    }
+                } else if (ksq < 1) {
                     tol = mach_eps<T>() * ksq;
                     // Constant term
                     Jv = Jcoeff_smallk[j](0);
@@ -550,6 +698,8 @@ namespace limbdark {
                 }
                 if (n == STARRY_IJ_MAX_ITER)
                     throw errors::ConvergenceError("Primitive integral `J` did not converge.");
+                if (!use_cheb)
+                    STARRY_PROFILE_TERMS(profile::SERIES_J, n);
                 J[v] = Jv;
                 dJdk[v] = dJvdk;
             }
@@ -572,6 +722,7 @@ namespace limbdark {
         // Upward recursion
         } else {
 
+            STARRY_PROFILE_BRANCH(profile::L_J_UP);
             T f1, f2;
             int v;
 
@@ -606,13 +757,17 @@ namespace limbdark {
     }
 
     /**
-    Compute the `s^T` occultation solution vector
+    Initialize the basic variables and compute the terms of
+    the `s^T` vector that don't require the `I` and `J` integrals.
+    Returns `true` if the solution vector is complete.
 
     */
     template <class T>
-    inline void GreensLimbDark<T>::compute(const T& b, const T& r, bool gradient) {
+    inline bool GreensLimbDark<T>::computeLowOrder(const T& b_, const T& r_, bool gradient) {
 
         // Initialize the basic variables
+        b = b_;
+        r = r_;
         b2 = b * b;
         r2 = r * r;
         invr = 1.0 / r;
@@ -687,7 +842,7 @@ namespace limbdark {
         }
 
         // Special case
-        if (lmax == 0) return;
+        if (lmax == 0) return true;
 
         // Compute the linear limb darkening term
         // and the elliptic integrals
@@ -696,7 +851,7 @@ namespace limbdark {
                   dSdb(1), dSdr(1), gradient);
 
         // Special case
-        if (lmax == 1) return;
+        if (lmax == 1) return true;
 
         // Special case
         if (unlikely(b == 0)) {
@@ -713,7 +868,7 @@ namespace limbdark {
                 }
                 term *= fac;
             }
-            return;
+            return true;
         }
 
         // Special case
@@ -742,9 +897,25 @@ namespace limbdark {
                 dSdb(2) = 2 * dSdb(0) + detadb;
                 dSdr(2) = 2 * dSdr(0) + detadr;
             }
-            return;
+            return true;
         }
 
+        return false;
+
+    }
+
+    /**
+    Compute the `s^T` occultation solution vector
+
+    */
+    template <class T>
+    inline void GreensLimbDark<T>::compute(const T& b, const T& r, bool gradient) {
+
+        STARRY_PROFILE_SCOPE(profile::GREENS_LD);
+
+        // Compute the terms that don't require the I and J integrals
+        if (computeLowOrder(b, r, gradient)) return;
+
         // Derivatives
         T dkdb, dkdr;
         if (gradient) {
@@ -862,6 +1033,653 @@ namespace limbdark {
 
     }
 
+    /**
+    Batched version of `GreensLimbDark` that computes the `s^T`
+    solution vector for many `(b, r)` points at once. The points are
+    sorted by recursion regime (and by `ksq` within each regime) and
+    processed in blocks of `STARRY_LD_BLOCK_SIZE`, with the per-point
+    variables stored as a structure of arrays, so that the `I` and `J`
+    recursions and the sums over the `P(G_n)` terms run over short
+    contiguous arrays that the compiler can vectorize. The series for
+    the highest order integrals (where no Chebyshev fit is available)
+    are evaluated in lockstep across each block, stopping once every
+    point has converged.
+
+    */
+    template <class T>
+    class GreensLimbDarkBatch {
+
+        protected:
+
+            using Array = Eigen::Array<T, Eigen::Dynamic, 1>;
+            using Array2 = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>;
+            using Vars = Eigen::Array<T, Eigen::Dynamic, 13, Eigen::RowMajor>;
+
+            GreensLimbDark<T> L;                                                /**< Scalar solver for the low order terms */
+            Vars vars;                                                          /**< Per-point variables, one row per point */
+            std::vector<T> ksqs;                                                /**< The value of `ksq` for each point */
+            std::vector<int> regime;                                            /**< The recursion regime of each point */
+            std::vector<int> order;                                             /**< Indices of the points, sorted by regime */
+            int len;                                                            /**< Number of points in the current block */
+
+            // Per-point variables for the current block
+            Array b;
+            Array r;
+            Array ksq;
+            Array k;
+            Array kkc;
+            Array kap0;
+            Array invksq;
+            Array bmr;
+            Array fourbr;
+            Array onembmr2;
+            Array sqonembmr2;
+            Array Eofk;
+            Array Em1mKdm;
+
+            // Primitive integrals for the current block: one column per `v`
+            Array2 pow_ksq;
+            Array2 I;
+            Array2 J;
+            Array2 Sp;
+
+            // Temporaries
+            Array coeff;
+            Array res;
+            Array k2n;
+            Array term;
+            Array mfbri;
+            Array mfbrj;
+
+            inline void computeI(int g);
+            inline void computeJ(int g);
+            inline void seriesJ(int g);
+            inline void computeS();
+
+        public:
+
+            const int lmax;
+            Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic,
+                          Eigen::RowMajor> S;                                   /**< The solution vectors, one row per point */
+
+            explicit GreensLimbDarkBatch(int lmax) :
+                    L(lmax),
+                    pow_ksq(STARRY_LD_BLOCK_SIZE, L.jvmax + 1),
+                    I(STARRY_LD_BLOCK_SIZE, L.ivmax + 1),
+                    J(STARRY_LD_BLOCK_SIZE, L.jvmax + 1),
+                    Sp(STARRY_LD_BLOCK_SIZE, lmax + 1),
+                    lmax(lmax) {
+                for (auto arr : {&b, &r, &ksq, &k, &kkc, &kap0, &invksq,
+                                 &bmr, &fourbr, &onembmr2, &sqonembmr2,
+                                 &Eofk, &Em1mKdm, &coeff, &res, &k2n,
+                                 &term, &mfbri, &mfbrj})
+                    arr->resize(STARRY_LD_BLOCK_SIZE);
+            }
+
+            inline void compute(const Vector<T>& b_, const Vector<T>& r_);
+
+    };
+
+    /**
+    Compute the `I` integrals for the current block,
+    whose points are all in regime `g`.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkBatch<T>::computeI(int g) {
+
+        int ivmax = L.ivmax;
+
+        if (g >= 2) {
+
+            // ksq >= 1
+            for (int v = 0; v <= ivmax; ++v)
+                I.col(v).head(len).setConstant(L.ivgamma[v]);
+            return;
+
+        }
+
+        // Powers of ksq
+        auto ksq_ = ksq.head(len);
+        auto kkc_ = kkc.head(len);
+        pow_ksq.col(0).head(len).setOnes();
+        for (int v = 1; v <= L.jvmax; ++v)
+            pow_ksq.col(v).head(len) = pow_ksq.col(v - 1).head(len) * ksq_;
+
+        if (g == 0) {
+
+            // Downward recursion; the series for I[ivmax]
+            // is summed until all points have converged
+            auto coeff_ = coeff.head(len);
+            auto res_ = res.head(len);
+            T tol = mach_eps<T>();
+            coeff_.setConstant(L.Icoeff(0));
+            res_ = coeff_;
+            int n = 1;
+            while ((coeff_.abs() > tol * ksq_).any()) {
+                if (n == STARRY_IJ_MAX_ITER)
+                    throw errors::ConvergenceError("Primitive integral "
+                                                   "`I` did not converge.");
+                coeff_ *= L.Icoeff(n) * ksq_;
+                res_ += coeff_;
+                ++n;
+            }
+            I.col(ivmax).head(len) = pow_ksq.col(ivmax).head(len) *
+                                     k.head(len) * res_;
+            for (int v = ivmax - 1; v >= 0; --v)
+                I.col(v).head(len) = (2.0 / (2 * v + 1)) *
+                    ((v + 1) * I.col(v + 1).head(len) +
+                     pow_ksq.col(v).head(len) * kkc_);
+
+        } else {
+
+            // Upward recursion
+            I.col(0).head(len) = kap0.head(len);
+            for (int v = 1; v <= ivmax; ++v)
+                I.col(v).head(len) = (0.5 * (2 * v - 1) * I.col(v - 1).head(len) -
+                                      pow_ksq.col(v - 1).head(len) * kkc_) / v;
+
+        }
+
+    }
+
+    /**
+    Evaluate the two highest order `J` integrals for the current
+    block, whose points are all in regime `g` (which must be 0 or 3),
+    from their Chebyshev fits or power series.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkBatch<T>::seriesJ(int g) {
+
+        auto x = (g == 0) ? ksq.head(len) : invksq.head(len);
+        auto k2n_ = k2n.head(len);
+        auto term_ = term.head(len);
+        auto res_ = res.head(len);
+        T tol = mach_eps<T>();
+
+        for (int j = 0; j < 2; ++j) {
+            int v = L.jvmax - j;
+            if (L.use_cheb) {
+                // Clenshaw evaluation of the piecewise Chebyshev fit.
+                // The points are sorted by `ksq`, so each piece is a
+                // contiguous segment of the block.
+                const std::vector<Vector<T>>& cheb = (g == 0) ? L.Jcheb_smallk : L.Jcheb_largek;
+                // Number of points in the first piece (`x < 1/8`); for
+                // `g = 0` they lead the block, for `g = 3` they trail it
+                int m = (x < 0.125).count();
+                int off0 = (g == 0) ? 0 : len - m;
+                int off1 = (g == 0) ? m : 0;
+                for (int piece = 0; piece < 2; ++piece) {
+                    int start = piece ? off1 : off0;
+                    int n = piece ? len - m : m;
+                    if (n == 0) continue;
+                    const Vector<T>& c = cheb[2 * j + piece];
+                    auto x_ = x.segment(start, n);
+                    auto t2_ = coeff.segment(start, n);
+                    auto b0 = res_.segment(start, n);
+                    auto b1 = k2n_.segment(start, n);
+                    auto b2 = term_.segment(start, n);
+                    if (piece)
+                        t2_ = 2 * (16 * x_ - 5) / 3;
+                    else
+                        t2_ = 2 * (16 * x_ - 1);
+                    b0.setZero();
+                    b1.setZero();
+                    for (int i = c.size() - 1; i >= 1; --i) {
+                        b2 = b1;
+                        b1 = b0;
+                        b0 = c(i) + t2_ * b1 - b2;
+                    }
+                    b0 = c(0) + 0.5 * t2_ * b0 - b1;
+                }
+            } else {
+                // Sum the series until all points have converged
+                const Vector<T>& c = (g == 0) ? L.Jcoeff_smallk[j] : L.Jcoeff_largek[j];
+                res_.setConstant(c(0));
+                k2n_.setOnes();
+                int n = 1;
+                do {
+                    if (n > STARRY_IJ_MAX_ITER)
+                        throw errors::ConvergenceError("Primitive integral "
+                                                       "`J` did not converge.");
+                    k2n_ *= x;
+                    term_ = k2n_ * c(n);
+                    res_ += term_;
+                    ++n;
+                } while ((term_.abs() >= tol * x).any());
+            }
+            if (g == 0)
+                J.col(v).head(len) = res_ * pow_ksq.col(v).head(len) * k.head(len);
+            else
+                J.col(v).head(len) = res_;
+        }
+
+    }
+
+    /**
+    Compute the `J` integrals for the current block,
+    whose points are all in regime `g`.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkBatch<T>::computeJ(int g) {
+
+        int jvmax = L.jvmax;
+        auto ksq_ = ksq.head(len);
+        auto invksq_ = invksq.head(len);
+
+        if ((g == 0) || (g == 3)) {
+
+            // Downward recursion
+            seriesJ(g);
+            for (int v = jvmax - 2; v >= 0; --v) {
+                if (g == 0) {
+                    J.col(v).head(len) =
+                        (2 * (3 + v + ksq_ * (1 + v)) * J.col(v + 1).head(len) -
+                         (2 * v + 7) * J.col(v + 2).head(len)) /
+                        (ksq_ * (2 * v + 1));
+                } else {
+                    J.col(v).head(len) =
+                        (2. / (2. * v + 1)) * ((3 + v) * invksq_ + 1 + v) *
+                        J.col(v + 1).head(len) -
+                        (2. * v + 7) / (2. * v + 1) * invksq_ *
+                        J.col(v + 2).head(len);
+                }
+            }
+
+        } else {
+
+            // Upward recursion
+            auto k_ = k.head(len);
+            auto E = Eofk.head(len);
+            auto EK = Em1mKdm.head(len);
+            if (g == 1) {
+                J.col(0).head(len) = 2.0 / (3.0 * k_) *
+                    ((3.0 * ksq_ - 2.0) * EK + E);
+                J.col(1).head(len) = 2.0 / (15.0 * k_) *
+                    ((4.0 - 3.0 * ksq_) * E + (9.0 * ksq_ - 8) * EK);
+            } else {
+                J.col(0).head(len) = (2.0 / 3.0) *
+                    ((3.0 - 2.0 * invksq_) * E + invksq_ * EK);
+                J.col(1).head(len) = 0.4 * (1.0 / 3.0) *
+                    ((-3.0 + 4.0 * invksq_) * EK + (9.0 - 8.0 * invksq_) * E);
+            }
+            for (int v = 2; v <= jvmax; ++v)
+                J.col(v).head(len) =
+                    (2 * (v + (v - 1) * ksq_ + 1) * J.col(v - 1).head(len) -
+                     ksq_ * (2 * v - 3) * J.col(v - 2).head(len)) / (2 * v + 3);
+
+        }
+
+    }
+
+    /**
+    Compute the higher order terms of the solution
+    vector for the current block.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkBatch<T>::computeS() {
+        int n0, nmi;
+        auto b_ = b.head(len);
+        auto ksq_ = ksq.head(len);
+        auto bmr_ = bmr.head(len);
+        auto fourbr_ = fourbr.head(len);
+        auto k2n_ = k2n.head(len);
+        auto pofgn_ = res.head(len);
+        auto mfbri_ = mfbri.head(len);
+        auto mfbrj_ = mfbrj.head(len);
+        mfbri_ = -fourbr_;
+        mfbrj_.setOnes();
+        for (int n = 2; n < lmax + 1; ++n) {
+            const Array2& IJ = is_even(n) ? I : J;
+            if (is_even(n)) {
+                n0 = n / 2;
+                k2n_ = mfbri_;
+                mfbri_ *= -fourbr_;
+            } else {
+                n0 = (n - 3) / 2;
+                k2n_ = mfbrj_;
+                mfbrj_ *= -fourbr_;
+            }
+            pofgn_ = k2n_ * (-bmr_ * IJ.col(n0).head(len) +
+                             2 * b_ * IJ.col(n0 + 1).head(len));
+            for (int i = 1; i < n0 + 1; ++i) {
+                nmi = n0 - i;
+                k2n_ *= -ksq_;
+                pofgn_ += tables::choose<T>(n0, i) * k2n_ *
+                          (-bmr_ * IJ.col(nmi).head(len) +
+                           2 * b_ * IJ.col(nmi + 1).head(len));
+            }
+            if (is_even(n))
+                Sp.col(n).head(len) = -2 * r.head(len) * pofgn_;
+            else
+                Sp.col(n).head(len) = -2 * r.head(len) * pofgn_ *
+                    onembmr2.head(len) * sqonembmr2.head(len);
+        }
+    }
+
+    /**
+    Compute the `s^T` occultation solution vector at each
+    of the points `(b_(i), r_(i))`.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkBatch<T>::compute(const Vector<T>& b_,
+                                                const Vector<T>& r_) {
+
+        STARRY_PROFILE_SCOPE(profile::GREENS_LD);
+        int npts = b_.size();
+        S.resize(npts, lmax + 1);
+
+        // Compute the low order terms one point at a time and
+        // figure out which recursion regime each point is in:
+        //   0: ksq < 0.5        (I and J downward)
+        //   1: 0.5 <= ksq < 1   (I and J upward)
+        //   2: 1 <= ksq <= 2    (I constant, J upward)
+        //   3: ksq > 2          (I constant, J downward)
+        regime.resize(npts);
+        ksqs.resize(npts);
+        vars.resize(npts, 13);
+        int count[4] = {0, 0, 0, 0};
+        for (int i = 0; i < npts; ++i) {
+            if (L.computeLowOrder(b_(i), r_(i))) {
+                S.row(i) = L.S;
+                regime[i] = -1;
+                continue;
+            } else if (L.ksq != L.ksq) {
+                // A NaN `b` or `r`: keep it out of the sort below
+                S.row(i).setConstant(T(NAN));
+                regime[i] = -1;
+                continue;
+            } else if (L.ksq < 0.5) {
+                regime[i] = 0;
+            } else if (L.ksq < 1) {
+                regime[i] = 1;
+            } else if (L.ksq <= 2) {
+                regime[i] = 2;
+            } else {
+                regime[i] = 3;
+            }
+            ++count[regime[i]];
+            S(i, 0) = L.S(0);
+            S(i, 1) = L.S(1);
+            ksqs[i] = L.ksq;
+            vars.row(i) << L.b, L.r, L.ksq, L.k, L.kkc, L.kap0, L.invksq,
+                           L.bmr, L.fourbr, L.onembmr2, L.sqonembmr2,
+                           L.Eofk, L.Em1mKdm;
+        }
+
+        // Sort the points by regime, and by ksq within each regime
+        // so that the points in a block need a similar number of
+        // terms in the series for the highest order integrals
+        int group[5] = {0, 0, 0, 0, 0};
+        for (int g = 0; g < 4; ++g)
+            group[g + 1] = group[g] + count[g];
+        order.resize(group[4]);
+        int pos[4] = {group[0], group[1], group[2], group[3]};
+        for (int i = 0; i < npts; ++i) {
+            if (regime[i] >= 0)
+                order[pos[regime[i]]++] = i;
+        }
+        for (int g = 0; g < 4; g += 3) {
+            std::sort(order.begin() + group[g], order.begin() + group[g + 1],
+                      [this](int i, int j) { return ksqs[i] < ksqs[j]; });
+        }
+
+        // Compute the I and J integrals and the higher
+        // order terms one block of points at a time
+        Array* arrs[13] = {&b, &r, &ksq, &k, &kkc, &kap0, &invksq, &bmr,
+                           &fourbr, &onembmr2, &sqonembmr2, &Eofk, &Em1mKdm};
+        for (int g = 0; g < 4; ++g) {
+            for (int start = group[g]; start < group[g + 1];
+                 start += STARRY_LD_BLOCK_SIZE) {
+                len = std::min(STARRY_LD_BLOCK_SIZE, group[g + 1] - start);
+                for (int j = 0; j < len; ++j) {
+                    for (int q = 0; q < 13; ++q)
+                        (*arrs[q])(j) = vars(order[start + j], q);
+                }
+                computeI(g);
+                computeJ(g);
+                computeS();
+                for (int j = 0; j < len; ++j)
+                    S.block(order[start + j], 2, 1, lmax - 1) =
+                        Sp.block(j, 2, 1, lmax - 1).matrix();
+            }
+        }
+
+    }
+
+    /**
+    Interpolation table for the limb darkening solution vector `S`
+    at a fixed occultor radius `r0`. The table spans the range of
+    impact parameters over which the occultor partially covers the
+    body and stores `S`, `dS / db` and `dS / dr` at a set of nodes.
+    Lookups use piecewise cubic Hermite interpolation in `b`, plus a
+    first order correction in `r - r0`, so the table remains usable
+    while the radius changes by less than `dr`.
+
+    The nodes are placed by recursive bisection, starting from
+    `STARRY_LD_TABLE_INIT_NODES` uniformly spaced nodes between each
+    pair of contact points, until the Hermite interpolant matches the
+    exact solution at the midpoint of every interval to within `tol`
+    (or until `STARRY_LD_TABLE_MAX_DEPTH` bisections). The solution
+    has square root singularities in its derivatives at the contact
+    points, so the nodes cluster there.
+
+    */
+    template <class T>
+    class GreensLimbDarkTable {
+
+        protected:
+
+            std::vector<T> bnode;                                               /**< Impact parameter at each node */
+            std::vector<VectorT<T>> Snode;                                      /**< Solution vector at each node */
+            std::vector<VectorT<T>> dSdbnode;                                   /**< Derivative of `S` w/ respect to `b` at each node */
+            std::vector<VectorT<T>> dSdrnode;                                   /**< Derivative of `S` w/ respect to `r` at each node */
+            VectorT<T> S_, dSdb_, dSdr_;                                        /**< Scratch node */
+            bool built;                                                         /**< Is the table up to date? */
+
+            inline void node(GreensLimbDark<T>& L, const T& b);
+            inline void push(const T& b, const VectorT<T>& S0,
+                             const VectorT<T>& dSdb0, const VectorT<T>& dSdr0);
+            inline void refine(GreensLimbDark<T>& L, const T& b1,
+                               const VectorT<T>& S1, const VectorT<T>& dSdb1,
+                               const VectorT<T>& dSdr1, int depth);
+
+        public:
+
+            const int lmax;                                                     /**< The highest degree of the limb darkening */
+            T r0;                                                               /**< The occultor radius of the table */
+            T tol;                                                              /**< Interpolation tolerance */
+            T dr;                                                               /**< Change in `r` before the table is rebuilt */
+            VectorT<T> S;                                                       /**< The solution vector */
+
+            //! Constructor
+            explicit GreensLimbDarkTable(int lmax) :
+                built(false),
+                lmax(lmax),
+                r0(0),
+                tol(0),
+                dr(0),
+                S(VectorT<T>::Zero(lmax + 1)) { }
+
+            //! Flag the table for rebuilding
+            inline void reset() { built = false; }
+
+            //! Number of nodes in the table
+            inline int size() const { return bnode.size(); }
+
+            inline void build(GreensLimbDark<T>& L, const T& r);
+            inline void compute(GreensLimbDark<T>& L, const T& b, const T& r);
+
+    };
+
+    /**
+    Compute the solution and its derivatives at `b` for the
+    current table radius with the solver `L` and store them in
+    the scratch node.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkTable<T>::node(GreensLimbDark<T>& L,
+                                             const T& b) {
+        if (b >= 1 + r0) {
+            // No occultation: the flux of the unocculted disk
+            S_.setZero(lmax + 1);
+            S_(0) = pi<T>();
+            if (lmax > 0)
+                S_(1) = 2 * pi<T>() / 3;
+            dSdb_.setZero(lmax + 1);
+            dSdr_.setZero(lmax + 1);
+        } else if (b <= r0 - 1) {
+            // Complete occultation
+            S_.setZero(lmax + 1);
+            dSdb_.setZero(lmax + 1);
+            dSdr_.setZero(lmax + 1);
+        } else {
+            L.compute(b, r0, true);
+            S_ = L.S;
+            dSdb_ = L.dSdb;
+            dSdr_ = L.dSdr;
+        }
+    }
+
+    /**
+    Append a node to the table.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkTable<T>::push(const T& b, const VectorT<T>& S0,
+                                             const VectorT<T>& dSdb0,
+                                             const VectorT<T>& dSdr0) {
+        bnode.push_back(b);
+        Snode.push_back(S0);
+        dSdbnode.push_back(dSdb0);
+        dSdrnode.push_back(dSdr0);
+    }
+
+    /**
+    Append the nodes needed between the last node in the table and
+    the node `(b1, S1, dSdb1, dSdr1)`, bisecting the interval until
+    the Hermite interpolant is accurate to within `tol` at the
+    midpoint of every sub-interval. The midpoint is always kept,
+    since we have computed it anyway.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkTable<T>::refine(GreensLimbDark<T>& L,
+                                               const T& b1,
+                                               const VectorT<T>& S1,
+                                               const VectorT<T>& dSdb1,
+                                               const VectorT<T>& dSdr1,
+                                               int depth) {
+        int i0 = size() - 1;
+        T h = b1 - bnode[i0];
+        T b = bnode[i0] + 0.5 * h;
+        node(L, b);
+        VectorT<T> Sm = S_, dSdbm = dSdb_, dSdrm = dSdr_;
+        bool done = (depth >= STARRY_LD_TABLE_MAX_DEPTH) ||
+                    ((0.5 * (Snode[i0] + S1) +
+                      0.125 * h * (dSdbnode[i0] - dSdb1) -
+                      Sm).cwiseAbs().maxCoeff() <= tol);
+        if (!done) refine(L, b, Sm, dSdbm, dSdrm, depth + 1);
+        push(b, Sm, dSdbm, dSdrm);
+        if (!done) refine(L, b1, S1, dSdb1, dSdr1, depth + 1);
+    }
+
+    /**
+    Build the table for occultor radius `r` with the solver `L`.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkTable<T>::build(GreensLimbDark<T>& L,
+                                              const T& r) {
+
+        if (!(tol > 0))
+            throw errors::ValueError("The interpolation tolerance "
+                                     "must be positive.");
+        r0 = r;
+        bnode.clear();
+        Snode.clear();
+        dSdbnode.clear();
+        dSdrnode.clear();
+
+        // The contact points split the range into smooth segments
+        T lo = (r0 > 1) ? T(r0 - 1) : T(0);
+        T hi = 1 + r0;
+        std::vector<T> edges{lo, hi};
+        if ((abs(1 - r0) > lo) && (abs(1 - r0) < hi))
+            edges.push_back(abs(1 - r0));
+        if ((r0 > lo) && (r0 < hi) && (r0 != abs(1 - r0)))
+            edges.push_back(r0);
+        std::sort(edges.begin(), edges.end());
+
+        // Start from uniformly spaced nodes in each segment and refine
+        const int ninit = STARRY_LD_TABLE_INIT_NODES;
+        node(L, lo);
+        push(lo, S_, dSdb_, dSdr_);
+        for (size_t e = 0; e < edges.size() - 1; ++e) {
+            for (int i = 1; i <= ninit; ++i) {
+                T b = (i == ninit) ? edges[e + 1] :
+                      T(edges[e] + (edges[e + 1] - edges[e]) * i / ninit);
+                node(L, b);
+                VectorT<T> S1 = S_, dSdb1 = dSdb_, dSdr1 = dSdr_;
+                refine(L, b, S1, dSdb1, dSdr1, 0);
+                push(b, S1, dSdb1, dSdr1);
+            }
+        }
+
+        built = true;
+
+    }
+
+    /**
+    Compute the solution vector at `(b, r)` from the table, rebuilding
+    it first with the solver `L` if `r` differs from the table radius by
+    more than `dr`. Points outside the range of the table use the exact
+    solution.
+
+    */
+    template <class T>
+    inline void GreensLimbDarkTable<T>::compute(GreensLimbDark<T>& L,
+                                                const T& b, const T& r) {
+        STARRY_PROFILE_SCOPE(profile::GREENS_LD);
+        bool hit = built && !(abs(r - r0) > dr);
+        STARRY_PROFILE_CACHE(profile::LD_TABLE, hit);
+        if (!hit)
+            build(L, r);
+        if ((b < bnode.front()) || (b > bnode.back())) {
+            S.setZero();
+            if (b >= 1 + r) {
+                S(0) = pi<T>();
+                if (lmax > 0)
+                    S(1) = 2 * pi<T>() / 3;
+            } else if (b > r - 1) {
+                L.compute(b, r);
+                S = L.S;
+            }
+            return;
+        }
+        int i = std::upper_bound(bnode.begin(), bnode.end(), b) -
+                bnode.begin() - 1;
+        if (i >= size() - 1) i = size() - 2;
+        T h = bnode[i + 1] - bnode[i];
+        T t = (b - bnode[i]) / h;
+        T t2 = t * t;
+        T t3 = t2 * t;
+        T h00 = 2 * t3 - 3 * t2 + 1;
+        T h10 = t3 - 2 * t2 + t;
+        T h01 = 1 - h00;
+        T h11 = t3 - t2;
+        T delta = r - r0;
+        S = h00 * Snode[i] + h01 * Snode[i + 1] +
+            h * (h10 * dSdbnode[i] + h11 * dSdbnode[i + 1]);
+        if (delta != 0)
+            S += delta * ((1 - t) * dSdrnode[i] + t * dSdrnode[i + 1]);
+    }
+
 } // namespace limbdark
 } // namespace starry
 
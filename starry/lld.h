@@ -11,6 +11,7 @@ Linear limb darkening (s2) integration utilities.
 #include <Eigen/Core>
 #include "ellip.h"
 #include "errors.h"
+#include "profile.h"
 
 namespace starry {
 
@@ -39,18 +40,24 @@ namespace lld {
     */
     template <typename T>
     inline bool s2_unstable(const T& b, const T& r) {
-        if (r > 1)
+        if (r > 1) {
+            STARRY_PROFILE_BRANCH(profile::S2_R_GT_ONE);
             return true;
-        else if (abs(b - r) < STARRY_EPS_BMR_ZERO)
+        } else if (abs(b - r) < STARRY_EPS_BMR_ZERO) {
+            STARRY_PROFILE_BRANCH(profile::S2_BMR_ZERO);
             return true;
-        else if ((abs(b - r) > 1 - STARRY_EPS_BMR_ONE) &&
-                 (abs(b - r) < 1 + STARRY_EPS_BMR_ONE))
+        } else if ((abs(b - r) > 1 - STARRY_EPS_BMR_ONE) &&
+                   (abs(b - r) < 1 + STARRY_EPS_BMR_ONE)) {
+            STARRY_PROFILE_BRANCH(profile::S2_BMR_ONE);
             return true;
-        else if ((abs(b + r) > 1 - STARRY_EPS_BPR_ONE) &&
-                 (abs(b + r) < 1 + STARRY_EPS_BPR_ONE))
+        } else if ((abs(b + r) > 1 - STARRY_EPS_BPR_ONE) &&
+                   (abs(b + r) < 1 + STARRY_EPS_BPR_ONE)) {
+            STARRY_PROFILE_BRANCH(profile::S2_BPR_ONE);
             return true;
-        else
+        } else {
+            STARRY_PROFILE_BRANCH(profile::S2_STABLE);
             return false;
+        }
     }
 
     /**
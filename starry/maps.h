@@ -32,6 +32,8 @@ TODO: Speed up limb-darkened map rotations, since
 #include <Eigen/Core>
 #include <type_traits>
 #include <vector>
+#include <map>
+#include <atomic>
 #include "rotation.h"
 #include "basis.h"
 #include "errors.h"
@@ -41,6 +43,7 @@ TODO: Speed up limb-darkened map rotations, since
 #include "sturm.h"
 #include "minimize.h"
 #include "numeric.h"
+#include "approx.h"
 
 namespace starry {
 namespace kepler {
@@ -59,13 +62,16 @@ namespace maps {
     using std::to_string;
     using rotation::Wigner;
     using basis::Basis;
-    using basis::polymul;
+    using basis::PolyMul;
     using solver::Greens;
     using limbdark::GreensLimbDark;
+    using limbdark::GreensLimbDarkBatch;
+    using limbdark::GreensLimbDarkTable;
     using limbdark::computeC;
     using limbdark::normC;
     using solver::Power;
     using minimize::Minimizer;
+    using approx::SmallPlanet;
 
     // Forward-declare some stuff
     template <class T> class Map;
@@ -109,12 +115,11 @@ namespace maps {
     class Temporary {
 
             static constexpr int TLEN = 6;
-            static constexpr int RLEN = 4;
+            static constexpr int RLEN = 5;
             static constexpr int CLEN = 1;
-            static constexpr int VLEN = 1;
-            static constexpr int VTLEN = 8;
+            static constexpr int VLEN = 3;
+            static constexpr int VTLEN = 12;
             static constexpr int MLEN = 2;
-            static constexpr int VTMLEN = 1;
             static constexpr int ALEN = 2;
             static constexpr int PLEN = 2;
             static constexpr int PALEN = 2;
@@ -127,8 +132,7 @@ namespace maps {
             Vector<Scalar<T>> tmpColumnVector[VLEN];
             VectorT<Scalar<T>> tmpRowVector[VTLEN];
             Matrix<Scalar<T>> tmpMatrix[MLEN];
-            VectorT<Matrix<Scalar<T>>> tmpRowVectorOfMatrices[VTMLEN];
-            ADScalar<Scalar<T>, 2> tmpADScalar2[ALEN];
+            ADScalar<SolverScalar<T>, 2> tmpADScalar2[ALEN];
             Power<Scalar<T>> tmpPower[PLEN];
             Power<ADScalar<Scalar<T>, 2>> tmpPowerOfADScalar2[PALEN];
 
@@ -203,10 +207,14 @@ namespace maps {
             UnitVector<Scalar<T>> axis;                                         /**< The axis of rotation for the map */
             Basis<Scalar<T>> B;                                                 /**< Basis transform stuff */
             Wigner<T> W;                                                        /**< The class controlling rotations */
-            Greens<Scalar<T>> G;                                                /**< The occultation integral solver class */
-            Greens<ADScalar<Scalar<T>, 2>> G_grad;                              /**< The occultation integral solver class w/ AutoDiff capability */
+            Greens<SolverScalar<T>> G;                                          /**< The occultation integral solver class */
+            Greens<ADScalar<SolverScalar<T>, 2>> G_grad;                        /**< The occultation integral solver class w/ AutoDiff capability */
             GreensLimbDark<Scalar<T>> L;                                        /**< The occultation integral solver class (optimized for limb darkening) */
+            GreensLimbDarkBatch<Scalar<T>> LB;                                  /**< Batched version of `L` for timeseries */
+            GreensLimbDarkTable<Scalar<T>> LT;                                  /**< Interpolation table for `L` at fixed occultor radius */
             Minimizer<T> M;                                                     /**< Map minimization class */
+            SmallPlanet<Scalar<T>> SP;                                          /**< Small-occultor expansion of the flux */
+            Scalar<T> approx_tol;                                               /**< Tolerance of the small-occultor expansion (disabled if zero) */
             Scalar<T> tol;                                                      /**< Machine epsilon */
             std::vector<string> dF_orbital_names;                               /**< Names of each of the orbital params in the flux gradient */
             std::vector<string> dF_ylm_names;                                   /**< Names of each of the Ylm params in the flux gradient */
@@ -224,8 +232,20 @@ namespace maps {
             Vector<Matrix<Scalar<T>>> dp_udu;                                   /**< Deriv of limb darkening polynomial w/ respect to limb darkening coeffs */
             Vector<Matrix<Scalar<T>>> dg_udu;                                   /**< Deriv of limb darkening Green's polynomials w/ respect to limb darkening coeffs */
             Vector<Matrix<Scalar<T>>> dagol_cdu;                                /**< Deriv of Agol `c` coeffs w/ respect to the limb darkening ceoffs */
-            VectorT<Matrix<Scalar<T>>> dLDdp;                                   /**< Derivative of the limb-darkened polynomial w.r.t `p` */
-            VectorT<Matrix<Scalar<T>>> dLDdp_u;                                 /**< Derivative of the limb-darkened polynomial w.r.t `p_u` */
+            PolyMul ld_mul;                                                     /**< Product table for limb-darkening a polynomial map */
+            PolyMul ld_mul_dp;                                                  /**< Product table for the derivative w.r.t. `p` */
+            PolyMul ld_mul_dp_u;                                                /**< Product table for the derivative w.r.t. `p_u` */
+            PolyMul ld_mul_op;                                                  /**< Product table for `ld_op` */
+            T dLD_p;                                                            /**< The last polynomial map limb-darkened with gradients */
+            Row<T> dLD_norm;                                                    /**< Its limb darkening normalization */
+            T dLD_u;                                                            /**< Its unnormalized limb-darkened map over its flux */
+            T dLD_c;                                                            /**< Rank-one part of the derivative w.r.t. `p` */
+            T dLD_c_u;                                                          /**< Rank-one part of the derivative w.r.t. `p_u` */
+            Vector<Matrix<Scalar<T>>> ld_op;                                    /**< Fused operator `A1^-1 . P_u . A1` in each wavelength bin */
+            Matrix<Scalar<T>> rTA1ld_op;                                        /**< The rows `r^T . A1 . ld_op` for each wavelength bin */
+            T ld_op_u;                                                          /**< The limb darkening coefficients `ld_op` was computed for */
+            int ld_op_deg;                                                      /**< Degree of the maps `ld_op` acts on (-1 if not computed) */
+            T ld_u_last;                                                        /**< The limb darkening coefficients at the previous call to `useLDOperator` */
             T p_uy;                                                             /**< The instantaneous limb-darkened map in the polynomial basis */
             Row<T> ld_norm;
 
@@ -234,18 +254,32 @@ namespace maps {
             Cache<T> cache;
             bool update_p_u_derivs;
             bool update_c_basis;
+            int batch_depth;                                                    /**< Nesting depth of `beginBatch()` calls */
+            bool batch_update_y;                                                /**< Did the Ylm coefficients change during the batch? */
+            bool batch_update_u;                                                /**< Did the limb darkening coefficients change during the batch? */
 
             // Private methods
             void update();
             inline void resizeGradient(const int n_ylm, const int n_ul);
             inline void checkDegree();
             inline void updateY();
+            inline void updateY(int l, int m, const Row<T>& dy);
             inline void updateU();
             inline void limbDarken(const T& poly, T& poly_ld,
                 bool gradient=false);
+            inline void dLDdpDot(int n, const Vector<Scalar<T>>& x,
+                Vector<Scalar<T>>& result);
+            inline void dotdLDdp(int n, const VectorT<Scalar<T>>& v,
+                VectorT<Scalar<T>>& result);
+            inline bool useLDOperator(int deg);
+            inline void updateLDOperator(int deg);
+            inline void limbDarkenYlm(T& Ry);
+            inline void dotdLDdp_u(int n, const VectorT<Scalar<T>>& v,
+                VectorT<Scalar<T>>& result);
             template <typename U>
             inline void polyBasis(Power<U>& xpow, Power<U>& ypow,
                 VectorT<U>& basis);
+            inline void polyMap(const Scalar<T>& theta, T& A1Ry);
             inline Row<T> fluxWithGradient(const Scalar<T>& theta_deg,
                 const Scalar<T>& xo_,
                 const Scalar<T>& yo_,
@@ -253,6 +287,10 @@ namespace maps {
             inline Row<T> fluxLD(const Scalar<T>& xo_,
                 const Scalar<T>& yo_,
                 const Scalar<T>& ro_);
+            inline void fluxLD(const VectorRef<Scalar<T>>& xo,
+                const VectorRef<Scalar<T>>& yo,
+                const VectorRef<Scalar<T>>& ro,
+                MapRef<T> result);
             inline Row<T> fluxLDWithGradient(const Scalar<T>& xo_,
                 const Scalar<T>& yo_,
                 const Scalar<T>& ro_);
@@ -260,6 +298,11 @@ namespace maps {
                 const Scalar<T>& xo_,
                 const Scalar<T>& yo_,
                 const Scalar<T>& ro_);
+            inline bool fluxApprox(const T& poly,
+                const Scalar<T>& xo,
+                const Scalar<T>& yo,
+                const Scalar<T>& ro,
+                Row<T>& result);
             inline Row<T> fluxConstant(const Scalar<T>& xo_,
                 const Scalar<T>& yo_,
                 const Scalar<T>& ro_);
@@ -282,7 +325,11 @@ namespace maps {
                 G(lmax),
                 G_grad(lmax),
                 L(lmax),
+                LB(lmax),
+                LT(lmax),
                 M(lmax),
+                SP(lmax),
+                approx_tol(0),
                 tol(mach_eps<Scalar<T>>()),
                 dp_udu(nwav),
                 dg_udu(nwav),
@@ -319,12 +366,18 @@ namespace maps {
                 g_u.resize(N, nwav);
 
                 // Reset & update the map coeffs
+                ld_op_deg = -1;
+                batch_depth = 0;
+                batch_update_y = false;
+                batch_update_u = false;
                 reset();
 
             }
 
             // Housekeeping and I/O
             void reset();
+            void beginBatch();
+            void endBatch();
             void setY(const T& y_);
             void setY(int l, int m, const Row<T>& coeff);
             T getY() const;
@@ -339,6 +392,12 @@ namespace maps {
             virtual VectorT<Scalar<T>> getS() const;
             void setAxis(const UnitVector<Scalar<T>>& axis_);
             UnitVector<Scalar<T>> getAxis() const;
+            void setApproxTol(const Scalar<T>& tol_);
+            Scalar<T> getApproxTol() const;
+            void setTableTol(const Scalar<T>& tol_);
+            Scalar<T> getTableTol() const;
+            void setTableDr(const Scalar<T>& dr_);
+            Scalar<T> getTableDr() const;
             virtual std::string info();
             inline void resizeGradient();
             const T& getGradient() const;
@@ -352,6 +411,19 @@ namespace maps {
                 const Scalar<T>& x_=0,
                 const Scalar<T>& y_=0);
 
+            // Evaluate the intensity at many points
+            void evaluate(const VectorRef<Scalar<T>>& theta,
+                const VectorRef<Scalar<T>>& x,
+                const VectorRef<Scalar<T>>& y,
+                MapRef<T> result,
+                int nthreads=0);
+
+            // Render the intensity on a pixel grid
+            void render(const Vector<Scalar<T>>& theta,
+                int res,
+                Matrix<Scalar<T>>& image,
+                int nthreads=0);
+
             // Compute the flux
             inline Row<T> flux(const Scalar<T>& theta_=0,
                 const Scalar<T>& xo_=0,
@@ -360,9 +432,52 @@ namespace maps {
                 bool gradient=false,
                 bool numerical=false);
 
+            // Compute the flux for a timeseries
+            inline void flux(const VectorRef<Scalar<T>>& theta,
+                const VectorRef<Scalar<T>>& xo,
+                const VectorRef<Scalar<T>>& yo,
+                const VectorRef<Scalar<T>>& ro,
+                MapRef<T> result,
+                bool numerical=false);
+
+            // Does the timeseries `flux` compute all points at once?
+            inline bool batchedFlux(bool numerical=false) const;
+
             // Is the map physical?
             inline RowBool<T> isPhysical(const Scalar<T>& epsilon=1.e-6,
-                const int max_iterations=100);
+                const int max_iterations=100,
+                const int restarts=STARRY_MIN_RESTARTS,
+                const int nthreads=1);
+
+    };
+
+    /**
+    A batch of coefficient updates that ends when it goes out of scope,
+    so that the map is brought up to date even if one of the setters
+    throws.
+
+    */
+    template <class T>
+    class ScopedBatch {
+
+            Map<T>& map;
+
+        public:
+
+            explicit ScopedBatch(Map<T>& map) : map(map) {
+                map.beginBatch();
+            }
+
+            ~ScopedBatch() noexcept(false) {
+                if (std::uncaught_exception()) {
+                    // Don't mask the original error
+                    try {
+                        map.endBatch();
+                    } catch (...) {}
+                } else {
+                    map.endBatch();
+                }
+            }
 
     };
 
@@ -411,6 +526,34 @@ namespace maps {
         cache.clear();
     }
 
+    /**
+    Update the Ylm map after only the (l, m) coefficient changed by `dy`.
+    Since the change of basis is linear, we add the corresponding columns
+    of `A1` and `A` times `dy` and only update degree `l` in the
+    rotation frame.
+
+    */
+    template <class T>
+    inline void Map<T>::updateY(int l, int m, const Row<T>& dy) {
+        // Check the map degree is valid
+        checkDegree();
+
+        // Update the polynomial and Green's map coefficients
+        int n = l * l + l + m;
+        for (typename Eigen::SparseMatrix<Scalar<T>>::InnerIterator
+                it(B.A1, n); it; ++it)
+            setRow(p, it.row(), Row<T>(getRow(p, it.row()) + it.value() * dy));
+        for (typename Eigen::SparseMatrix<Scalar<T>>::InnerIterator
+                it(B.A, n); it; ++it)
+            setRow(g, it.row(), Row<T>(getRow(g, it.row()) + it.value() * dy));
+
+        // Update the rotation matrix
+        W.updateY(l);
+
+        // Clear the cache
+        cache.clear();
+    }
+
     /**
     Update the limb darkening map after the coefficients changed
     TODO: This method needs to be made as fast as possible.
@@ -478,6 +621,38 @@ namespace maps {
         update();
     }
 
+    /**
+    Begin a batch of coefficient updates. Until the matching call to
+    `endBatch()`, the coefficient setters only store the new values,
+    and all derived quantities are recomputed once at the end.
+    Batches may be nested.
+
+    */
+    template <class T>
+    void Map<T>::beginBatch() {
+        ++batch_depth;
+    }
+
+    /**
+    End a batch of coefficient updates
+
+    */
+    template <class T>
+    void Map<T>::endBatch() {
+        if (batch_depth == 0)
+            throw errors::ValueError("No batch update in progress.");
+        if (--batch_depth > 0)
+            return;
+        bool update_y = batch_update_y;
+        bool update_u = batch_update_u;
+        batch_update_y = false;
+        batch_update_u = false;
+        if (update_y)
+            update();
+        else if (update_u)
+            updateU();
+    }
+
     /**
     Public workaround to resize the gradients
     prior to a flux evaluation, so that we know
@@ -529,6 +704,10 @@ namespace maps {
                     break;
                 }
             }
+            if (batch_depth > 0) {
+                batch_update_y = true;
+                return;
+            }
             // Note that we must implicitly call `updateU()` as well
             // because its normalization depends on Y_{0,0}!
             update();
@@ -545,23 +724,31 @@ namespace maps {
     void Map<T>::setY(int l, int m, const Row<T>& coeff) {
         if ((0 <= l) && (l <= lmax) && (-l <= m) && (m <= l)) {
             int n = l * l + l + m;
+            Row<T> dy = coeff - getRow(y, n);
             setRow(y, n, coeff);
             if (allZero(coeff)) {
-                // If coeff is zero, we need to re-compute y_deg
-                for (y_deg = l - 1; y_deg >= 0; --y_deg) {
-                    for (int m = -y_deg; m < y_deg + 1; ++m){
-                        if (!allZero(getRow(y, y_deg * y_deg + y_deg + m))) {
-                            update();
-                            return;
-                        }
+                // If coeff is zero and of the highest degree,
+                // we need to re-compute y_deg
+                if (l == y_deg) {
+                    for (y_deg = l; y_deg > 0; --y_deg) {
+                        if ((y.block(y_deg * y_deg, 0, 2 * y_deg + 1, nwav).
+                                array() != 0.0).any())
+                            break;
                     }
                 }
             } else {
                 y_deg = max(y_deg, l);
             }
+            if (batch_depth > 0) {
+                batch_update_y = true;
+                return;
+            }
+            updateY(l, m, dy);
             // Note that we must implicitly call `updateU()` as well
             // because its normalization depends on Y_{0,0}!
-            update();
+            if (n == 0)
+                updateU();
+            G.skip.setZero();
         } else {
             throw errors::IndexError("Invalid value for `l` and/or `m`.");
         }
@@ -603,6 +790,10 @@ namespace maps {
                     break;
                 }
             }
+            if (batch_depth > 0) {
+                batch_update_u = true;
+                return;
+            }
             updateU();
         } else {
             throw errors::ValueError("Dimension mismatch in `u`.");
@@ -627,6 +818,10 @@ namespace maps {
             } else {
                 u_deg = max(u_deg, l);
             }
+            if (batch_depth > 0) {
+                batch_update_u = true;
+                return;
+            }
             updateU();
         } else {
             throw errors::IndexError("Invalid value for `l`.");
@@ -687,7 +882,7 @@ namespace maps {
     */
     template <class T>
     VectorT<Scalar<T>> Map<T>::getS() const {
-        return G.sT;
+        return G.sT.template cast<Scalar<T>>();
     }
 
     /**
@@ -722,6 +917,70 @@ namespace maps {
         return axis;
     }
 
+    /**
+    Set the tolerance of the small-occultor expansion of the flux
+
+    */
+    template <class T>
+    void Map<T>::setApproxTol(const Scalar<T>& tol_) {
+        if (tol_ < 0)
+            throw errors::ValueError("The tolerance must be non-negative.");
+        approx_tol = tol_;
+    }
+
+    /**
+    Get the tolerance of the small-occultor expansion of the flux
+
+    */
+    template <class T>
+    Scalar<T> Map<T>::getApproxTol() const {
+        return approx_tol;
+    }
+
+    /**
+    Set the tolerance of the limb darkening interpolation table
+
+    */
+    template <class T>
+    void Map<T>::setTableTol(const Scalar<T>& tol_) {
+        if (tol_ < 0)
+            throw errors::ValueError("The tolerance must be non-negative.");
+        LT.tol = tol_;
+        LT.reset();
+    }
+
+    /**
+    Get the tolerance of the limb darkening interpolation table
+
+    */
+    template <class T>
+    Scalar<T> Map<T>::getTableTol() const {
+        return LT.tol;
+    }
+
+    /**
+    Set the change in occultor radius that triggers a
+    rebuild of the limb darkening interpolation table
+
+    */
+    template <class T>
+    void Map<T>::setTableDr(const Scalar<T>& dr_) {
+        if (dr_ < 0)
+            throw errors::ValueError("The radius change must be non-negative.");
+        LT.dr = dr_;
+        LT.reset();
+    }
+
+    /**
+    Get the change in occultor radius that triggers a
+    rebuild of the limb darkening interpolation table
+
+    */
+    template <class T>
+    Scalar<T> Map<T>::getTableDr() const {
+        return LT.dr;
+    }
+
     /**
     Resize the gradient vector and set the string vector of gradient names
 
@@ -791,21 +1050,33 @@ namespace maps {
     gradient of the resulting map with respect to the input
     polynomial map and the input limb-darkening map.
 
+    The gradients are not stored as dense matrices. Writing `G` and
+    `H` for the Jacobians of the product `p p_u` with respect to `p`
+    and `p_u`, and `u` for the unnormalized limb-darkened map divided
+    by its flux, they are
+
+        dLDdp   = norm . G + u . (r^T - norm . r^T . G)
+        dLDdp_u = norm . H - u . (norm . r^T . H)
+
+    i.e., a sparse product table plus a rank-one correction. We store
+    the pieces here and apply them with `dLDdpDot`, `dotdLDdp` and
+    `dotdLDdp_u`. (When `u` is not changing, `dLDdp` is cheaper to
+    apply through `ld_op`; see `fluxWithGradient`.)
+
     */
     template <class T>
     inline void Map<T>::limbDarken(const T& poly, T& poly_ld, bool gradient) {
+        STARRY_PROFILE_SCOPE(profile::LIMB_DARKEN);
         // Bind references to temporaries for speed
         Row<T>& rTp(tmp.tmpRow[0]);
         Row<T>& rTp_ld(tmp.tmpRow[1]);
         Row<T>& norm(tmp.tmpRow[2]);
-        Matrix<Scalar<T>>& outer_inner(tmp.tmpMatrix[0]);
-        Matrix<Scalar<T>>& grad_norm(tmp.tmpMatrix[1]);
+        VectorT<Scalar<T>>& rTG(tmp.tmpRowVector[10]);
+        VectorT<Scalar<T>>& rTH(tmp.tmpRowVector[11]);
 
         // Multiply a polynomial map by the LD polynomial
-        if (gradient) {
-            polymul(y_deg, poly, u_deg, p_u, lmax, poly_ld, dLDdp, dLDdp_u);
-        } else
-            polymul(y_deg, poly, u_deg, p_u, lmax, poly_ld);
+        ld_mul.compile(y_deg, u_deg, lmax);
+        ld_mul(poly, p_u, poly_ld);
 
         // Compute the normalization by enforcing that limb darkening does not
         // change the total disk-integrated flux.
@@ -816,17 +1087,26 @@ namespace maps {
         rTp_ld = dot(B.rT, poly_ld);
         norm = cwiseQuotient(rTp, rTp_ld);
 
-        // We need to do a little chain rule to propagate
-        // the normalization to the gradient. There may
-        // exist faster way that avoids the for loop.
+        // Store the pieces of the gradient. Note that the
+        // derivatives extend to all coefficients, including
+        // those above `y_deg` and `u_deg`.
         if (gradient) {
+            ld_mul_dp.compile(lmax, u_deg, lmax);
+            ld_mul_dp_u.compile(y_deg, lmax, lmax);
+            dLD_p = poly;
+            dLD_norm = norm;
+            resize(dLD_u, N, nwav);
+            resize(dLD_c, N, nwav);
+            resize(dLD_c_u, N, nwav);
             for (int n = 0; n < nwav; ++n) {
-                outer_inner = getColumn(poly_ld, n) * B.rT;
-                outer_inner /= getColumn(rTp_ld, n);
-                grad_norm = dLDdp(n) * getColumn(norm, n);
-                dLDdp(n) = grad_norm + outer_inner - outer_inner * grad_norm;
-                grad_norm = dLDdp_u(n) * getColumn(norm, n);
-                dLDdp_u(n) = grad_norm - outer_inner * grad_norm;
+                dLD_u.col(n) = poly_ld.col(n) / getColumn(rTp_ld, n);
+                rTG.setZero(N);
+                ld_mul_dp.gradp1(B.rT.data(), p_u.data() + n * N, rTG.data());
+                dLD_c.col(n) = (B.rT - getColumn(norm, n) * rTG).transpose();
+                rTH.setZero(N);
+                ld_mul_dp_u.gradp2(B.rT.data(), poly.data() + n * N,
+                                   rTH.data());
+                dLD_c_u.col(n) = -getColumn(norm, n) * rTH.transpose();
             }
         }
 
@@ -835,6 +1115,134 @@ namespace maps {
 
     }
 
+    /**
+    Compute `dLDdp . x` in the `n`th wavelength bin.
+
+    */
+    template <class T>
+    inline void Map<T>::dLDdpDot(int n, const Vector<Scalar<T>>& x,
+                                 Vector<Scalar<T>>& result) {
+        result.setZero(N);
+        ld_mul_dp.product(x.data(), p_u.data() + n * N, result.data());
+        result *= getColumn(dLD_norm, n);
+        result += dLD_u.col(n) * dLD_c.col(n).dot(x);
+    }
+
+    /**
+    Compute `v^T . dLDdp` in the `n`th wavelength bin.
+
+    */
+    template <class T>
+    inline void Map<T>::dotdLDdp(int n, const VectorT<Scalar<T>>& v,
+                                 VectorT<Scalar<T>>& result) {
+        result.setZero(N);
+        ld_mul_dp.gradp1(v.data(), p_u.data() + n * N, result.data());
+        result *= getColumn(dLD_norm, n);
+        result += dLD_u.col(n).dot(v.transpose()) *
+                  dLD_c.col(n).transpose();
+    }
+
+    /**
+    Should we limb-darken maps of degree `deg` with the fused
+    operator `ld_op`? Building it costs `(deg + 1)^2` sparse products
+    and a dense `N x N` by `N x (deg + 1)^2` product per wavelength
+    bin, which only pays off if `u` stays put over many calls (as
+    it does in a light curve). So we only build it once `u` is the
+    same as at the previous call; otherwise the caller should fall
+    back to the sparse `limbDarken`.
+
+    */
+    template <class T>
+    inline bool Map<T>::useLDOperator(int deg) {
+        if ((ld_u_last.rows() != u.rows()) || (ld_u_last.cols() != u.cols()) ||
+            (ld_u_last != u)) {
+            ld_u_last = u;
+            return false;
+        }
+        updateLDOperator(deg);
+        return true;
+    }
+
+    /**
+    Update the fused operator that limb-darkens a map of degree `deg`
+    in the spherical harmonic basis, `A1^-1 . P_u . A1`, where `P_u`
+    is the (sparse) multiplication by the limb darkening polynomial.
+    Since the limb-darkened map is renormalized to conserve flux, the
+    scale of `P_u` is irrelevant, so we use the unnormalized polynomial
+    `U1 . u`; the operator then only changes when `u` does. Only the
+    first `(deg + 1)^2` columns are computed.
+
+    */
+    template <class T>
+    inline void Map<T>::updateLDOperator(int deg) {
+        if ((ld_op_deg >= deg) && (ld_op_u.rows() == u.rows()) &&
+            (ld_op_u.cols() == u.cols()) && (ld_op_u == u))
+            return;
+        Matrix<Scalar<T>>& PA1(tmp.tmpMatrix[0]);
+        Matrix<Scalar<T>>& A1(tmp.tmpMatrix[1]);
+        Vector<Scalar<T>>& q(tmp.tmpColumnVector[0]);
+        int Nd = (deg + 1) * (deg + 1);
+        A1 = B.A1.leftCols(Nd);
+        PA1.resize(N, Nd);
+        ld_mul_op.compile(deg, u_deg, lmax);
+        ld_op.resize(nwav);
+        rTA1ld_op.resize(nwav, Nd);
+        for (int n = 0; n < nwav; ++n) {
+            q = B.U1 * getColumn(u, n);
+            PA1.setZero();
+            for (int j = 0; j < Nd; ++j)
+                ld_mul_op.product(A1.col(j).data(), q.data(),
+                                  PA1.col(j).data());
+            ld_op(n) = B.A1Inv * PA1;
+            rTA1ld_op.row(n) = B.rT * PA1;
+        }
+        ld_op_u = u;
+        ld_op_deg = deg;
+    }
+
+    /**
+    Limb-darken a (rotated) map in the spherical harmonic basis
+    in place. When `u` is not changing, we fold the change of basis
+    into `ld_op`, so it's one dense product per wavelength bin.
+
+    */
+    template <class T>
+    inline void Map<T>::limbDarkenYlm(T& Ry) {
+        T& A1Ry(tmp.tmpT[1]);
+        Vector<Scalar<T>>& LDRyn(tmp.tmpColumnVector[0]);
+        if (!useLDOperator(y_deg)) {
+            A1Ry = B.A1 * Ry;
+            limbDarken(A1Ry, p_uy);
+            Ry = B.A1Inv * p_uy;
+            return;
+        }
+        STARRY_PROFILE_SCOPE(profile::LIMB_DARKEN);
+        int Ny = (y_deg + 1) * (y_deg + 1);
+        for (int n = 0; n < nwav; ++n) {
+            Scalar<T> rTp = B.rTA1.head(Ny).dot(Ry.col(n).head(Ny));
+            if (rTp == 0)
+                throw errors::ValueError("The visible map has zero net flux "
+                                         "and cannot be limb-darkened.");
+            LDRyn = ld_op(n).leftCols(Ny) * Ry.col(n).head(Ny);
+            Ry.col(n) = LDRyn * (rTp /
+                        rTA1ld_op.row(n).head(Ny).dot(Ry.col(n).head(Ny)));
+        }
+    }
+
+    /**
+    Compute `v^T . dLDdp_u` in the `n`th wavelength bin.
+
+    */
+    template <class T>
+    inline void Map<T>::dotdLDdp_u(int n, const VectorT<Scalar<T>>& v,
+                                   VectorT<Scalar<T>>& result) {
+        result.setZero(N);
+        ld_mul_dp_u.gradp2(v.data(), dLD_p.data() + n * N, result.data());
+        result *= getColumn(dLD_norm, n);
+        result += dLD_u.col(n).dot(v.transpose()) *
+                  dLD_c_u.col(n).transpose();
+    }
+
     /**
     Check whether the map is physical: the spherical harmonic
     component and the limb darkening components must
@@ -842,7 +1250,13 @@ namespace maps {
     component must be a monotonically decreasing function toward
     the limb.
 
-    To ensure positive semi-definiteness...
+    Maps of degree one are positive semi-definite if the dipole is
+    no larger than the monopole. The minimum of maps of degree two
+    is computed exactly, and maps of degree three and four are
+    certified positive if a lower bound on them is. Otherwise we
+    search for the global minimum of the polynomial map on a grid,
+    then refine the lowest `restarts` local minima with gradient
+    descent on `nthreads` threads (see `Minimizer::psd`).
 
     To ensure monotonicity, note that the radial profile is
 
@@ -860,7 +1274,9 @@ namespace maps {
     */
     template <class T>
     inline RowBool<T> Map<T>::isPhysical(const Scalar<T>& epsilon,
-                                         const int max_iterations) {
+                                         const int max_iterations,
+                                         const int restarts,
+                                         const int nthreads) {
         RowBool<T> physical(nwav);
         Row<T> center, limb;
         if (u_deg > 0) {
@@ -868,6 +1284,12 @@ namespace maps {
             limb = (*this)(0, 1, 0);
         }
 
+        // Higher degree maps are solved all wavelengths at once:
+        // exactly for quadratic maps, numerically otherwise
+        std::vector<bool> psd;
+        if (y_deg > 1)
+            psd = M.psd(p, epsilon, max_iterations, restarts, nthreads);
+
         for (int n = 0; n < nwav; ++n) {
 
             // 1. Check if the polynomial map is PSD
@@ -894,9 +1316,8 @@ namespace maps {
 
             } else {
 
-                // Higher degrees are solved numerically
-                setIndex(physical, n, M.psd(getColumn(p, n),
-                                            epsilon, max_iterations));
+                // Higher degrees are solved above
+                setIndex(physical, n, bool(psd[n]));
 
             }
 
@@ -988,6 +1409,26 @@ namespace maps {
         }
     }
 
+    /**
+    Compute the polynomial map, rotated by `theta` (in radians)
+    and limb-darkened
+
+    */
+    template <class T>
+    inline void Map<T>::polyMap(const Scalar<T>& theta, T& A1Ry) {
+        T& Ry(tmp.tmpT[0]);
+        if (y_deg > 0) {
+            W.rotate(cos(theta), sin(theta), Ry);
+            A1Ry = B.A1 * Ry;
+        } else {
+            A1Ry = p;
+        }
+        if (u_deg > 0) {
+            limbDarken(A1Ry, p_uy);
+            A1Ry = p_uy;
+        }
+    }
+
     /**
     Evaluate the map at a given (x, y) coordinate
 
@@ -999,7 +1440,6 @@ namespace maps {
 
         // Bind references to temporaries for speed
         Row<T>& result(tmp.tmpRow[0]);
-        T& Ry(tmp.tmpT[0]);
         T& A1Ry(tmp.tmpT[1]);
         Power<Scalar<T>>& xpow(tmp.tmpPower[0]);
         Power<Scalar<T>>& ypow(tmp.tmpPower[1]);
@@ -1020,26 +1460,17 @@ namespace maps {
             return result;
         }
 
-        if ((theta == cache.theta) && (cache.oper == cache.EVAL)) {
+        bool cached = (theta == cache.theta) && (cache.oper == cache.EVAL);
+        STARRY_PROFILE_CACHE(profile::MAP_CACHE, cached);
+        if (cached) {
 
             // We use the cached version of the polynomial map
             A1Ry = cache.p;
 
         } else {
 
-            // Rotate the spherical harmonic map into view
-            if (y_deg > 0) {
-                W.rotate(cos(theta), sin(theta), Ry);
-                A1Ry = B.A1 * Ry;
-            } else {
-                A1Ry = p;
-            }
-
-            if (u_deg > 0) {
-                // Apply limb darkening
-                limbDarken(A1Ry, p_uy);
-                A1Ry = p_uy;
-            }
+            // Rotate the map into view and limb-darken it
+            polyMap(theta, A1Ry);
 
             // Cache the polynomial map
             cache.oper = cache.EVAL;
@@ -1059,6 +1490,304 @@ namespace maps {
     }
 
 
+    /**
+    Strict weak ordering of the rotation angles in `evaluate` that
+    treats NaN as larger than any number and equivalent to itself,
+    so that NaN angles get a group of their own.
+
+    */
+    template <typename S>
+    struct AngleLess {
+        inline bool operator()(const S& a, const S& b) const {
+            if (b != b) return (a == a);
+            return a < b;
+        }
+    };
+
+    /**
+    Evaluate the map at many points `(theta(i), x(i), y(i))`; row `i` of
+    `result` is the intensity at point `i`. The arguments and the result
+    may be strided views (e.g., into NumPy buffers); the result must
+    already have one row per point.
+
+    Consecutive points with the same `theta` share the rotated,
+    limb-darkened polynomial map, which we compute once per distinct
+    value of `theta` (up to `STARRY_EVAL_GROUPS` at a time). We then
+    write the polynomial as `A(x, y) + z B(x, y)` and evaluate `A` and
+    `B` with nested Horner schemes in `x` and `y` on blocks of
+    `STARRY_EVAL_BLOCK` points, which vectorizes over the points. The
+    blocks are distributed over `nthreads` threads (default: one per
+    hardware thread).
+
+    */
+    template <class T>
+    void Map<T>::evaluate(const VectorRef<Scalar<T>>& theta,
+                          const VectorRef<Scalar<T>>& x,
+                          const VectorRef<Scalar<T>>& y,
+                          MapRef<T> result,
+                          int nthreads) {
+
+        typedef Eigen::Array<Scalar<T>, Eigen::Dynamic, 1> ArrayS;
+        const int B = STARRY_EVAL_BLOCK;
+        long npts = x.size();
+        if ((theta.size() != npts) || (y.size() != npts) ||
+            (result.rows() != npts) || (result.cols() != nwav))
+            throw errors::ValueError("Mismatch in argument dimensions.");
+        if (npts == 0) return;
+        nthreads = numThreads(nthreads);
+
+        // The order in which we visit the coefficients in the Horner
+        // scheme: x^i y^j for j = lmax..0, i = lmax - j..0, followed by
+        // x^i y^j z for j = lmax - 1..0, i = lmax - 1 - j..0
+        std::vector<int> order;
+        order.reserve(N);
+        for (int odd = 0; odd < 2; ++odd) {
+            for (int j = lmax - odd; j >= 0; --j) {
+                for (int i = lmax - odd - j; i >= 0; --i) {
+                    int l = i + j + odd;
+                    int m = j - i;
+                    order.push_back(l * l + l + m);
+                }
+            }
+        }
+
+        // Angle of each point in radians; constant maps don't rotate
+        auto angle = [&](long i) {
+            return (y_deg > 0) ?
+                Scalar<T>(theta(i) * (pi<Scalar<T>>() / 180.)) : Scalar<T>(0);
+        };
+
+        // Evaluate the points in chunks of runs of consecutive
+        // points with the same angle
+        long i0 = 0;
+        std::vector<long> start;
+        std::vector<int> group;
+        std::vector<bool> visible;
+        std::vector<std::pair<long, long>> blocks;
+        Matrix<Scalar<T>> poly;
+        T& A1Ry(tmp.tmpT[1]);
+        while (i0 < npts) {
+
+            // Find the runs and the distinct angles in this chunk
+            std::map<Scalar<T>, int, AngleLess<Scalar<T>>> groups;
+            start.clear();
+            group.clear();
+            visible.clear();
+            long i = i0;
+            while (i < npts) {
+                Scalar<T> angle_i = angle(i);
+                auto it = groups.find(angle_i);
+                if (it == groups.end()) {
+                    if (int(groups.size()) == STARRY_EVAL_GROUPS)
+                        break;
+                    it = groups.insert(std::make_pair(angle_i,
+                                                      int(groups.size()))).first;
+                    visible.push_back(false);
+                }
+                start.push_back(i);
+                group.push_back(it->second);
+                do {
+                    if (x(i) * x(i) + y(i) * y(i) <= 1)
+                        visible[it->second] = true;
+                    ++i;
+                } while ((i < npts) && (angle(i) == angle_i));
+            }
+            start.push_back(i);
+
+            // Compute the polynomial map for each angle,
+            // reordered for the Horner scheme. Angles at which
+            // all points are off the disk are skipped
+            poly.resize(N, groups.size() * nwav);
+            for (auto& g : groups) {
+                if (!visible[g.second]) {
+                    poly.block(0, g.second * nwav, N, nwav).setZero();
+                    continue;
+                }
+                polyMap(g.first, A1Ry);
+                for (int k = 0; k < N; ++k)
+                    poly.block(k, g.second * nwav, 1, nwav) =
+                        A1Ry.row(order[k]);
+            }
+
+            // Split the runs into blocks of points
+            blocks.clear();
+            for (size_t r = 0; r < group.size(); ++r) {
+                for (long b = start[r]; b < start[r + 1]; b += B)
+                    blocks.push_back(std::make_pair(b, r));
+            }
+
+            // Evaluate the blocks
+            std::atomic<size_t> next(0);
+            auto work = [&](int) {
+                ArrayS xb, yb, zb, I, acc, inner;
+                for (size_t k = next++; k < blocks.size(); k = next++) {
+                    long b0 = blocks[k].first;
+                    long r = blocks[k].second;
+                    long nb = std::min(long(B), start[r + 1] - b0);
+
+                    // Short blocks are cheaper to do point by point
+                    if (nb < 8) {
+                        for (long q = b0; q < b0 + nb; ++q) {
+                            Scalar<T> rsq = x(q) * x(q) + y(q) * y(q);
+                            Scalar<T> z = sqrt(std::max(Scalar<T>(0),
+                                                        1 - rsq));
+                            for (int w = 0; w < nwav; ++w) {
+                                const Scalar<T>* c =
+                                    &poly(0, group[r] * nwav + w);
+                                Scalar<T> Iq = 0;
+                                for (int odd = 0; odd < 2; ++odd) {
+                                    Scalar<T> acc_q = 0;
+                                    for (int j = lmax - odd; j >= 0; --j) {
+                                        Scalar<T> inner_q = *c++;
+                                        for (int i = lmax - odd - j - 1;
+                                             i >= 0; --i)
+                                            inner_q = inner_q * x(q) + *c++;
+                                        acc_q = acc_q * y(q) + inner_q;
+                                    }
+                                    Iq = odd ? Scalar<T>(Iq + acc_q * z)
+                                             : acc_q;
+                                }
+                                result(q, w) = (rsq > 1) ? NAN : Iq;
+                            }
+                        }
+                        continue;
+                    }
+                    xb = x.segment(b0, nb).array();
+                    yb = y.segment(b0, nb).array();
+                    zb = (1 - xb * xb - yb * yb).max(Scalar<T>(0)).sqrt();
+                    for (int w = 0; w < nwav; ++w) {
+                        const Scalar<T>* c = &poly(0, group[r] * nwav + w);
+                        for (int odd = 0; odd < 2; ++odd) {
+                            acc.setZero(nb);
+                            for (int j = lmax - odd; j >= 0; --j) {
+                                inner.setConstant(nb, *c++);
+                                for (int i = lmax - odd - j - 1; i >= 0; --i)
+                                    inner = inner * xb + *c++;
+                                acc = acc * yb + inner;
+                            }
+                            if (odd)
+                                I += acc * zb;
+                            else
+                                I = acc;
+                        }
+                        for (long q = 0; q < nb; ++q) {
+                            if (xb(q) * xb(q) + yb(q) * yb(q) > 1)
+                                I(q) = NAN;
+                        }
+                        result.block(b0, w, nb, 1) = I.matrix();
+                    }
+                }
+            };
+            // Don't spawn threads for small chunks
+            runThreads(int(std::min(long(nthreads), (i - i0) / (16 * B) + 1)),
+                       work);
+            i0 = i;
+
+        }
+
+    }
+
+    /**
+    Render the specific intensity of the map on a `res` x `res` grid
+    spanning `[-1, 1]` in `x` and `y`, for each of the rotation
+    angles `theta` (in degrees). On return, column `t * nwav + n` of
+    `image` is the image at angle `theta(t)` in wavelength bin `n`,
+    flattened in column-major order (the pixel at `x(i), y(j)` is in
+    row `j + i * res`). Pixels off the disk are NaN.
+
+    Rather than evaluating the map pixel by pixel, we compute the
+    polynomial map at every angle up front and tabulate the powers
+    of `x` and `y` on the grid. Each column of the grid is then a
+    single dense product of its polynomial basis with the maps at
+    all angles. The columns are distributed over `nthreads` threads
+    (default: one per hardware thread).
+
+    */
+    template <class T>
+    void Map<T>::render(const Vector<Scalar<T>>& theta, int res,
+                        Matrix<Scalar<T>>& image, int nthreads) {
+
+        if (res < 1)
+            throw errors::ValueError("The resolution must be positive.");
+        int nframes = theta.size();
+        int K = nframes * nwav;
+
+        // The polynomial map at each angle
+        Matrix<Scalar<T>> P(N, K);
+        T& A1Ry(tmp.tmpT[1]);
+        for (int t = 0; t < nframes; ++t) {
+            Scalar<T> theta_rad = (y_deg > 0) ?
+                Scalar<T>(theta(t) * (pi<Scalar<T>>() / 180.)) : Scalar<T>(0);
+            bool cached = (theta_rad == cache.theta) &&
+                          (cache.oper == cache.EVAL);
+            STARRY_PROFILE_CACHE(profile::MAP_CACHE, cached);
+            if (!cached) {
+                polyMap(theta_rad, A1Ry);
+                cache.oper = cache.EVAL;
+                cache.theta = theta_rad;
+                cache.p = A1Ry;
+            }
+            P.block(0, t * nwav, N, nwav) = cache.p;
+        }
+
+        // Exponents of `x`, `y` and `z` in each term of the basis
+        std::vector<int> xexp(N), yexp(N);
+        std::vector<bool> zexp(N);
+        for (int l = 0, n = 0; l < lmax + 1; ++l) {
+            for (int m = -l; m < l + 1; ++m, ++n) {
+                int mu = l - m;
+                int nu = l + m;
+                zexp[n] = (nu % 2) != 0;
+                xexp[n] = zexp[n] ? (mu - 1) / 2 : mu / 2;
+                yexp[n] = zexp[n] ? (nu - 1) / 2 : nu / 2;
+            }
+        }
+
+        // Powers of the grid coordinates
+        Vector<Scalar<T>> x = Vector<Scalar<T>>::LinSpaced(res, -1, 1);
+        Matrix<Scalar<T>> xpow(res, lmax + 1);
+        xpow.col(0).setOnes();
+        for (int k = 1; k < lmax + 1; ++k)
+            xpow.col(k) = xpow.col(k - 1).cwiseProduct(x);
+
+        // Render one column of the grid at a time
+        image.resize(res * res, K);
+        std::atomic<int> next(0);
+        auto work = [&](int) {
+            Matrix<Scalar<T>> basis;
+            for (int i = next++; i < res; i = next++) {
+                // Extent of the disk in this column
+                int j0 = 0;
+                while ((j0 < res) && (x(i) * x(i) + x(j0) * x(j0) > 1))
+                    ++j0;
+                int j1 = res;
+                while ((j1 > j0) && (x(i) * x(i) + x(j1 - 1) * x(j1 - 1) > 1))
+                    --j1;
+                if (j0 >= j1) {
+                    image.middleRows(i * res, res).setConstant(NAN);
+                    continue;
+                }
+                image.middleRows(i * res, j0).setConstant(NAN);
+                image.middleRows(i * res + j1, res - j1).setConstant(NAN);
+                basis.resize(j1 - j0, N);
+                for (int j = j0; j < j1; ++j) {
+                    Scalar<T> z = sqrt(max(Scalar<T>(0), Scalar<T>(1 -
+                                       x(i) * x(i) - x(j) * x(j))));
+                    for (int n = 0; n < N; ++n) {
+                        basis(j - j0, n) = xpow(i, xexp[n]) *
+                                           xpow(j, yexp[n]);
+                        if (zexp[n])
+                            basis(j - j0, n) *= z;
+                    }
+                }
+                image.middleRows(i * res + j0, j1 - j0).noalias() = basis * P;
+            }
+        };
+        runThreads(std::min(numThreads(nthreads), res), work);
+
+    }
+
+
     /* ------------- */
     /*      FLUX     */
     /* ------------- */
@@ -1123,15 +1852,24 @@ namespace maps {
             return result;
         }
 
+        // Is the limb-darkened, rotated map cached?
+        bool occulted = (b < 1 + ro) && (ro != 0);
+        bool cached = occulted && (u_deg > 0) && (theta == cache.theta) &&
+                      (cache.oper == cache.FLUX);
+        if (occulted && (u_deg > 0))
+            STARRY_PROFILE_CACHE(profile::MAP_CACHE, cached);
+
         // Rotate the map into view
-        if (y_deg > 0) {
+        if (cached) {
+            Ry = cache.y;
+        } else if (y_deg > 0) {
             W.rotate(cos(theta), sin(theta), Ry);
         } else {
             Ry = y;
         }
 
         // No occultation
-        if ((b >= 1 + ro) || (ro == 0)) {
+        if (!occulted) {
 
             // Easy. Note that limb-darkening does not
             // affect the total disk-integrated flux!
@@ -1140,32 +1878,19 @@ namespace maps {
         // Occultation
         } else {
 
-            // Apply limb darkening
-            if (u_deg > 0) {
-
-                if ((theta == cache.theta) && (cache.oper == cache.FLUX)) {
-
-                    // Easy. Use the cached rotated map
-                    Ry = cache.y;
-
-                } else {
-
-                    // Transform into the polynomial basis
-                    A1Ry = B.A1 * Ry;
-
-                    // Limb-darken it
-                    limbDarken(A1Ry, p_uy);
-
-                    // Back to the spherical harmonic basis
-                    Ry = B.A1Inv * p_uy;
-
-                    // Cache the map
-                    cache.oper = cache.FLUX;
-                    cache.theta = theta;
-                    cache.y = Ry;
-
-                }
+            // Apply limb darkening and cache the map
+            if ((u_deg > 0) && (!cached)) {
+                limbDarkenYlm(Ry);
+                cache.oper = cache.FLUX;
+                cache.theta = theta;
+                cache.y = Ry;
+            }
 
+            // Expand in powers of the occultor radius if it is small
+            if ((approx_tol > 0) && (!numerical) && (b < 1 - ro)) {
+                A1Ry = B.A1 * Ry;
+                if (fluxApprox(A1Ry, xo, yo, ro, result))
+                    return result;
             }
 
             // Compute the flux numerically.
@@ -1195,12 +1920,152 @@ namespace maps {
             G.compute(b, ro);
 
             // Dot the result in and we're done
-            return G.sT * ARRy;
+            return G.sT.template cast<Scalar<T>>() * ARRy;
 
         }
 
     }
 
+    /**
+    Does the timeseries `flux` compute all the points at once?
+    This is the case for pure limb-darkened maps; all others are
+    computed one point at a time, so callers may just as well
+    loop over `flux` themselves.
+
+    */
+    template <class T>
+    inline bool Map<T>::batchedFlux(bool numerical) const {
+        return (y_deg == 0) && (u_deg > 0) && (!numerical);
+    }
+
+    /**
+    Compute the flux for a timeseries of occultor positions.
+    The arguments and the result may be strided views (e.g., into
+    NumPy buffers); the result must already have one row per point.
+    Pure limb-darkened maps are computed in a single batch; all
+    others one point at a time.
+
+    */
+    template <class T>
+    inline void Map<T>::flux(const VectorRef<Scalar<T>>& theta,
+                             const VectorRef<Scalar<T>>& xo,
+                             const VectorRef<Scalar<T>>& yo,
+                             const VectorRef<Scalar<T>>& ro,
+                             MapRef<T> result,
+                             bool numerical) {
+        int npts = xo.size();
+        if ((theta.size() != npts) || (yo.size() != npts) ||
+            (ro.size() != npts) || (result.rows() != npts) ||
+            (result.cols() != nwav))
+            throw errors::ValueError("Mismatch in argument dimensions.");
+        if (batchedFlux(numerical)) {
+            fluxLD(xo, yo, ro, result);
+        } else {
+            for (int i = 0; i < npts; ++i)
+                setRow(result, i, flux(theta(i), xo(i), yo(i), ro(i),
+                                       false, numerical));
+        }
+    }
+
+    /**
+    Compute the flux during an occultation by a small occultor
+    lying entirely within the disk by expanding the occulted flux
+    in powers of the occultor radius about the intensity at its
+    center. Here `poly` is the (rotated, limb-darkened) map in the
+    polynomial basis. Returns `false` and leaves `result` untouched
+    if the estimated error exceeds `approx_tol`, in which case the
+    flux should be computed exactly.
+
+    */
+    template <class T>
+    inline bool Map<T>::fluxApprox(const T& poly,
+                                   const Scalar<T>& xo,
+                                   const Scalar<T>& yo,
+                                   const Scalar<T>& ro,
+                                   Row<T>& result) {
+        SP.compute(xo, yo, ro);
+        if (maxAbs(dot(SP.D_err, poly)) > approx_tol)
+            return false;
+        result = dot(B.rT, poly) - dot(SP.D, poly);
+        return true;
+    }
+
+    /**
+    Compute the flux for a timeseries of occultor positions
+    for a pure limb-darkened map (Y_{l,m} = 0 for l > 0). The
+    occultation integrals for all occulted points are computed
+    in a single call to the batched solver.
+
+    NOTE: This uses the fast parameterization from
+          Agol & Luger (2018).
+
+    */
+    template <class T>
+    inline void Map<T>::fluxLD(const VectorRef<Scalar<T>>& xo,
+                               const VectorRef<Scalar<T>>& yo,
+                               const VectorRef<Scalar<T>>& ro,
+                               MapRef<T> result) {
+
+        int npts = xo.size();
+        std::vector<int> occ;
+        occ.reserve(npts);
+
+        // Compute the Agol `c` basis
+        if (update_c_basis) {
+            for (int n = 0; n < nwav; ++n) {
+                agol_c.col(n) = computeC(getColumn(u, n), dagol_cdu(n));
+                setIndex(agol_norm, n, normC(getColumn(agol_c, n)));
+            }
+            update_c_basis = false;
+        }
+        Matrix<Scalar<T>> w(lmax + 1, nwav);
+        for (int n = 0; n < nwav; ++n)
+            w.col(n) = getColumn(agol_c, n) * (getIndex(agol_norm, n) *
+                                               getIndex(getRow(y, 0), n));
+
+        // Deal with the trivial cases, small occultors and
+        // tabulated radii, and find the points that need the
+        // full solution
+        for (int i = 0; i < npts; ++i) {
+            Scalar<T> b = sqrt(xo(i) * xo(i) + yo(i) * yo(i));
+            if (b <= ro(i) - 1) {
+                result.row(i).setZero();
+            } else if ((b >= 1 + ro(i)) || (ro(i) == 0)) {
+                setRow(result, i, getRow(y, 0));
+            } else {
+                if ((approx_tol > 0) && (b < 1 - ro(i))) {
+                    SP.computeLD(b, ro(i));
+                    if ((SP.S_err * w).cwiseAbs().maxCoeff() <= approx_tol) {
+                        result.row(i) = SP.S * w;
+                        continue;
+                    }
+                }
+                if (LT.tol > 0) {
+                    LT.compute(L, b, ro(i));
+                    result.row(i) = LT.S * w;
+                } else {
+                    occ.push_back(i);
+                }
+            }
+        }
+        int nocc = occ.size();
+        if (nocc == 0) return;
+
+        // Compute the Agol S vectors
+        Vector<Scalar<T>> b(nocc), r(nocc);
+        for (int j = 0; j < nocc; ++j) {
+            b(j) = sqrt(xo(occ[j]) * xo(occ[j]) + yo(occ[j]) * yo(occ[j]));
+            r(j) = ro(occ[j]);
+        }
+        LB.compute(b, r);
+
+        // Dot the result in and we're done
+        Matrix<Scalar<T>> F = LB.S * w;
+        for (int j = 0; j < nocc; ++j)
+            result.row(occ[j]) = F.row(j);
+
+    }
+
     /**
     Compute the flux during or outside of an occultation
     for a pure limb-darkened map (Y_{l,m} = 0 for l > 0).
@@ -1241,9 +2106,6 @@ namespace maps {
         // Occultation
         } else {
 
-            // Compute the Agol S vector
-            L.compute(b, ro);
-
             // Compute the Agol `c` basis
             if (update_c_basis) {
                 for (int n = 0; n < nwav; ++n) {
@@ -1252,10 +2114,27 @@ namespace maps {
                 }
                 update_c_basis = false;
             }
+            auto prod = colwiseProduct(agol_c, agol_norm);
+            auto w = colwiseProduct(prod, getRow(y, 0));
+
+            // Expand in powers of the occultor radius if it is small
+            if ((approx_tol > 0) && (b < 1 - ro)) {
+                SP.computeLD(b, ro);
+                if (maxAbs(dot(SP.S_err, w)) <= approx_tol)
+                    return dot(SP.S, w);
+            }
+
+            // Interpolate the Agol S vector if we have a table
+            if (LT.tol > 0) {
+                LT.compute(L, b, ro);
+                return LT.S * w;
+            }
+
+            // Compute the Agol S vector
+            L.compute(b, ro);
 
             // Dot the result in and we're done
-            auto prod = colwiseProduct(agol_c, agol_norm);
-            return L.S * colwiseProduct(prod, getRow(y, 0));
+            return L.S * w;
 
         }
 
@@ -1415,8 +2294,8 @@ namespace maps {
         sTAdRdtheta.resize(N);
         VectorT<Scalar<T>>& rTA1R(tmp.tmpRowVector[4]);
         rTA1R.resize(N);
-        ADScalar<Scalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
-        ADScalar<Scalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
+        ADScalar<SolverScalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
+        ADScalar<SolverScalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
 
         // Resize the gradients
         resizeGradient(N, 0);
@@ -1437,23 +2316,15 @@ namespace maps {
            return result;
         }
 
-        // Rotate the map into view
-        W.compute(cos(theta), sin(theta));
-        if (theta == 0) {
+        // Rotate the map into view and compute d(R . y) / dtheta
+        W.rotateWithGradient(cos(theta), sin(theta), Ry, dRdthetay);
+        if (theta == 0)
             Ry = y;
-        } else {
-            for (int l = 0; l < lmax + 1; l++)
-                Ry.block(l * l, 0, 2 * l + 1, nwav) =
-                    W.R[l] * y.block(l * l, 0, 2 * l + 1, nwav);
-        }
 
         // No occultation
         if ((b >= 1 + ro) || (ro == 0)) {
 
             // Compute the theta deriv
-            for (int l = 0; l < lmax + 1; l++)
-                dRdthetay.block(l * l, 0, 2 * l + 1, nwav) =
-                    W.dRdtheta[l] * y.block(l * l, 0, 2 * l + 1, nwav);
             setRow(dF, 0, Row<T>(dot(B.rTA1, dRdthetay) *
                                 (pi<Scalar<T>>() / 180.)));
 
@@ -1467,9 +2338,7 @@ namespace maps {
                 for (int i = 0; i < N; i++)
                     setRow(dF, 4 + i, B.rTA1(i));
             } else {
-                for (int l = 0; l < lmax + 1; l++)
-                    rTA1R.segment(l * l, 2 * l + 1) =
-                        B.rTA1.segment(l * l, 2 * l + 1) * W.R[l];
+                W.dotR(B.rTA1, rTA1R);
                 for (int i = 0; i < N; i++)
                     setRow(dF, 4 + i, rTA1R(i));
             }
@@ -1496,9 +2365,9 @@ namespace maps {
 
             // Compute the sT vector using AutoDiff
             b_grad.value() = b;
-            b_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 0);
+            b_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 0);
             ro_grad.value() = ro;
-            ro_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 1);
+            ro_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 1);
             G_grad.compute(b_grad, ro_grad);
 
             // Compute the b and ro derivs
@@ -1507,11 +2376,11 @@ namespace maps {
             for (int i = 0; i < N; i++) {
 
                 // b deriv
-                dFdb += G_grad.sT(i).derivatives()(0) * getRow(ARRy, i);
+                dFdb += Scalar<T>(G_grad.sT(i).derivatives()(0)) * getRow(ARRy, i);
 
                 // ro deriv
                 setRow(dF, 3, Row<T>(getRow(dF, 3) +
-                                     G_grad.sT(i).derivatives()(1) *
+                                     Scalar<T>(G_grad.sT(i).derivatives()(1)) *
                                      getRow(ARRy, i)));
 
                 // Store the value of s^T
@@ -1520,7 +2389,7 @@ namespace maps {
             }
 
             // Solution vector in spherical harmonic basis
-            sTA = G.sT * B.A;
+            sTA = G.sT.template cast<Scalar<T>>() * B.A;
 
             // Compute stuff involving the Rprime rotation matrix
             int m;
@@ -1544,9 +2413,6 @@ namespace maps {
             setRow(dF, 2, Row<T>((yo_b * dFdb) - (xo_b * sTAdRdthetaRy_b)));
 
             // Compute the theta deriv
-            for (int l = 0; l < lmax + 1; l++)
-                dRdthetay.block(l * l, 0, 2 * l + 1, nwav) =
-                    W.dRdtheta[l] * y.block(l * l, 0, 2 * l + 1, nwav);
             setRow(dF, 0, Row<T>(dot(sTAR, dRdthetay) *
                                 (pi<Scalar<T>>() / 180.)));
 
@@ -1555,15 +2421,13 @@ namespace maps {
                 for (int i = 0; i < N; i++)
                     setRow(dF, 4 + i, sTAR(i));
             } else {
-                for (int l = 0; l < lmax + 1; l++)
-                    sTARR.segment(l * l, 2 * l + 1) =
-                        sTAR.segment(l * l, 2 * l + 1) * W.R[l];
+                W.dotR(sTAR, sTARR);
                 for (int i = 0; i < N; i++)
                     setRow(dF, 4 + i, sTARR(i));
             }
 
             // Dot the result in and we're done
-            return G.sT * ARRy;
+            return G.sT.template cast<Scalar<T>>() * ARRy;
 
         }
 
@@ -1613,7 +2477,7 @@ namespace maps {
             G.compute(b, ro);
             
             // Dot the result in and we're done
-            return G.sT * ARRy;
+            return G.sT.template cast<Scalar<T>>() * ARRy;
 
         }
 
@@ -1635,8 +2499,8 @@ namespace maps {
         Row<T>& result(tmp.tmpRow[0]);
         Row<T>& dFdb(tmp.tmpRow[1]);
         T& ARRy(tmp.tmpT[2]);
-        ADScalar<Scalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
-        ADScalar<Scalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
+        ADScalar<SolverScalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
+        ADScalar<SolverScalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
 
         // Resize the gradients
         resizeGradient(1, 0);
@@ -1681,9 +2545,9 @@ namespace maps {
 
             // Compute the sT vector using AutoDiff
             b_grad.value() = b;
-            b_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 0);
+            b_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 0);
             ro_grad.value() = ro;
-            ro_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 1);
+            ro_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 1);
             G_grad.compute(b_grad, ro_grad);
 
             // Compute the b and ro derivs
@@ -1692,11 +2556,11 @@ namespace maps {
             for (int i = 0; i < N; i++) {
 
                 // b deriv
-                dFdb += G_grad.sT(i).derivatives()(0) * getRow(ARRy, i);
+                dFdb += Scalar<T>(G_grad.sT(i).derivatives()(0)) * getRow(ARRy, i);
 
                 // ro deriv
                 setRow(dF, 3, Row<T>(getRow(dF, 3) +
-                                     G_grad.sT(i).derivatives()(1) *
+                                     Scalar<T>(G_grad.sT(i).derivatives()(1)) *
                                      getRow(ARRy, i)));
 
                 // Store the value of s^T
@@ -1715,7 +2579,7 @@ namespace maps {
             setRow(dF, 4, cwiseQuotient(result, getRow(y, 0)));
 
             // Dot the result in and we're done
-            return G.sT * ARRy;
+            return G.sT.template cast<Scalar<T>>() * ARRy;
 
         }
 
@@ -1757,12 +2621,14 @@ namespace maps {
         rTA1R.resize(N);
         VectorT<Scalar<T>>& dFdu(tmp.tmpRowVector[6]);
         VectorT<Scalar<T>>& dFdp_u(tmp.tmpRowVector[7]);
-        ADScalar<Scalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
-        ADScalar<Scalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
-        VectorT<Matrix<Scalar<T>>>& A1dLDdpA1(tmp.tmpRowVectorOfMatrices[0]);
-        A1dLDdpA1.resize(nwav);
-        Matrix<Scalar<T>>& A1dLDdpA1dRdtheta(tmp.tmpMatrix[0]);
-        A1dLDdpA1dRdtheta.resize(N, N);
+        VectorT<Scalar<T>>& sTARA1Inv(tmp.tmpRowVector[8]);
+        VectorT<Scalar<T>>& sTARA1InvdLDdp(tmp.tmpRowVector[9]);
+        Vector<Scalar<T>>& dRdthetay(tmp.tmpColumnVector[1]);
+        Vector<Scalar<T>>& ld_opdRdthetay(tmp.tmpColumnVector[2]);
+        Row<T>& rTA1Ry(tmp.tmpRow[3]);
+        Row<T>& ld_op_norm(tmp.tmpRow[4]);
+        ADScalar<SolverScalar<T>, 2>& b_grad(tmp.tmpADScalar2[0]);
+        ADScalar<SolverScalar<T>, 2>& ro_grad(tmp.tmpADScalar2[1]);
 
         // Resize the gradients
         resizeGradient(N, lmax);
@@ -1783,29 +2649,16 @@ namespace maps {
             return result;
         }
 
-        // Rotate the map into view
-        // TODO: Cache this operation *here*
-        //       Save W.R, W.dRdtheta, Ry
-        W.compute(cos(theta), sin(theta));
-        if (theta == 0) {
+        // Rotate the map into view and compute d(R . y) / dtheta
+        W.rotateWithGradient(cos(theta), sin(theta), Ry, dLDRydtheta);
+        if (theta == 0)
             Ry = y;
-        } else {
-            for (int l = 0; l < lmax + 1; l++)
-                Ry.block(l * l, 0, 2 * l + 1, nwav) =
-                    W.R[l] * y.block(l * l, 0, 2 * l + 1, nwav);
-        }
 
         // No occultation
         if ((b >= 1 + ro) || (ro == 0)) {
 
-            // Compute d(R . y) / dtheta
             // Since limb darkening doesn't change the total flux,
-            // we don't have to apply it here.
-            for (int n = 0; n < nwav; ++n)
-                for (int l = 0; l < lmax + 1; ++l)
-                    dLDRydtheta.block(l * l, n, 2 * l + 1, 1) =
-                        W.dRdtheta[l] *
-                        y.block(l * l, n, 2 * l + 1, 1);
+            // we don't have to apply it to d(R . y) / dtheta here.
 
             // Compute the theta deriv
             setRow(dF, 0, Row<T>(dot(B.rTA1, dLDRydtheta) *
@@ -1821,9 +2674,7 @@ namespace maps {
                 for (int i = 0; i < N; ++i)
                     setRow(dF, 4 + i, B.rTA1(i));
             } else {
-                for (int l = 0; l < lmax + 1; ++l)
-                    rTA1R.segment(l * l, 2 * l + 1) =
-                        B.rTA1.segment(l * l, 2 * l + 1) * W.R[l];
+                W.dotR(B.rTA1, rTA1R);
                 for (int i = 0; i < N; ++i)
                     setRow(dF, 4 + i, rTA1R(i));
             }
@@ -1846,18 +2697,47 @@ namespace maps {
             A1Ry = B.A1 * Ry;
             limbDarken(A1Ry, p_uy, true);
             LDRy = B.A1Inv * p_uy;
-            for (int n = 0; n < nwav; ++n)
-                A1dLDdpA1(n) = B.A1Inv * dLDdp(n) * B.A1;
+
+            // The derivative of the limb-darkened map with respect
+            // to the rotated map is
+            //   A1^-1 . dLDdp . A1 = norm . ld_op +
+            //      LDRy . (r^T . A1 - norm . r^T . A1 . ld_op) / (r^T . A1 . Ry)
+            // where `norm` is the normalization of `ld_op`. Only its first
+            // `Ny` columns act on the rotated map, but we need all of them
+            // for the map derivs. If `u` just changed, building `ld_op`
+            // isn't worth it, so we apply `dLDdp` directly instead.
+            bool use_ld_op = useLDOperator(lmax);
+            int Ny = (y_deg + 1) * (y_deg + 1);
+            if (use_ld_op) {
+                for (int n = 0; n < nwav; ++n) {
+                    setIndex(rTA1Ry, n,
+                             B.rTA1.head(Ny).dot(Ry.col(n).head(Ny)));
+                    setIndex(ld_op_norm, n, getIndex(rTA1Ry, n) /
+                             rTA1ld_op.row(n).head(Ny).dot(
+                                Ry.col(n).head(Ny)));
+                }
+            }
 
             // Compute the theta deriv of the limb-darkened, rotated map
-            // dLDRy / dtheta = A1^-1 . dLDdp . d(A1 . R . y) / dtheta
-            //                = A1dLDdpA1 . dR / dtheta . y
+            // dLDRy / dtheta = (A1^-1 . dLDdp . A1) . dR / dtheta . y
+            // On input, `dLDRydtheta` holds dR / dtheta . y
             for (int n = 0; n < nwav; ++n) {
-                for (int l = 0; l < lmax + 1; ++l)
-                    A1dLDdpA1dRdtheta.block(0, l * l, N, 2 * l + 1) =
-                        A1dLDdpA1(n).block(0, l * l, N, 2 * l + 1)
-                        * W.dRdtheta[l];
-                dLDRydtheta.col(n) = A1dLDdpA1dRdtheta * getColumn(y, n);
+                if (use_ld_op) {
+                    dRdthetay = dLDRydtheta.col(n).head(Ny);
+                    ld_opdRdthetay = ld_op(n).leftCols(Ny) * dRdthetay;
+                    dLDRydtheta.col(n) =
+                        getIndex(ld_op_norm, n) * ld_opdRdthetay +
+                        LDRy.col(n) * ((B.rTA1.head(Ny).dot(dRdthetay) -
+                        getIndex(ld_op_norm, n) *
+                        rTA1ld_op.row(n).head(Ny).dot(dRdthetay)) /
+                        getIndex(rTA1Ry, n));
+                } else {
+                    // Evaluated right to left, so it's all
+                    // matrix-vector products
+                    dRdthetay = B.A1 * dLDRydtheta.col(n);
+                    dLDdpDot(n, dRdthetay, ld_opdRdthetay);
+                    dLDRydtheta.col(n) = B.A1Inv * ld_opdRdthetay;
+                }
             }
 
             // Align occultor with the +y axis
@@ -1876,9 +2756,9 @@ namespace maps {
 
             // Compute the sT vector using AutoDiff
             b_grad.value() = b;
-            b_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 0);
+            b_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 0);
             ro_grad.value() = ro;
-            ro_grad.derivatives() = Vector<Scalar<T>>::Unit(2, 1);
+            ro_grad.derivatives() = Vector<SolverScalar<T>>::Unit(2, 1);
             G_grad.compute(b_grad, ro_grad);
 
             // Compute the b and ro derivs
@@ -1887,11 +2767,11 @@ namespace maps {
             for (int i = 0; i < N; i++) {
 
                 // b deriv
-                dFdb += G_grad.sT(i).derivatives()(0) * getRow(ARLDRy, i);
+                dFdb += Scalar<T>(G_grad.sT(i).derivatives()(0)) * getRow(ARLDRy, i);
 
                 // ro deriv
                 setRow(dF, 3, Row<T>(getRow(dF, 3) +
-                                     G_grad.sT(i).derivatives()(1) *
+                                     Scalar<T>(G_grad.sT(i).derivatives()(1)) *
                                      getRow(ARLDRy, i)));
 
                 // Store the value of s^T
@@ -1900,7 +2780,7 @@ namespace maps {
             }
 
             // Solution vector in spherical harmonic basis
-            sTA = G.sT * B.A;
+            sTA = G.sT.template cast<Scalar<T>>() * B.A;
 
             // Compute stuff involving the Rprime rotation matrix
             int m;
@@ -1929,15 +2809,23 @@ namespace maps {
 
             // Compute the map derivs
             // dF / dy = s^T . A . R' . (A1^-1 . dLDdp . A1) . R
+            sTARA1Inv = sTAR * B.A1Inv;
             for (int n = 0; n < nwav; ++n) {
-                sTARdLDdpA1 = sTAR * A1dLDdpA1(n);
+                if (use_ld_op) {
+                    sTARdLDdpA1 = getIndex(ld_op_norm, n) * (sTAR * ld_op(n)) +
+                                  (sTAR.dot(LDRy.col(n).transpose()) /
+                                   getIndex(rTA1Ry, n)) *
+                                  (B.rTA1 - getIndex(ld_op_norm, n) *
+                                   rTA1ld_op.row(n));
+                } else {
+                    dotdLDdp(n, sTARA1Inv, sTARA1InvdLDdp);
+                    sTARdLDdpA1 = sTARA1InvdLDdp * B.A1;
+                }
                 if (theta == 0) {
                     for (int i = 0; i < N; ++i)
                         dF(4 + i, n) = sTARdLDdpA1(i);
                 } else {
-                    for (int l = 0; l < lmax + 1; ++l)
-                        sTARdLDdpA1R.segment(l * l, 2 * l + 1) =
-                            sTARdLDdpA1.segment(l * l, 2 * l + 1) * W.R[l];
+                    W.dotR(sTARdLDdpA1, sTARdLDdpA1R);
                     for (int i = 0; i < N; ++i)
                         dF(4 + i, n) = sTARdLDdpA1R(i);
                 }
@@ -1956,17 +2844,16 @@ namespace maps {
                 update_p_u_derivs = false;
             }
 
-            // TODO: Can be sped up
             // Compute the derivs with respect to the limb darkening coeffs
             // dF / du = s^T . A . R' . A1^-1 . dLDdp_u . dp_udu
             for (int n = 0; n < nwav; ++n) {
-                dFdp_u = sTAR * B.A1Inv * dLDdp_u(n);
+                dotdLDdp_u(n, sTARA1Inv, dFdp_u);
                 dFdu = dFdp_u * dp_udu(n);
                 dF.block(4 + N, n, lmax, 1) = dFdu.segment(1, lmax).transpose();
             }
 
             // Dot the result in and we're done
-            return G.sT * ARLDRy;
+            return G.sT.template cast<Scalar<T>>() * ARLDRy;
 
         }
 
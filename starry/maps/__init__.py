@@ -1,2 +1,2 @@
-from .maps import load_map, gaussian
+from .maps import load_map, gaussian, image2array, gaussian_array
 from .plotting import show, animate
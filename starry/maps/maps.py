@@ -10,7 +10,8 @@ from scipy.special import ive as BesselI
 import os
 
 
-__all__ = ["load_map", "image2map", "healpix2map"]
+__all__ = ["load_map", "image2map", "healpix2map", "image2array",
+           "gaussian_array"]
 
 
 def load_map(image, lmax=10, healpix=False):
@@ -54,8 +55,8 @@ def healpix2map(healpix_map, lmax=10):
     return ylm
 
 
-def image2map(image, lmax=10):
-    """Return a map vector corresponding to a lat-long map image."""
+def image2array(image):
+    """Return the normalized grayscale array of a lat-long map image."""
     # If image doesn't exist, check for it in maps directory
     if not os.path.exists(image):
         dn = os.path.dirname
@@ -68,9 +69,12 @@ def image2map(image, lmax=10):
     image_array = pil_to_array(grayscale_pil_image)
     image_array = np.array(image_array, dtype=float)
     image_array /= np.max(image_array)
+    return image_array
+
 
-    # Convert it to a map
-    return array2map(image_array, lmax=lmax)
+def image2map(image, lmax=10):
+    """Return a map vector corresponding to a lat-long map image."""
+    return array2map(image2array(image), lmax=lmax)
 
 
 def array2map(image_array, lmax=10):
@@ -97,16 +101,20 @@ def array2map(image_array, lmax=10):
     return healpix2map(healpix_map, lmax=lmax)
 
 
-def gaussian(sigma=0.1, lmax=10, res=500):
-    """Return a spherical harmonic expansion of a Gaussian."""
+def gaussian_array(sigma=0.1, res=500):
+    """Return a lat-long image of a Gaussian."""
     lon = np.linspace(-np.pi, np.pi, res * 2)
     lat = np.linspace(-np.pi / 2, np.pi / 2, res)
     lon, lat = np.meshgrid(lon, lat)
     z = np.cos(lat) * np.cos(lon)
     w = sigma ** -2
     norm = np.pi * BesselI(0, w)
-    g = norm * np.exp((z - 1) / sigma ** 2)
-    y = array2map(g, lmax=lmax)
+    return norm * np.exp((z - 1) / sigma ** 2)
+
+
+def gaussian(sigma=0.1, lmax=10, res=500):
+    """Return a spherical harmonic expansion of a Gaussian."""
+    y = array2map(gaussian_array(sigma=sigma, res=res), lmax=lmax)
     # NOTE: Force the constant term to zero so we
     # add no net flux. We need to think carefully
     # about this.
@@ -1,15 +1,15 @@
 /**
 Defines functions used to find the minimum of a map.
 
-TODO: The `pow()` calls in `evaluate()` and `operator()` are SUPER
-      slow. Let's use the same trick as in `maps.h` to speed this up.
-
 */
 
 #ifndef _STARRY_MIN_H_
 #define _STARRY_MIN_H_
 
 #include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <limits>
 #include <Eigen/Core>
 #include <LBFGS.h>
 #include "errors.h"
@@ -22,6 +22,254 @@ namespace minimize {
     using namespace LBFGSpp;
     using std::abs;
 
+    /**
+    The exponents of `x`, `y` and `z` in each term of the polynomial
+    basis, in the order of the polynomial map: `x^(mu / 2) y^(nu / 2)`
+    for even `nu` and `x^((mu - 1) / 2) y^((nu - 1) / 2) z` for odd
+    `nu`, where `mu = l - m` and `nu = l + m`.
+
+    */
+    inline void polyExponents(int lmax, std::vector<int>& i,
+                              std::vector<int>& j, std::vector<int>& k) {
+        i.clear();
+        j.clear();
+        k.clear();
+        for (int l = 0; l < lmax + 1; l++) {
+            for (int m = -l; m < l + 1; m++) {
+                int mu = l - m;
+                int nu = l + m;
+                k.push_back(nu % 2);
+                i.push_back((mu - k.back()) / 2);
+                j.push_back((nu - k.back()) / 2);
+            }
+        }
+    }
+
+    /**
+    The inverse of the symmetric 3x3 matrix `A - mu`, computed
+    from its adjugate.
+
+    */
+    template <typename S>
+    inline void shiftedInverse(const Eigen::Matrix<S, 3, 3>& A, const S& mu,
+                               Eigen::Matrix<S, 3, 3>& inv) {
+        S a = A(0, 0) - mu, b = A(0, 1), c = A(0, 2),
+          d = A(1, 1) - mu, e = A(1, 2), f = A(2, 2) - mu;
+        inv(0, 0) = d * f - e * e;
+        inv(0, 1) = c * e - b * f;
+        inv(0, 2) = b * e - c * d;
+        inv(1, 1) = a * f - c * c;
+        inv(1, 2) = b * c - a * e;
+        inv(2, 2) = a * d - b * b;
+        inv(1, 0) = inv(0, 1);
+        inv(2, 0) = inv(0, 2);
+        inv(2, 1) = inv(1, 2);
+        inv /= a * inv(0, 0) + b * inv(0, 1) + c * inv(0, 2);
+    }
+
+    /**
+    The exact minimum on the unit sphere of the part of degree two or
+    less of the polynomial map `p`. Since `z^2 = 1 - x^2 - y^2` on the
+    sphere, we can write it as `f(v) = v^T A v + b^T v` with
+    `v = (x, y, z)`. By Lagrangian duality, which is exact for a single
+    quadratic constraint, its minimum is the maximum over `mu <= lambda`,
+    the smallest eigenvalue of `A`, of the concave function
+
+        g(mu) = mu - b^T w / 4,     w = (A - mu)^-1 b.
+
+    Its stationary point is the root of `1 / |w| - 1 / 2`, which we find
+    with a safeguarded Newton iteration from the left. At each iterate,
+    `v = -w / 2` plus a multiple of the eigenvector of `lambda` is a
+    point on the sphere, so `f(v)` bounds the minimum from above
+    (More & Sorensen 1983); we stop when the gap closes. We return
+    `g(mu)`, which never overestimates the minimum (up to roundoff),
+    even if the iteration does not converge.
+
+    */
+    template <typename S>
+    inline S quadraticMinimum(const S* p) {
+
+        typedef Eigen::Matrix<S, 3, 3> Matrix3S;
+        typedef Eigen::Matrix<S, 3, 1> Vector3S;
+
+        // The quadratic form; the basis is
+        // 1, x, z, y, x^2, xz, xy, yz, y^2
+        Matrix3S A;
+        A << p[0] + p[4], p[6] / 2, p[5] / 2,
+             p[6] / 2, p[0] + p[8], p[7] / 2,
+             p[5] / 2, p[7] / 2, p[0];
+        Vector3S b;
+        b << p[1], p[3], p[2];
+
+        // Smallest eigenvalue of `A` (Smith 1961)
+        S q = A.trace() / 3;
+        S p1 = A(0, 1) * A(0, 1) + A(0, 2) * A(0, 2) + A(1, 2) * A(1, 2);
+        S p2 = (A(0, 0) - q) * (A(0, 0) - q) + (A(1, 1) - q) * (A(1, 1) - q)
+               + (A(2, 2) - q) * (A(2, 2) - q) + 2 * p1;
+        S lambda = q;
+        if (p2 > 0) {
+            S r = sqrt(p2 / 6);
+            Matrix3S B = (A - q * Matrix3S::Identity()) / r;
+            S det = (B(0, 0) * (B(1, 1) * B(2, 2) - B(1, 2) * B(1, 2))
+                     - B(0, 1) * (B(0, 1) * B(2, 2) - B(1, 2) * B(0, 2))
+                     + B(0, 2) * (B(0, 1) * B(1, 2) - B(1, 1) * B(0, 2))) / 2;
+            if (det < -1) det = -1;
+            else if (det > 1) det = 1;
+            lambda = q + 2 * r * cos(acos(det) / 3 + 2 * pi<S>() / 3);
+        }
+        S bnorm = b.norm();
+        if (bnorm == 0)
+            return lambda;
+
+        // Its eigenvector: the largest cross product
+        // of two rows of `A - lambda`
+        Matrix3S R = A - lambda * Matrix3S::Identity();
+        Vector3S e = Vector3S::UnitX(), cross;
+        S enorm = 0;
+        for (int r1 = 0; r1 < 3; ++r1) {
+            int r2 = (r1 + 1) % 3;
+            cross << R(r1, 1) * R(r2, 2) - R(r1, 2) * R(r2, 1),
+                     R(r1, 2) * R(r2, 0) - R(r1, 0) * R(r2, 2),
+                     R(r1, 0) * R(r2, 1) - R(r1, 1) * R(r2, 0);
+            if (cross.norm() > enorm) {
+                enorm = cross.norm();
+                e = cross / enorm;
+            }
+        }
+
+        // The root is always in `[lambda - |b| / 2, lambda]`
+        S lo = lambda - bnorm / 2, hi = lambda, mu = lo;
+        S glo = -std::numeric_limits<S>::infinity(),
+          fmin = std::numeric_limits<S>::infinity();
+        S tol = 10 * mach_eps<S>() * (A.norm() + bnorm);
+        S phi_prev = std::numeric_limits<S>::infinity();
+        Matrix3S inv;
+        Vector3S w, v;
+        for (int k = 0; k < STARRY_QUAD_MAX_ITER; ++k) {
+            shiftedInverse(A, mu, inv);
+            w = inv * b;
+            S wnorm = w.norm();
+
+            // In exact arithmetic `|w| <= 2` at the left end of the
+            // bracket, with equality when `b` is an eigenvector of
+            // `lambda` (as for any axisymmetric map). The root is then
+            // at `lo` itself, so we accept it there up to roundoff.
+            if ((wnorm <= 2) ||
+                ((k == 0) && (wnorm <= 2 * (1 + 2 * tol / bnorm)))) {
+
+                // Lower bound from the dual
+                lo = mu;
+                glo = mu - b.dot(w) / 4;
+
+                // Upper bound from a point on the sphere
+                S we = w.dot(e) / 2;
+                S disc2 = we * we + 1 - wnorm * wnorm / 4;
+                S disc = (disc2 > 0) ? S(sqrt(disc2)) : S(0);
+                for (int sgn = -1; sgn < 2; sgn += 2) {
+                    v = -w / 2 + (we + sgn * disc) * e;
+                    S f = v.dot(A * v) + b.dot(v);
+                    if (f < fmin) fmin = f;
+                }
+                if (fmin - glo <= tol)
+                    break;
+
+            } else {
+                hi = mu;
+            }
+
+            // Newton step, or bisection if it is out of bounds
+            // or the last one did not make enough progress
+            S phi = 1 / wnorm - S(0.5);
+            S next = mu + phi * wnorm * wnorm * wnorm / w.dot(inv * w);
+            if (!((next > lo) && (next < hi)) || (abs(phi) > phi_prev / 2))
+                next = (lo + hi) / 2;
+            phi_prev = abs(phi);
+            if ((next <= lo) || (next >= hi))
+                break;
+            mu = next;
+        }
+        return glo;
+
+    }
+
+    /**
+    The specific intensity of a polynomial map as a function of the
+    angles `(theta, phi)` on the sphere, used as the objective function
+    in the minimization problem to determine if a map is positive
+    semi-definite. Since the LBFGS solver calls it with its own state,
+    each thread needs its own instance.
+
+    */
+    template <class S>
+    class Objective {
+
+        protected:
+
+            const std::vector<int>& i;
+            const std::vector<int>& j;
+            const std::vector<int>& k;
+            const S* p;
+            Vector<S> xpow;
+            Vector<S> ypow;
+
+        public:
+
+            Objective(int lmax, const std::vector<int>& i,
+                      const std::vector<int>& j, const std::vector<int>& k,
+                      const S* p) : i(i), j(j), k(k), p(p),
+                                    xpow(lmax + 1), ypow(lmax + 1) {}
+
+            S operator()(const Vector<S>& angles, Vector<S>& grad) {
+
+                // Ensure in range
+                S theta = mod2pi(angles(0)),
+                  phi = mod2pi(angles(1));
+                S sint = sin(theta),
+                  cost = cos(theta),
+                  sinp = sin(phi),
+                  cosp = cos(phi);
+                S x0 = sint * cosp;
+                S y0 = sint * sinp;
+                S z0 = cost;
+
+                // Powers of x and y
+                xpow(0) = 1;
+                ypow(0) = 1;
+                for (int n = 1; n < xpow.size(); ++n) {
+                    xpow(n) = xpow(n - 1) * x0;
+                    ypow(n) = ypow(n - 1) * y0;
+                }
+
+                // The intensity and its derivatives in x, y, z
+                S I = 0, dIdx = 0, dIdy = 0, dIdz = 0;
+                for (size_t n = 0; n < i.size(); ++n) {
+                    if (p[n] == 0) continue;
+                    S val = p[n] * ypow(j[n]);
+                    S zval = k[n] ? val * z0 : val;
+                    if (i[n] > 0)
+                        dIdx += i[n] * xpow(i[n] - 1) * zval;
+                    zval *= xpow(i[n]);
+                    I += zval;
+                    if (j[n] > 0)
+                        dIdy += j[n] * p[n] * ypow(j[n] - 1) *
+                                xpow(i[n]) * (k[n] ? z0 : S(1));
+                    if (k[n])
+                        dIdz += val * xpow(i[n]);
+                }
+
+                // Throw an exception if the map is negative; this
+                // will be caught in the enclosing scope
+                if (I < 0) throw errors::MapIsNegative();
+
+                // Chain rule for the gradient in (theta, phi)
+                grad(0) = cost * (cosp * dIdx + sinp * dIdy) - sint * dIdz;
+                grad(1) = sint * (cosp * dIdy - sinp * dIdx);
+                return I;
+
+            }
+
+    };
+
     // Misc stuff for fast map minimization
     template <class T>
     class Minimizer {
@@ -32,219 +280,190 @@ namespace minimize {
             int npts;
             Vector<Scalar<T>> theta;
             Vector<Scalar<T>> phi;
-            LBFGSParam<Scalar<T>> param;
-            LBFGSSolver<Scalar<T>> solver;
-            Vector<Scalar<T>> angles;
-            Scalar<T> minimum, val;
-            int niter;
-            Vector<Scalar<T>> p;
-
-            // Determine if the map is positive semi-definite
-            bool psd(const Vector<Scalar<T>>& p_new,
-                     const Scalar<T>& epsilon=1e-6,
-                     const int max_iterations=100) {
-
-                // Update the polynomial map and bind the function
-                p = p_new;
-                std::function<Scalar<T> (const Vector<Scalar<T>>& angles,
-                                         Vector<Scalar<T>>& grad)> functor =
-                    std::bind(*this, std::placeholders::_1,
-                                     std::placeholders::_2);
-
-                // Do a coarse grid search for the global minimum
-                angles(0) = 0;
-                angles(1) = 0;
-                minimum = evaluate(p, angles(0), angles(1));
-                if (minimum < 0) return false;
-                for (int u = 0; u < npts; u++) {
-                    for (int v = 0; v < npts; v++) {
-                        val = evaluate(p, theta(u), phi(v));
-                        if (val < 0) {
-                            // Our job is done!
-                            return false;
-                        } else if (val < minimum) {
-                            minimum = val;
-                            angles(0) = theta(u);
-                            angles(1) = phi(v);
+            Matrix<Scalar<T>> grid;
+            Vector<Scalar<T>> bound;
+            std::vector<int> fa;
+            std::vector<int> fb;
+            std::vector<int> i;
+            std::vector<int> j;
+            std::vector<int> k;
+
+            /**
+            A quadratic polynomial map that bounds the map `p` from below
+            on the sphere. Every term of degree `l > 2` contains two
+            factors `a` and `b` (each one of `x`, `y`, `z`); since the
+            others are bounded by one, `|c x^i y^j z^k| <= |c| |a b| <=
+            |c| (a^2 + b^2) / 2`.
+
+            */
+            Eigen::Matrix<Scalar<T>, 9, 1> minorant(
+                    const Eigen::Ref<const Vector<Scalar<T>>>& p) {
+                Eigen::Matrix<Scalar<T>, 9, 1> q = p.head(9);
+                for (int n = 9; n < p.size(); ++n) {
+                    Scalar<T> w = abs(p(n)) / 2;
+                    for (int f : {fa[n], fb[n]}) {
+                        if (f == 0) {
+                            q(4) -= w;
+                        } else if (f == 1) {
+                            q(8) -= w;
+                        } else {
+                            // z^2 = 1 - x^2 - y^2
+                            q(0) -= w;
+                            q(4) += w;
+                            q(8) += w;
                         }
                     }
                 }
+                return q;
+            }
 
-                // Now refine it with gradient descent
-                param.epsilon = epsilon;
-                param.max_iterations = max_iterations;
-                try {
-                    niter = solver.minimize(functor, angles, minimum);
-                } catch (const errors::MapIsNegative& e) {
-                    return false;
-                }
-                if (minimum >= 0)
-                    return true;
-                else
-                    return false;
+            /**
+            Determine which columns of the polynomial map `P` are
+            positive semi-definite.
 
-            }
+            Maps of degree two are solved exactly (see
+            `quadraticMinimum`). For degrees up to `STARRY_MIN_CERT_DEG`,
+            we first try to certify that the map is positive: since every
+            term of
+            degree `l > 2` is bounded on the sphere, the map is PSD if
+            the minimum of its part of degree two or less exceeds the sum
+            of these bounds, or if its quadratic `minorant` is PSD. This
+            is often the case for smooth maps.
 
-            // Evaluate a map at a given (theta, phi) coordinate (no rotation)
-            Scalar<T> evaluate(const Vector<Scalar<T>>& p,
-                               const Scalar<T>& theta, const Scalar<T>& phi) {
-                Scalar<T> sint = sin(theta),
-                          cost = cos(theta),
-                          sinp = sin(phi),
-                          cosp = cos(phi);
-                int l, m, mu, nu, n = 0;
-                Scalar<T> x0 = sint * cosp;
-                Scalar<T> y0 = sint * sinp;
-                Scalar<T> z0 = cost;
-                Scalar<T> res = 0;
-                for (l = 0; l < lmax + 1; l++) {
-                    for (m = -l; m < l + 1; m++) {
-                        if (abs(p(n)) > 10 * mach_eps<Scalar<T>>()) {
-                            mu = l - m;
-                            nu = l + m;
-                            if ((nu % 2) == 0) {
-                                if ((mu > 0) && (nu > 0))
-                                    res += p(n) * pow(x0, mu / 2) *
-                                           pow(y0, nu / 2);
-                                else if (mu > 0)
-                                    res += p(n) * pow(x0, mu / 2);
-                                else if (nu > 0)
-                                    res += p(n) * pow(y0, nu / 2);
-                                else
-                                    res += p(n);
-                            } else {
-                                if ((mu > 1) && (nu > 1))
-                                    res += p(n) * pow(x0, (mu - 1) / 2) *
-                                           pow(y0, (nu - 1) / 2) * z0;
-                                else if (mu > 1)
-                                    res += p(n) * pow(x0, (mu - 1) / 2) * z0;
-                                else if (nu > 1)
-                                    res += p(n) * pow(y0, (nu - 1) / 2) * z0;
-                                else
-                                    res += p(n) * z0;
-                            }
-                        }
-                        n++;
-                    }
+            We evaluate the remaining columns on a coarse grid on the sphere at
+            once, as a single product of the tabulated polynomial basis
+            with `P`. Any negative value means we are done. Otherwise,
+            we refine the `nrestarts` lowest local minima of the grid
+            of each column with gradient descent. Since these are
+            independent, they are distributed over `nthreads` threads
+            (zero means one per hardware thread).
 
-                }
-                return res;
+            */
+            std::vector<bool> psd(const Matrix<Scalar<T>>& P,
+                                  const Scalar<T>& epsilon=1e-6,
+                                  const int max_iterations=100,
+                                  const int nrestarts=STARRY_MIN_RESTARTS,
+                                  const int nthreads=1) {
 
-            }
+                // Exact solution for quadratic maps
+                // and positivity certificate for the rest
+                std::vector<bool> result(P.cols(), true);
+                std::vector<int> cols;
+                for (int c = 0; c < P.cols(); ++c) {
+                    int n = P.rows() - 1;
+                    while ((n > 0) && (P(n, c) == 0))
+                        --n;
+                    int deg = i[n] + j[n] + k[n];
+                    if (deg <= 2) {
+                        Scalar<T> tol = 10 * mach_eps<Scalar<T>>() *
+                                        P.col(c).cwiseAbs().sum();
+                        result[c] = (quadraticMinimum(P.col(c).data())
+                                     >= -tol);
+                    } else if (deg <= STARRY_MIN_CERT_DEG) {
+                        Scalar<T> rest = 0;
+                        for (n = 9; n < P.rows(); ++n)
+                            rest += abs(P(n, c)) * bound(n);
+                        if ((quadraticMinimum(P.col(c).data()) < rest) &&
+                            (quadraticMinimum(minorant(P.col(c)).data()) < 0))
+                            cols.push_back(c);
+                    } else {
+                        cols.push_back(c);
+                    }
+                }
+                int ncols = cols.size();
+                if (ncols == 0)
+                    return result;
+                Matrix<Scalar<T>> Pc(P.rows(), ncols);
+                for (int c = 0; c < ncols; ++c)
+                    Pc.col(c) = P.col(cols[c]);
 
-            // Computes the specific intensity as a function of theta and phi.
-            // Used as the objective function in the minimization problem to
-            // determine if a map is positive semi-definite.
-            Scalar<T> operator()(const Vector<Scalar<T>>& angles,
-                                 Vector<Scalar<T>>& grad) {
+                // Coarse grid search for the global minimum
+                Matrix<Scalar<T>> vals = grid * Pc;
+                std::vector<std::pair<int, int>> tasks;
+                std::vector<std::pair<Scalar<T>, int>> minima;
+                for (int c = 0; c < ncols; ++c) {
+                    if (vals.col(c).minCoeff() < 0) {
+                        // Our job is done!
+                        result[cols[c]] = false;
+                        continue;
+                    }
 
-                // Ensure in range
-                Scalar<T> theta = mod2pi(angles(0)),
-                          phi = mod2pi(angles(1));
-
-                // Avoid singular points in the derivative. In principle we
-                // could re-parametrize, but it's not really worth it...
-                Scalar<T> tol = 1e-12;
-                if (abs(theta) < tol)
-                    theta = tol;
-                if (abs(theta - pi<Scalar<T>>()) < tol)
-                    theta = pi<Scalar<T>>() + tol;
-                if (abs(phi) < tol)
-                    phi = tol;
-                if (abs(phi - pi<Scalar<T>>()) < tol)
-                    phi = pi<Scalar<T>>() + tol;
-                Scalar<T> sint = sin(theta),
-                          cost = cos(theta),
-                          tant = tan(theta),
-                          sinp = sin(phi),
-                          cosp = cos(phi),
-                          tanp = tan(phi);
-                int l, m, mu, nu, n = 0;
-                Scalar<T> x0 = sint * cosp;
-                Scalar<T> y0 = sint * sinp;
-                Scalar<T> z0 = cost;
-                Scalar<T> I = 0;
-                Scalar<T> dIdt = 0;
-                Scalar<T> dIdp = 0;
-                Scalar<T> val;
-                for (l = 0; l < lmax + 1; l++) {
-                    for (m = -l; m < l + 1; m++) {
-                        if (abs(p(n)) > 10 * mach_eps<Scalar<T>>()) {
-                            mu = l - m;
-                            nu = l + m;
-                            if ((nu % 2) == 0) {
-                                if ((mu > 0) && (nu > 0)) {
-                                    val = p(n) * pow(x0, mu / 2) *
-                                          pow(y0, nu / 2);
-                                    I += val;
-                                    dIdt += 0.5 * (mu + nu) / tant * val;
-                                    dIdp += 0.5 * (nu / tanp - mu * tanp) * val;
-                                } else if (mu > 0) {
-                                    val = p(n) * pow(x0, mu / 2);
-                                    I += val;
-                                    dIdt += 0.5 * mu / tant * val;
-                                    dIdp += 0.5 * (-mu * tanp) * val;
-                                } else if (nu > 0) {
-                                    val = p(n) * pow(y0, nu / 2);
-                                    I += val;
-                                    dIdt += 0.5 * nu / tant * val;
-                                    dIdp += 0.5 * (nu / tanp) * val;
-                                } else {
-                                    val = p(n);
-                                    I += val;
-                                    dIdt += 0;
-                                    dIdp += 0;
-                                }
-                            } else {
-                                if ((mu > 1) && (nu > 1)) {
-                                    val = p(n) * pow(x0, (mu - 1) / 2) *
-                                                 pow(y0, (nu - 1) / 2) * z0;
-                                    I += val;
-                                    dIdt += (0.5 * (-2 + mu + nu) / tant - tant)
-                                            * val;
-                                    dIdp += 0.5 * (1 - mu + (-1 + nu) /
-                                                            (tanp * tanp)) *
-                                                  tanp * val;
-                                } else if (mu > 1) {
-                                    val = p(n) * pow(x0, (mu - 1) / 2) * z0;
-                                    I += val;
-                                    dIdt += (0.5 * (-1 + mu) / tant - tant)
-                                            * val;
-                                    dIdp += -0.5 * (-1 + mu) * tanp * val;
-                                } else if (nu > 1) {
-                                    val = p(n) * pow(y0, (nu - 1) / 2) * z0;
-                                    I += val;
-                                    dIdt += (0.5 * (-1 + nu) / tant - tant)
-                                            * val;
-                                    dIdp += 0.5 * (-1 + nu) / tanp * val;
-                                } else {
-                                    val = p(n) * z0;
-                                    I += val;
-                                    dIdt += -tant * val;
-                                    dIdp += 0;
-                                }
-                            }
+                    // Find the local minima on the grid. The first
+                    // point is the pole; the rest are indexed by
+                    // `1 + u * npts + v`, where `phi` is periodic
+                    minima.clear();
+                    minima.push_back(std::make_pair(vals(0, c), 0));
+                    for (int u = 0; u < npts; ++u) {
+                        for (int v = 0; v < npts; ++v) {
+                            Scalar<T> val = vals(1 + u * npts + v, c);
+                            if (((u > 0) &&
+                                 (val > vals(1 + (u - 1) * npts + v, c))) ||
+                                ((u < npts - 1) &&
+                                 (val > vals(1 + (u + 1) * npts + v, c))) ||
+                                (val > vals(1 + u * npts +
+                                            (v + npts - 1) % npts, c)) ||
+                                (val > vals(1 + u * npts + (v + 1) % npts, c)))
+                                continue;
+                            minima.push_back(std::make_pair(val,
+                                1 + u * npts + v));
                         }
-                        n++;
                     }
+                    int nmin = std::min(int(minima.size()), nrestarts);
+                    std::partial_sort(minima.begin(), minima.begin() + nmin,
+                                      minima.end());
+                    for (int r = 0; r < nmin; ++r)
+                        tasks.push_back(std::make_pair(c, minima[r].second));
                 }
+                if (tasks.empty())
+                    return result;
 
-                // Throw an exception if the map is negative; this
-                // will be caught in the enclosing scope
-                if (I < 0) throw errors::MapIsNegative();
-
-                // Update the gradient
-                grad(0) = dIdt;
-                grad(1) = dIdp;
-                return I;
+                // Now refine the minima with gradient descent
+                std::vector<std::atomic<bool>> negative(ncols);
+                for (auto& flag : negative)
+                    flag = false;
+                std::atomic<size_t> next(0);
+                auto work = [&](int) {
+                    LBFGSParam<Scalar<T>> param;
+                    param.epsilon = epsilon;
+                    param.max_iterations = max_iterations;
+                    LBFGSSolver<Scalar<T>> solver(param);
+                    Vector<Scalar<T>> angles(2);
+                    Scalar<T> minimum;
+                    for (size_t t = next++; t < tasks.size(); t = next++) {
+                        int c = tasks[t].first;
+                        if (negative[c]) continue;
+                        Objective<Scalar<T>> functor(lmax, i, j, k,
+                                                     Pc.col(c).data());
+                        int g = tasks[t].second;
+                        if (g == 0) {
+                            angles(0) = 0;
+                            angles(1) = 0;
+                        } else {
+                            angles(0) = theta((g - 1) / npts);
+                            angles(1) = phi((g - 1) % npts);
+                        }
+                        try {
+                            solver.minimize(functor, angles, minimum);
+                        } catch (const errors::MapIsNegative& e) {
+                            negative[c] = true;
+                            continue;
+                        }
+                        if (minimum < 0)
+                            negative[c] = true;
+                    }
+                };
+                runThreads(std::min(numThreads(nthreads), int(tasks.size())),
+                           work);
+                for (int c = 0; c < ncols; ++c) {
+                    if (negative[c])
+                        result[cols[c]] = false;
+                }
+                return result;
 
             }
 
             // Constructor: compute the matrices
-            explicit Minimizer(int lmax) : lmax(lmax), param(), solver(param),
-                                           angles(Vector<Scalar<T>>::Zero(2)),
-                                           p(Vector<Scalar<T>>::Zero((lmax + 1)
-                                                                * (lmax + 1))){
+            explicit Minimizer(int lmax) : lmax(lmax) {
 
                 // A spherical harmonic of degree `l` has at most
                 // `lmax^2 - lmax + 2` extrema
@@ -255,10 +474,63 @@ namespace minimize {
                 npts = ceil(sqrt(4 * (lmax * lmax - lmax + 2)));
                 theta.resize(npts);
                 phi.resize(npts);
-                for (int i = 0; i < npts; i++) {
-                    theta(i) = acos(2.0 * (Scalar<T>(i) / (npts + 1)) - 1.0);
-                    phi(i) = 2.0 * pi<Scalar<T>>() *
-                                   (Scalar<T>(i) / (npts + 1));
+                for (int u = 0; u < npts; u++) {
+                    theta(u) = acos(2.0 * (Scalar<T>(u) / (npts + 1)) - 1.0);
+                    phi(u) = 2.0 * pi<Scalar<T>>() *
+                                   (Scalar<T>(u) / (npts + 1));
+                }
+
+                // Tabulate the polynomial basis on the grid, starting
+                // with the pole at `theta = phi = 0`
+                polyExponents(lmax, i, j, k);
+                int N = (lmax + 1) * (lmax + 1);
+                grid.resize(npts * npts + 1, N);
+                Vector<Scalar<T>> xpow(lmax + 1), ypow(lmax + 1);
+                for (int g = 0; g < grid.rows(); ++g) {
+                    Scalar<T> x0 = 0, y0 = 0, z0 = 1;
+                    if (g > 0) {
+                        Scalar<T> t = theta((g - 1) / npts),
+                                  f = phi((g - 1) % npts);
+                        x0 = sin(t) * cos(f);
+                        y0 = sin(t) * sin(f);
+                        z0 = cos(t);
+                    }
+                    xpow(0) = 1;
+                    ypow(0) = 1;
+                    for (int n = 1; n < lmax + 1; ++n) {
+                        xpow(n) = xpow(n - 1) * x0;
+                        ypow(n) = ypow(n - 1) * y0;
+                    }
+                    for (int n = 0; n < N; ++n)
+                        grid(g, n) = xpow(i[n]) * ypow(j[n]) *
+                                     (k[n] ? z0 : Scalar<T>(1));
+                }
+
+                // The maximum of `|x^i y^j z^k|` on the sphere is
+                // at `x^2 = i / l`, `y^2 = j / l`, `z^2 = k / l`
+                // Two of the factors of each term, `0, 1, 2` for
+                // `x, y, z`: the one with the largest exponent, twice
+                // if it appears more than once
+                fa.resize(N);
+                fb.resize(N);
+                for (int n = 0; n < N; ++n) {
+                    int e[3] = {i[n], j[n], k[n]};
+                    int f1 = std::max_element(e, e + 3) - e;
+                    fa[n] = f1;
+                    fb[n] = f1;
+                    if (e[f1] < 2) {
+                        e[f1] = -1;
+                        fb[n] = std::max_element(e, e + 3) - e;
+                    }
+                }
+                bound.resize(N);
+                for (int n = 0; n < N; ++n) {
+                    Scalar<T> l = i[n] + j[n] + k[n];
+                    bound(n) = 1;
+                    if (i[n] > 0) bound(n) *= pow(i[n] / l, Scalar<T>(i[n]));
+                    if (j[n] > 0) bound(n) *= pow(j[n] / l, Scalar<T>(j[n]));
+                    if (k[n] > 0) bound(n) *= pow(k[n] / l, Scalar<T>(k[n]));
+                    bound(n) = sqrt(bound(n));
                 }
 
             }
@@ -0,0 +1,268 @@
+/**
+Optional instrumentation of the hot paths.
+
+When compiled with `STARRY_PROFILE=1`, the expensive stages of the
+flux computation (the Wigner rotation, limb darkening, the occultation
+solvers, the Kepler solver and the exposure time integration) record
+the number of times they were called and the cumulative number of
+clock ticks spent in them. We also keep a histogram of the depth at
+which the adaptive exposure integration terminates and the number of
+hits and misses of the `Map` and `Wigner` caches and of the limb
+darkening interpolation table (a miss is a rebuild of the table).
+
+For the occultation solvers we also count the numerical branch taken
+in each call (tabulated values, upward or downward recursion for the
+`I` and `J` primitive integrals, and the regime that decides whether
+the expression for `s2` is stable) and keep histograms of the number
+of terms summed in the `I` and `J` series and of the number of
+iterations of the elliptic integral (AGM-like) loops.
+
+Timings are inclusive, i.e., the time spent in `integrate` includes
+the time spent in all the other stages during the exposure. The clock
+is the time stamp counter on x86 and a nanosecond clock elsewhere.
+
+All counters live in a single process-wide table and are updated with
+relaxed atomics, so they are safe (if not exact to the last tick) when
+several threads compute light curves at once. When `STARRY_PROFILE=0`
+(the default) the instrumentation macros expand to nothing.
+
+*/
+
+#ifndef _STARRY_PROFILE_H_
+#define _STARRY_PROFILE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "utils.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace starry {
+namespace profile {
+
+    //! The instrumented stages
+    enum Stage {
+        ROTATE = 0,
+        LIMB_DARKEN,
+        GREENS,
+        GREENS_GRAD,
+        GREENS_LD,
+        KEPLER,
+        INTEGRATE,
+        NSTAGES
+    };
+
+    //! The instrumented caches
+    enum CacheId {
+        MAP_CACHE = 0,
+        WIGNER_ROTATE,
+        WIGNER_AXIS,
+        WIGNER_MATRIX,
+        LD_TABLE,
+        NCACHES
+    };
+
+    //! The numerical branches of the occultation solvers
+    enum Branch {
+        G_I_TABULATED = 0,
+        G_I_DOWN,
+        G_I_UP,
+        G_J_DOWN,
+        G_J_UP,
+        L_I_TABULATED,
+        L_I_DOWN,
+        L_I_UP,
+        L_J_SERIES,
+        L_J_CHEB,
+        L_J_UP,
+        S2_STABLE,
+        S2_R_GT_ONE,
+        S2_BMR_ZERO,
+        S2_BMR_ONE,
+        S2_BPR_ONE,
+        NBRANCHES
+    };
+
+    //! The iterative series and loops
+    enum Series {
+        SERIES_I = 0,
+        SERIES_J,
+        SERIES_ELLIP,
+        NSERIES
+    };
+
+    //! Number of bins in the exposure recursion depth histogram
+    static const int NDEPTH = 64;
+
+    //! Number of bins in the series length histograms
+    static const int NTERMS = 256;
+
+    //! Names of the stages, as exposed to Python
+    static const char* const stage_names[NSTAGES] = {
+        "rotate", "limbDarken", "G", "G_grad", "L", "kepler", "integrate"
+    };
+
+    //! Names of the caches, as exposed to Python
+    static const char* const cache_names[NCACHES] = {
+        "map", "wigner_rotate", "wigner_axis", "wigner_R", "ld_table"
+    };
+
+    //! Names of the solver branches, as exposed to Python
+    static const char* const branch_names[NBRANCHES] = {
+        "G_I_tabulated", "G_I_down", "G_I_up", "G_J_down", "G_J_up",
+        "L_I_tabulated", "L_I_down", "L_I_up", "L_J_series", "L_J_cheb",
+        "L_J_up", "s2_stable", "s2_r_gt_one", "s2_bmr_zero", "s2_bmr_one",
+        "s2_bpr_one"
+    };
+
+    //! Names of the series, as exposed to Python
+    static const char* const series_names[NSERIES] = {
+        "I", "J", "ellip"
+    };
+
+    //! Name of the clock used to time the stages
+#if defined(__x86_64__) || defined(__i386__)
+    static const char* const clock_name = "rdtsc";
+#else
+    static const char* const clock_name = "ns";
+#endif
+
+    /**
+    The table of counters.
+
+    */
+    struct Counters {
+
+        std::atomic<uint64_t> calls[NSTAGES];                               /**< Number of calls to each stage */
+        std::atomic<uint64_t> ticks[NSTAGES];                               /**< Cumulative clock ticks in each stage */
+        std::atomic<uint64_t> depth[NDEPTH];                                /**< Histogram of exposure recursion depths */
+        std::atomic<uint64_t> hits[NCACHES];                                /**< Number of cache hits */
+        std::atomic<uint64_t> misses[NCACHES];                              /**< Number of cache misses */
+        std::atomic<uint64_t> branches[NBRANCHES];                          /**< Number of times each solver branch was taken */
+        std::atomic<uint64_t> terms[NSERIES][NTERMS];                       /**< Histograms of the number of terms in each series */
+
+        Counters() {
+            reset();
+        }
+
+        inline void reset() {
+            for (int i = 0; i < NSTAGES; ++i) {
+                calls[i].store(0, std::memory_order_relaxed);
+                ticks[i].store(0, std::memory_order_relaxed);
+            }
+            for (int i = 0; i < NDEPTH; ++i)
+                depth[i].store(0, std::memory_order_relaxed);
+            for (int i = 0; i < NCACHES; ++i) {
+                hits[i].store(0, std::memory_order_relaxed);
+                misses[i].store(0, std::memory_order_relaxed);
+            }
+            for (int i = 0; i < NBRANCHES; ++i)
+                branches[i].store(0, std::memory_order_relaxed);
+            for (int i = 0; i < NSERIES; ++i) {
+                for (int n = 0; n < NTERMS; ++n)
+                    terms[i][n].store(0, std::memory_order_relaxed);
+            }
+        }
+
+    };
+
+    //! The process-wide counters
+    inline Counters& counters() {
+        static Counters c;
+        return c;
+    }
+
+    //! Read the clock
+    inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /**
+    Times a stage from construction to destruction.
+
+    */
+    class ScopedTimer {
+
+            const Stage stage;
+            const uint64_t start;
+
+        public:
+
+            explicit ScopedTimer(Stage stage) :
+                stage(stage), start(now()) {}
+
+            ~ScopedTimer() {
+                Counters& c = counters();
+                c.calls[stage].fetch_add(1, std::memory_order_relaxed);
+                c.ticks[stage].fetch_add(now() - start,
+                                         std::memory_order_relaxed);
+            }
+
+    };
+
+    //! Record the depth at which an exposure integration terminated
+    inline void recordDepth(int depth) {
+        if (depth >= NDEPTH) depth = NDEPTH - 1;
+        counters().depth[depth].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Record a cache hit or miss
+    inline void recordCache(CacheId cache, bool hit) {
+        if (hit)
+            counters().hits[cache].fetch_add(1, std::memory_order_relaxed);
+        else
+            counters().misses[cache].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Record a solver branch
+    inline void recordBranch(Branch branch) {
+        counters().branches[branch].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Record the number of terms summed in a series
+    inline void recordTerms(Series series, int nterms) {
+        if (nterms >= NTERMS) nterms = NTERMS - 1;
+        counters().terms[series][nterms].fetch_add(1,
+                                                   std::memory_order_relaxed);
+    }
+
+    //! The stage corresponding to the occultation solver of type `T`
+    template <class T>
+    struct GreensStage {
+        static const Stage value = GREENS;
+    };
+
+    template <class T>
+    struct GreensStage<Eigen::AutoDiffScalar<T>> {
+        static const Stage value = GREENS_GRAD;
+    };
+
+} // namespace profile
+} // namespace starry
+
+#define STARRY_PROFILE_CONCAT_(a, b) a ## b
+#define STARRY_PROFILE_CONCAT(a, b) STARRY_PROFILE_CONCAT_(a, b)
+
+#if STARRY_PROFILE
+#define STARRY_PROFILE_SCOPE(stage) \
+    starry::profile::ScopedTimer STARRY_PROFILE_CONCAT(_starry_timer_, __LINE__)(stage)
+#define STARRY_PROFILE_DEPTH(depth) starry::profile::recordDepth(depth)
+#define STARRY_PROFILE_CACHE(cache, hit) starry::profile::recordCache(cache, hit)
+#define STARRY_PROFILE_BRANCH(branch) starry::profile::recordBranch(branch)
+#define STARRY_PROFILE_TERMS(series, n) starry::profile::recordTerms(series, n)
+#else
+#define STARRY_PROFILE_SCOPE(stage) do {} while (0)
+#define STARRY_PROFILE_DEPTH(depth) do {} while (0)
+#define STARRY_PROFILE_CACHE(cache, hit) do {} while (0)
+#define STARRY_PROFILE_BRANCH(branch) do {} while (0)
+#define STARRY_PROFILE_TERMS(series, n) do {} while (0)
+#endif
+
+#endif
@@ -22,6 +22,14 @@
 #define STARRY_TYPE Vector<Multi>
 #endif
 
+// Monochromatic, single precision
+#ifdef STARRY_MONO_32
+#undef STARRY_NAME
+#undef STARRY_TYPE
+#define STARRY_NAME _starry_mono_32
+#define STARRY_TYPE Vector<float>
+#endif
+
 // Spectral, double precision
 #ifdef STARRY_SPECTRAL_64
 #undef STARRY_NAME
@@ -66,11 +74,19 @@ PYBIND11_MODULE(STARRY_NAME, m) {
     m.doc() = docstrings::starry::doc;
 
     auto Map = bindMap<STARRY_TYPE>(m, "Map");
+
+    // The orbital solutions need times in double precision,
+    // so the single precision module only provides the `Map`
+#ifndef STARRY_MONO_32
     auto mk = m.def_submodule("kepler", docstrings::kepler::doc);
     auto Body = bindBody<STARRY_TYPE>(mk, Map, "Body");
     auto Primary1 = bindPrimary<STARRY_TYPE>(mk, Body, "Primary");
     auto Secondary = bindSecondary<STARRY_TYPE>(mk, Body, "Secondary");
     auto System = bindSystem<STARRY_TYPE>(mk, "System");
+#endif
+
+    m.def("profile", &pybind_interface::profileDict, "reset"_a=false,
+          docstrings::starry::profile);
 
 #ifdef VERSION_INFO
     m.attr("__version__") = VERSION_INFO;
@@ -1,11 +1,9 @@
 /**
 This defines the main Python interface to the code.
 
-TODO: There is a lot of ugly looping and copying in the
-      routines that transform the gradients into python
-      dictionaries. There are four of them here (two in
-      Body, two in System) and two in `pybind_vectorize.h`.
-      These need to be sped up.
+TODO: There is still a lot of ugly looping and copying in the
+      routines that transform the `Map` flux gradients into python
+      dictionaries in `pybind_vectorize.h`. These need to be sped up.
 
 TODO: Add wavelength-dependent radius support
       Two options: arbitrary r(lambda), full computation
@@ -28,12 +26,15 @@ TODO: Add the `add_gaussian` method to spectral starry.
 #include <cmath>
 #include <stdlib.h>
 #include <vector>
+#include <memory>
 #include <type_traits>
 #include "maps.h"
+#include "sht.h"
 #include "docstrings.h"
 #include "utils.h"
 #include "errors.h"
 #include "kepler.h"
+#include "profile.h"
 #include "pybind_vectorize.h"
 #include "pybind_utils.h"
 
@@ -49,6 +50,293 @@ namespace pybind_interface {
     using pybind_utils::get_Ylm_inds;
     using pybind_utils::get_Ul_inds;
 
+    /**
+    Return a light curve gradient buffer in double precision:
+    double specialization (no copy).
+
+    */
+    inline std::shared_ptr<Matrix<double>> gradientAsDouble(
+            const std::shared_ptr<Matrix<double>>& dL) {
+        return dL;
+    }
+
+    /**
+    Return a light curve gradient buffer in double precision:
+    multiprecision specialization (copy).
+
+    */
+    template <typename S>
+    inline std::shared_ptr<Matrix<double>> gradientAsDouble(
+            const std::shared_ptr<Matrix<S>>& dL) {
+        return std::make_shared<Matrix<double>>(dL->template cast<double>());
+    }
+
+    /**
+    Expose a rendered image buffer (see `maps::Map::render`) to Python
+    as a NumPy array of shape `(nframes, res, res)` (or `(nframes, nwav,
+    res, res)`) that points directly into the buffer. As above, the array
+    holds a reference to the buffer.
+
+    */
+    template <typename S>
+    inline py::array_t<double> imageArray(
+            const std::shared_ptr<Matrix<S>>& image, int res, int nwav) {
+        std::shared_ptr<Matrix<double>> img = gradientAsDouble(image);
+        py::capsule base(new std::shared_ptr<Matrix<double>>(img),
+                         [](void* ptr) {
+            delete reinterpret_cast<std::shared_ptr<Matrix<double>>*>(ptr);
+        });
+        ssize_t sz = sizeof(double);
+        ssize_t r = res;
+        ssize_t nframes = img->cols() / nwav;
+        if (nwav == 1)
+            return py::array_t<double>({nframes, r, r}, {r * r * sz, sz, r * sz},
+                                       img->data(), base);
+        else
+            return py::array_t<double>({nframes, ssize_t(nwav), r, r},
+                                       {nwav * r * r * sz, r * r * sz, sz, r * sz},
+                                       img->data(), base);
+    }
+
+    /**
+    Render a map on a grid (see `maps::Map::render`), releasing the GIL.
+
+    */
+    template <typename T>
+    inline py::array_t<double> renderMap(maps::Map<T>& map,
+                                         const Vector<Scalar<T>>& theta,
+                                         int res, int nthreads=0) {
+        auto image = std::make_shared<Matrix<Scalar<T>>>();
+        {
+            py::gil_scoped_release release;
+            map.render(theta, res, *image, nthreads);
+        }
+        return imageArray(image, res, map.nwav);
+    }
+
+    /**
+    Expose a light curve gradient to Python as a dictionary of NumPy
+    arrays that point directly into the `(NT * nwav, ngrad)` gradient
+    buffer (see `kepler::Gradient`). The arrays hold a reference to the
+    buffer, so they remain valid after subsequent calls to `compute`.
+    Scalar parameters map to arrays of shape `(NT)` (or `(NT, nwav)`);
+    the map coefficients of each body are grouped into arrays of shape
+    `(ncoeff, NT)` (or `(ncoeff, NT, nwav)`).
+
+    */
+    inline py::dict gradientDict(const std::shared_ptr<Matrix<double>>& dL,
+                                 const std::vector<std::string>& dL_names,
+                                 int nwav) {
+        auto pygrad = py::dict();
+        if (!dL)
+            return pygrad;
+
+        // The capsule owns a reference to the buffer
+        py::capsule base(new std::shared_ptr<Matrix<double>>(dL),
+                         [](void* ptr) {
+            delete reinterpret_cast<std::shared_ptr<Matrix<double>>*>(ptr);
+        });
+        ssize_t NT = dL->rows() / nwav;
+        ssize_t sz = sizeof(double);
+        double* data = dL->data();
+
+        // Loop over the parameters, grouping the map coefficients
+        size_t i = 0, n;
+        bool is_map;
+        while (i < dL_names.size()) {
+            const std::string& name = dL_names[i];
+            is_map = (name.substr(1, 2) == ".y") || (name.substr(1, 2) == ".u");
+            n = 1;
+            if (is_map) {
+                while ((i + n < dL_names.size()) && (dL_names[i + n] == name))
+                    ++n;
+            }
+            double* ptr = data + i * NT * nwav;
+            ssize_t nn = static_cast<ssize_t>(n);
+            if (!is_map && (nwav == 1))
+                pygrad[name.c_str()] = py::array_t<double>(
+                    {NT}, {sz}, ptr, base);
+            else if (!is_map)
+                pygrad[name.c_str()] = py::array_t<double>(
+                    {NT, ssize_t(nwav)}, {nwav * sz, sz}, ptr, base);
+            else if (nwav == 1)
+                pygrad[name.c_str()] = py::array_t<double>(
+                    {nn, NT}, {NT * sz, sz}, ptr, base);
+            else
+                pygrad[name.c_str()] = py::array_t<double>(
+                    {nn, NT, ssize_t(nwav)}, {NT * nwav * sz, nwav * sz, sz},
+                    ptr, base);
+            i += n;
+        }
+        return pygrad;
+    }
+
+    /**
+    Spherical harmonic transform of a set of lat-lon images, releasing
+    the GIL.
+
+    */
+    inline Matrix<double> latlon2ylm(const std::vector<Matrix<double>>& images,
+                                     int lmax) {
+        Matrix<double> y;
+        py::gil_scoped_release release;
+        sht::latlon2ylm(images, lmax, y);
+        return y;
+    }
+
+    /**
+    Spherical harmonic transform of a set of HEALPix maps (one per
+    column), releasing the GIL.
+
+    */
+    inline Matrix<double> healpix2ylm(const Matrix<double>& images, int lmax) {
+        Matrix<double> y;
+        py::gil_scoped_release release;
+        sht::healpix2ylm(images, lmax, y);
+        return y;
+    }
+
+    /**
+    Return the instrumentation counters (see `profile.h`) as a
+    dictionary, optionally resetting them afterwards.
+
+    */
+    inline py::dict profileDict(bool reset) {
+        using profile::counters;
+        profile::Counters& c = counters();
+        py::dict stages, caches;
+        for (int i = 0; i < profile::NSTAGES; ++i)
+            stages[profile::stage_names[i]] = py::dict(
+                "calls"_a=c.calls[i].load(std::memory_order_relaxed),
+                "ticks"_a=c.ticks[i].load(std::memory_order_relaxed));
+        for (int i = 0; i < profile::NCACHES; ++i)
+            caches[profile::cache_names[i]] = py::dict(
+                "hits"_a=c.hits[i].load(std::memory_order_relaxed),
+                "misses"_a=c.misses[i].load(std::memory_order_relaxed));
+        std::vector<uint64_t> depth(profile::NDEPTH);
+        for (int i = 0; i < profile::NDEPTH; ++i)
+            depth[i] = c.depth[i].load(std::memory_order_relaxed);
+        py::dict branches, series;
+        for (int i = 0; i < profile::NBRANCHES; ++i)
+            branches[profile::branch_names[i]] =
+                c.branches[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < profile::NSERIES; ++i) {
+            std::vector<uint64_t> hist(profile::NTERMS);
+            uint64_t calls = 0, terms = 0;
+            for (int n = 0; n < profile::NTERMS; ++n) {
+                hist[n] = c.terms[i][n].load(std::memory_order_relaxed);
+                calls += hist[n];
+                terms += n * hist[n];
+            }
+            series[profile::series_names[i]] = py::dict(
+                "calls"_a=calls, "terms"_a=terms, "histogram"_a=hist);
+        }
+        if (reset)
+            c.reset();
+        return py::dict("enabled"_a=bool(STARRY_PROFILE),
+                        "clock"_a=profile::clock_name,
+                        "stages"_a=stages,
+                        "caches"_a=caches,
+                        "depth"_a=depth,
+                        "branches"_a=branches,
+                        "series"_a=series);
+    }
+
+    /**
+    Set the map coefficients up to degree `lmax` to the (normalized)
+    transform `y` of an image and rotate the map so that the center of
+    the image is projected onto the sub-observer point: single-wavelength
+    starry.
+
+    */
+    template <typename T>
+    inline void setMapFromImage(maps::Map<T>& map, const Matrix<double>& y_,
+                                int lmax) {
+        if (lmax == -1)
+            lmax = map.lmax;
+        if ((lmax < 0) || (lmax > map.lmax))
+            throw errors::IndexError("Invalid value for `lmax`.");
+        Vector<Scalar<T>> y = y_.col(0).template cast<Scalar<T>>();
+        y /= y(0);
+        int n = 0;
+        {
+            maps::ScopedBatch<T> batch(map);
+            for (int l = 0; l < lmax + 1; ++l) {
+                for (int m = -l; m < l + 1; ++m) {
+                    map.setY(l, m, y(n));
+                    ++n;
+                }
+            }
+        }
+        // We need to apply some rotations to get to the
+        // desired orientation, where the center of the image
+        // is projected onto the sub-observer point
+        auto map_axis = map.getAxis();
+        map.setAxis(xhat<Scalar<T>>());
+        map.rotate(90.0);
+        map.setAxis(zhat<Scalar<T>>());
+        map.rotate(180.0);
+        map.setAxis(yhat<Scalar<T>>());
+        map.rotate(90.0);
+        map.setAxis(map_axis);
+    }
+
+    /**
+    Set the map coefficients up to degree `lmax` in wavelength bins
+    `nwav, nwav + 1, ...` to the (normalized) transforms in the columns
+    of `y`: spectral starry.
+
+    */
+    template <typename T>
+    inline void setMapFromImage(maps::Map<T>& map, const Matrix<double>& y_,
+                                int lmax, int nwav) {
+        if (lmax == -1)
+            lmax = map.lmax;
+        if ((nwav < 0) || (nwav + y_.cols() > map.nwav))
+            throw errors::IndexError("Invalid value for `nwav`.");
+        if ((lmax < 0) || (lmax > map.lmax))
+            throw errors::IndexError("Invalid value for `lmax`.");
+        // Below, we rotate the entire map to get it to the
+        // right orientation after loading the image. In order
+        // to not screw up the map at other wavelengths, we can
+        // pre-apply the opposite transformation.
+        // TODO: This is unnecessarily slow b/c of all the rotations.
+        // I can think of far better ways of doing this.
+        auto map_axis = map.getAxis();
+        map.setAxis(yhat<Scalar<T>>());
+        map.rotate(-90.0);
+        map.setAxis(zhat<Scalar<T>>());
+        map.rotate(-180.0);
+        map.setAxis(xhat<Scalar<T>>());
+        map.rotate(-90.0);
+        map.setAxis(map_axis);
+        Matrix<Scalar<T>> y = y_.template cast<Scalar<T>>();
+        Row<T> row;
+        int n = 0;
+        {
+            maps::ScopedBatch<T> batch(map);
+            for (int l = 0; l < lmax + 1; ++l) {
+                for (int m = -l; m < l + 1; ++m) {
+                    row = map.getY(l, m);
+                    for (int k = 0; k < y.cols(); ++k)
+                        row(nwav + k) = y(n, k) / y(0, k);
+                    map.setY(l, m, row);
+                    ++n;
+                }
+            }
+        }
+        // We need to apply some rotations to get to the
+        // desired orientation, where the center of the image
+        // is projected onto the sub-observer point
+        map.setAxis(xhat<Scalar<T>>());
+        map.rotate(90.0);
+        map.setAxis(zhat<Scalar<T>>());
+        map.rotate(180.0);
+        map.setAxis(yhat<Scalar<T>>());
+        map.rotate(90.0);
+        map.setAxis(map_axis);
+    }
+
     /**
     Add type-specific features to the Map class: single-wavelength starry.
 
@@ -63,17 +351,8 @@ namespace pybind_interface {
             .def("show", [](maps::Map<T> &map, std::string cmap, int res) {
                 py::object show =
                     py::module::import("starry.maps").attr("show");
-                Matrix<double> I;
-                I.resize(res, res);
-                Vector<Scalar<T>> x;
-                x = Vector<Scalar<T>>::LinSpaced(res, -1, 1);
-                for (int i = 0; i < res; i++){
-                    for (int j = 0; j < res; j++){
-                        I(j, i) = static_cast<double>(
-                                  map(0.0, x(i), x(j)));
-                    }
-                }
-                show(I, "cmap"_a=cmap, "res"_a=res);
+                py::object I = renderMap(map, Vector<Scalar<T>>::Zero(1), res);
+                show(I[py::int_(0)], "cmap"_a=cmap, "res"_a=res);
             }, docstrings::Map::show, "cmap"_a="plasma", "res"_a=300)
 
             .def("animate", [](maps::Map<T> &map, std::string cmap, int res,
@@ -82,19 +361,8 @@ namespace pybind_interface {
                 std::cout << "Rendering..." << std::endl;
                 py::object animate =
                     py::module::import("starry.maps").attr("animate");
-                std::vector<Matrix<double>> I;
-                Vector<Scalar<T>> x, theta;
-                x = Vector<Scalar<T>>::LinSpaced(res, -1, 1);
-                theta = Vector<Scalar<T>>::LinSpaced(frames, 0, 360);
-                for (int t = 0; t < frames; t++){
-                    I.push_back(Matrix<double>::Zero(res, res));
-                    for (int i = 0; i < res; i++){
-                        for (int j = 0; j < res; j++){
-                            I[t](j, i) = static_cast<double>(
-                                         map(theta(t), x(i), x(j)));
-                        }
-                    }
-                }
+                py::object I = renderMap(map,
+                    Vector<Scalar<T>>::LinSpaced(frames, 0, 360), res);
                 return animate(I, "cmap"_a=cmap, "res"_a=res, "gif"_a=gif,
                                "interval"_a=interval);
              }, docstrings::Map::animate, "cmap"_a="plasma", "res"_a=150,
@@ -102,105 +370,39 @@ namespace pybind_interface {
 
              .def("load_image", [](maps::Map<T> &map, std::string& image,
                                    int lmax) {
-                 py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                 if (lmax == -1)
-                    lmax = map.lmax;
-                 Vector<double> y_double =
-                    load_map(image, map.lmax).template cast<Vector<double>>();
-                 T y = y_double.template cast<Scalar<T>>();
-                 y /= y(0);
-                 int n = 0;
-                 for (int l = 0; l < lmax + 1; ++l) {
-                     for (int m = -l; m < l + 1; ++m) {
-                         map.setY(l, m, y(n));
-                         ++n;
-                     }
-                 }
-                 // We need to apply some rotations to get to the
-                 // desired orientation, where the center of the image
-                 // is projected onto the sub-observer point
-                 auto map_axis = map.getAxis();
-                 map.setAxis(xhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(zhat<Scalar<T>>());
-                 map.rotate(180.0);
-                 map.setAxis(yhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(map_axis);
+                 py::object image2array =
+                    py::module::import("starry.maps").attr("image2array");
+                 std::vector<Matrix<double>> images{
+                    image2array(image).template cast<Matrix<double>>()};
+                 setMapFromImage(map, latlon2ylm(images, map.lmax), lmax);
              }, docstrings::Map::load_image, "image"_a, "lmax"_a=-1)
 
              .def("load_image", [](maps::Map<T> &map,
                                    const Matrix<double>& image,
                                    int lmax) {
-                 py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                 if (lmax == -1)
-                    lmax = map.lmax;
-                 Vector<double> y_double =
-                    load_map(image, map.lmax).template cast<Vector<double>>();
-                 T y = y_double.template cast<Scalar<T>>();
-                 y /= y(0);
-                 int n = 0;
-                 for (int l = 0; l < lmax + 1; ++l) {
-                     for (int m = -l; m < l + 1; ++m) {
-                         map.setY(l, m, y(n));
-                         ++n;
-                     }
-                 }
-                 // We need to apply some rotations to get to the
-                 // desired orientation, where the center of the image
-                 // is projected onto the sub-observer point
-                 auto map_axis = map.getAxis();
-                 map.setAxis(xhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(zhat<Scalar<T>>());
-                 map.rotate(180.0);
-                 map.setAxis(yhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(map_axis);
+                 std::vector<Matrix<double>> images{image};
+                 setMapFromImage(map, latlon2ylm(images, map.lmax), lmax);
              }, docstrings::Map::load_image, "image"_a, "lmax"_a=-1)
 
              .def("load_healpix", [](maps::Map<T> &map,
                                      const Vector<double>& image,
                                      int lmax) {
-                 py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                 if (lmax == -1)
-                    lmax = map.lmax;
-                 Vector<double> y_double =
-                    load_map(image, map.lmax, true).template cast<Vector<double>>();
-                 T y = y_double.template cast<Scalar<T>>();
-                 y /= y(0);
-                 int n = 0;
-                 for (int l = 0; l < lmax + 1; ++l) {
-                     for (int m = -l; m < l + 1; ++m) {
-                         map.setY(l, m, y(n));
-                         ++n;
-                     }
-                 }
-                 // We need to apply some rotations to get to the
-                 // desired orientation, where the center of the image
-                 // is projected onto the sub-observer point
-                 auto map_axis = map.getAxis();
-                 map.setAxis(xhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(zhat<Scalar<T>>());
-                 map.rotate(180.0);
-                 map.setAxis(yhat<Scalar<T>>());
-                 map.rotate(90.0);
-                 map.setAxis(map_axis);
+                 setMapFromImage(map, healpix2ylm(image, map.lmax), lmax);
              }, docstrings::Map::load_healpix, "image"_a, "lmax"_a=-1)
 
              .def("add_gaussian", [](maps::Map<T> &map, const double& sigma,
                                      const double& amp, const double& lat,
                                      const double& lon, int lmax) {
-                py::object gaussian =
-                    py::module::import("starry.maps").attr("gaussian");
+                py::object gaussian_array =
+                    py::module::import("starry.maps").attr("gaussian_array");
                 if (lmax == -1)
                    lmax = map.lmax;
-                Vector<double> y = amp *
-                    gaussian(sigma, map.lmax).template cast<Vector<double>>();
+                std::vector<Matrix<double>> images{
+                    gaussian_array(sigma).template cast<Matrix<double>>()};
+                // NOTE: Force the constant term to zero so we
+                // add no net flux.
+                Vector<double> y = amp * latlon2ylm(images, map.lmax).col(0);
+                y(0) = 0;
 
                 // Create a temporary map and add the gaussian
                 maps::Map<Vector<double>> tmpmap(map.lmax);
@@ -221,6 +423,7 @@ namespace pybind_interface {
                 tmpmap.rotate(lon);
 
                 // Add it to the current map
+                maps::ScopedBatch<T> batch(map);
                 for (int l = 0; l < lmax + 1; ++l) {
                     for (int m = -l; m < l + 1; ++m) {
                         map.setY(l, m, map.getY(l, m) + tmpmap.getY(l, m));
@@ -247,11 +450,7 @@ namespace pybind_interface {
                 std::cout << "Rendering..." << std::endl;
                 py::object animate =
                     py::module::import("starry.maps").attr("animate");
-                std::vector<Matrix<double>> I;
-                Vector<Scalar<T>> x;
-                VectorT<Scalar<T>> row;
                 std::vector<std::string> labels;
-                x = Vector<Scalar<T>>::LinSpaced(res, -1, 1);
                 int interval = static_cast<int>(75 * (50.0 / map.nwav));
                 if (interval < 50)
                     interval = 50;
@@ -260,16 +459,9 @@ namespace pybind_interface {
                 for (int t = 0; t < map.nwav; t++) {
                     labels.push_back(std::string("Wavelength Bin #") +
                                      std::to_string(t + 1));
-                    I.push_back(Matrix<double>::Zero(res, res));
-                }
-                for (int i = 0; i < res; i++){
-                    for (int j = 0; j < res; j++){
-                        row = map(0, x(i), x(j));
-                        for (int t = 0; t < map.nwav; t++) {
-                            I[t](j, i) = static_cast<double>(row(t));
-                        }
-                    }
                 }
+                py::object I = renderMap(map, Vector<Scalar<T>>::Zero(1), res);
+                I = I[py::int_(0)];
                 if (show_labels)
                     return animate(I, "cmap"_a=cmap, "res"_a=res, "gif"_a=gif,
                                       "labels"_a=labels, "interval"_a=interval);
@@ -282,138 +474,34 @@ namespace pybind_interface {
             .def("load_image", [](maps::Map<T> &map,
                                   const Matrix<double>& image,
                                   int nwav, int lmax) {
-                py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                if (lmax == -1)
-                    lmax = map.lmax;
-                // Below, we rotate the entire map to get it to the
-                // right orientation after loading the image. In order
-                // to not screw up the map at other wavelengths, we can
-                // pre-apply the opposite transformation.
-                // NOTE: I can think of far better ways of doing this, but
-                // I don't think there's a pressing need to optimize this
-                // function.
-                auto map_axis = map.getAxis();
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(-180.0);
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(map_axis);
-                Vector<double> y_double =
-                    load_map(image, map.lmax).template cast<Vector<double>>();
-                T y = y_double.template cast<Scalar<T>>();
-                Row<T> row;
-                int n = 0;
-                for (int l = 0; l < lmax + 1; ++l) {
-                    for (int m = -l; m < l + 1; ++m) {
-                        row = map.getY(l, m);
-                        row(nwav) = y(n) / y(0);
-                        map.setY(l, m, row);
-                        ++n;
-                    }
-                }
-                // We need to apply some rotations to get to the
-                // desired orientation, where the center of the image
-                // is projected onto the sub-observer point
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(180.0);
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(map_axis);
+                std::vector<Matrix<double>> images{image};
+                setMapFromImage(map, latlon2ylm(images, map.lmax), lmax, nwav);
             }, docstrings::Map::load_image, "image"_a, "nwav"_a=0, "lmax"_a=-1)
 
             .def("load_image", [](maps::Map<T> &map, std::string& image,
                                   int nwav, int lmax) {
-                py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                if (lmax == -1)
-                    lmax = map.lmax;
-                // Below, we rotate the entire map to get it to the
-                // right orientation after loading the image. In order
-                // to not screw up the map at other wavelengths, we can
-                // pre-apply the opposite transformation.
-                // TODO: This is unnecessarily slow b/c of all the rotations.
-                // I can think of far better ways of doing this.
-                auto map_axis = map.getAxis();
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(-180.0);
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(map_axis);
-                Vector<double> y_double =
-                    load_map(image, map.lmax).template cast<Vector<double>>();
-                T y = y_double.template cast<Scalar<T>>();
-                Row<T> row;
-                int n = 0;
-                for (int l = 0; l < lmax + 1; ++l) {
-                    for (int m = -l; m < l + 1; ++m) {
-                        row = map.getY(l, m);
-                        row(nwav) = y(n) / y(0);
-                        map.setY(l, m, row);
-                        ++n;
-                    }
-                }
-                // We need to apply some rotations to get to the
-                // desired orientation, where the center of the image
-                // is projected onto the sub-observer point
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(180.0);
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(map_axis);
+                py::object image2array =
+                    py::module::import("starry.maps").attr("image2array");
+                std::vector<Matrix<double>> images{
+                    image2array(image).template cast<Matrix<double>>()};
+                setMapFromImage(map, latlon2ylm(images, map.lmax), lmax, nwav);
+            }, docstrings::Map::load_image, "image"_a, "nwav"_a=0, "lmax"_a=-1)
+
+            .def("load_image", [](maps::Map<T> &map,
+                                  const std::vector<Matrix<double>>& images,
+                                  int nwav, int lmax) {
+                setMapFromImage(map, latlon2ylm(images, map.lmax), lmax, nwav);
             }, docstrings::Map::load_image, "image"_a, "nwav"_a=0, "lmax"_a=-1)
 
             .def("load_healpix", [](maps::Map<T> &map, const Vector<double>& image,
                                   int nwav, int lmax) {
-                py::object load_map =
-                    py::module::import("starry.maps").attr("load_map");
-                if (lmax == -1)
-                    lmax = map.lmax;
-                // Below, we rotate the entire map to get it to the
-                // right orientation after loading the image. In order
-                // to not screw up the map at other wavelengths, we can
-                // pre-apply the opposite transformation.
-                // TODO: This is unnecessarily slow b/c of all the rotations.
-                // I can think of far better ways of doing this.
-                auto map_axis = map.getAxis();
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(-180.0);
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(-90.0);
-                map.setAxis(map_axis);
-                Vector<double> y_double =
-                    load_map(image, map.lmax, true).template cast<Vector<double>>();
-                T y = y_double.template cast<Scalar<T>>();
-                Row<T> row;
-                int n = 0;
-                for (int l = 0; l < lmax + 1; ++l) {
-                    for (int m = -l; m < l + 1; ++m) {
-                        row = map.getY(l, m);
-                        row(nwav) = y(n) / y(0);
-                        map.setY(l, m, row);
-                        ++n;
-                    }
-                }
-                // We need to apply some rotations to get to the
-                // desired orientation, where the center of the image
-                // is projected onto the sub-observer point
-                map.setAxis(xhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(zhat<Scalar<T>>());
-                map.rotate(180.0);
-                map.setAxis(yhat<Scalar<T>>());
-                map.rotate(90.0);
-                map.setAxis(map_axis);
+                setMapFromImage(map, healpix2ylm(image, map.lmax), lmax, nwav);
+            }, docstrings::Map::load_healpix, "image"_a, "nwav"_a=0, "lmax"_a=-1)
+
+            .def("load_healpix", [](maps::Map<T> &map, const Matrix<double>& image,
+                                  int nwav, int lmax) {
+                setMapFromImage(map, healpix2ylm(image.transpose(), map.lmax),
+                                lmax, nwav);
             }, docstrings::Map::load_healpix, "image"_a, "nwav"_a=0, "lmax"_a=-1)
 
             .def("add_gaussian", [](maps::Map<T> &map, py::args args,
@@ -423,6 +511,16 @@ namespace pybind_interface {
 
     }
 
+    /**
+    Context manager returned by `Map.batch()`.
+
+    */
+    template <typename T>
+    struct MapBatch {
+        maps::Map<T>& map;
+        explicit MapBatch(maps::Map<T>& map) : map(map) {}
+    };
+
     /**
     The pybind wrapper for the Map class.
 
@@ -433,6 +531,15 @@ namespace pybind_interface {
         // Declare the class
         py::class_<maps::Map<T>> Map(m, name, docstrings::Map::doc);
 
+        // The batch update context manager
+        py::class_<MapBatch<T>>(Map, "Batch")
+            .def("__enter__", [](MapBatch<T> &batch) {
+                    batch.map.beginBatch();
+                })
+            .def("__exit__", [](MapBatch<T> &batch, py::args) {
+                    batch.map.endBatch();
+                });
+
         // Add generic attributes & methods
         Map
 
@@ -465,7 +572,14 @@ namespace pybind_interface {
                 auto y = map.getY();
                 for (auto n : inds)
                     setRow(y, n, coeff);
-                map.setY(y);
+                if (inds.size() == 1) {
+                    // Incremental update of a single coefficient
+                    int n = inds[0];
+                    int l = static_cast<int>(std::sqrt(n));
+                    map.setY(l, n - l * l - l, getRow(y, n));
+                } else {
+                    map.setY(y);
+                }
             })
 
             // Set one or more spherical harmonic coeffs to an array of values
@@ -556,11 +670,28 @@ namespace pybind_interface {
             .def("__call__", [](maps::Map<T> &map,
                                 py::array_t<double>& theta,
                                 py::array_t<double>& x,
-                                py::array_t<double>& y)
+                                py::array_t<double>& y,
+                                py::object& out,
+                                int nthreads)
                                 -> py::object {
-                    return vectorize::evaluate(map, theta, x, y);
+                    return vectorize::evaluate(map, theta, x, y, out,
+                                               nthreads);
                 }, docstrings::Map::evaluate, "theta"_a=0.0,
-                   "x"_a=0.0, "y"_a=0.0)
+                   "x"_a=0.0, "y"_a=0.0, "out"_a=py::none(),
+                   "nthreads"_a=0)
+
+            .def("render", [](maps::Map<T> &map, py::array_t<double,
+                              py::array::c_style | py::array::forcecast> theta,
+                              int res, int nthreads) -> py::object {
+                Vector<Scalar<T>> theta_(theta.size());
+                for (ssize_t t = 0; t < theta.size(); ++t)
+                    theta_(t) = theta.data()[t];
+                py::object I = renderMap(map, theta_, res, nthreads);
+                if (theta.ndim() == 0)
+                    return I[py::int_(0)];
+                return I;
+            }, docstrings::Map::render, "theta"_a=0.0, "res"_a=300,
+               "nthreads"_a=0)
 
             .def_property("axis",
                 [](maps::Map<T> &map) -> UnitVector<double> {
@@ -571,8 +702,39 @@ namespace pybind_interface {
                     },
                 docstrings::Map::axis)
 
+            .def_property("approx_tol",
+                [](maps::Map<T> &map) {
+                        return static_cast<double>(map.getApproxTol());
+                    },
+                [](maps::Map<T> &map, const double& tol){
+                        map.setApproxTol(tol);
+                    },
+                docstrings::Map::approx_tol)
+
+            .def_property("table_tol",
+                [](maps::Map<T> &map) {
+                        return static_cast<double>(map.getTableTol());
+                    },
+                [](maps::Map<T> &map, const double& tol){
+                        map.setTableTol(tol);
+                    },
+                docstrings::Map::table_tol)
+
+            .def_property("table_dr",
+                [](maps::Map<T> &map) {
+                        return static_cast<double>(map.getTableDr());
+                    },
+                [](maps::Map<T> &map, const double& dr){
+                        map.setTableDr(dr);
+                    },
+                docstrings::Map::table_dr)
+
             .def("reset", &maps::Map<T>::reset, docstrings::Map::reset)
 
+            .def("batch", [](maps::Map<T> &map) {
+                    return MapBatch<T>(map);
+                }, py::keep_alive<0, 1>(), docstrings::Map::batch)
+
             .def_property_readonly("lmax", [](maps::Map<T> &map){
                     return map.lmax;
                 }, docstrings::Map::lmax)
@@ -613,23 +775,29 @@ namespace pybind_interface {
                             py::array_t<double>& yo,
                             py::array_t<double>& ro,
                             bool gradient,
-                            bool numerical) -> py::object {
+                            bool numerical,
+                            py::object& out) -> py::object {
                     return vectorize::flux(map, theta, xo, yo, ro,
-                                           gradient, numerical);
+                                           gradient, numerical, out);
                 }, docstrings::Map::flux, "theta"_a=0.0, "xo"_a=0.0, "yo"_a=0.0,
                                    "ro"_a=0.0, "gradient"_a=false,
-                                   "numerical"_a=false)
+                                   "numerical"_a=false, "out"_a=py::none())
                        
             .def("rotate", [](maps::Map<T> &map, double theta) {
                     map.rotate(static_cast<Scalar<T>>(theta));
             }, docstrings::Map::rotate, "theta"_a=0)
 
             .def("is_physical", [](maps::Map<T> &map, double epsilon,
-                                   int max_iterations) {
+                                   int max_iterations, int restarts,
+                                   int nthreads) {
+                    if (restarts < 1)
+                        throw errors::ValueError("The number of restarts "
+                                                 "must be positive.");
                     return map.isPhysical(static_cast<Scalar<T>>(epsilon),
-                                   max_iterations);
+                                   max_iterations, restarts, nthreads);
             }, docstrings::Map::is_physical, "epsilon"_a=1.e-6,
-               "max_iterations"_a=100)
+               "max_iterations"_a=100, "restarts"_a=STARRY_MIN_RESTARTS,
+               "nthreads"_a=1)
 
             .def("__repr__", &maps::Map<T>::info);
 
@@ -658,77 +826,7 @@ namespace pybind_interface {
                 },
                 [](kepler::Body<T> &body, const double& L){
                     body.setLuminosity(Scalar<T>(L));
-                }, docstrings::Body::L)
-
-            // The gradient of the light curve: a dictionary of matrices/vectors
-            // NOTE: This may be slow because we need to swap some axes here:
-            //      dL(NT)(ngrad, nwav) --> gradient(ngrad)(NT, nwav)
-            // I haven't figured out a way of avoiding this yet...
-            .def_property_readonly("gradient", [](kepler::Body<T> &body) -> py::object {
-                const Vector<T>& dL = body.getLightcurveGradient();
-                const std::vector<std::string> dL_names = body.getLightcurveGradientNames();
-                size_t sz = dL.size();
-                std::map<std::string, Matrix<double>> gradient;
-                std::string param;
-                int n;
-
-                // Allocate memory for non-map coeffs
-                for (auto name : dL_names) {
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        gradient[name].resize(sz, 1);
-                }
-
-                // Allocate memory for the Ylms and Uls
-                for (auto var : {".y", ".u"}) {
-                    n = 0;
-                    for (auto name : dL_names) {
-                        if (name.substr(1, 2) == var) {
-                            param = name;
-                            ++n;
-                        } else if (n > 0) {
-                            gradient[param].resize(sz, n);
-                            n = 0;
-                        }
-                    }
-                    if (n > 0)
-                        gradient[param].resize(sz, n);
-                }
-
-                // Populate the dictionary
-                // Loop over all times
-                for (size_t t = 0; t < sz; ++t) {
-                    // Loop over all params
-                    n = 0;
-                    for (size_t i = 0; i < dL_names.size(); ++i) {
-                        if (dL_names[i].substr(1, 2) == ".y") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".y"))
-                                n = 0;
-                            gradient[dL_names[i]](t, n++) = static_cast<double>(dL(t)(i));
-                        } else if (dL_names[i].substr(1, 2) == ".u") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".u"))
-                                n = 0;
-                            gradient[dL_names[i]](t, n++) = static_cast<double>(dL(t)(i));
-                        } else {
-                            gradient[dL_names[i]](t, 0) = static_cast<double>(dL(t)(i));
-                        }
-                    }
-                }
-
-                // Convert to an actual python dictionary
-                // Necessary because we're mixing vectors and matrices
-                // among the dictionary items.
-                // NOTE: All this copying could be slow: not ideal.
-                auto pygrad = py::dict();
-                for (auto& entry : gradient) {
-                    std::string const& name = entry.first;
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        pygrad[name.c_str()] = gradient[name].col(0);
-                    else
-                        pygrad[name.c_str()] = gradient[name].transpose();
-                }
-                return pygrad;
-
-            }, docstrings::Body::gradient);
+                }, docstrings::Body::L);
 
     }
 
@@ -750,59 +848,7 @@ namespace pybind_interface {
                 },
                 [](kepler::Body<T> &body, const Vector<double>& L){
                     body.setLuminosity(L.template cast<Scalar<T>>());
-                }, docstrings::Body::L)
-
-            // The gradient of the light curve: a dictionary of matrices/vectors
-            // NOTE: This may be slow because we need to swap some axes here:
-            //      dL(NT)(ngrad, nwav) --> gradient(ngrad)(NT, nwav)
-            // I haven't figured out a way of avoiding this yet...
-            .def_property_readonly("gradient", [](kepler::Body<T> &body) -> py::object {
-                const Vector<T>& dL = body.getLightcurveGradient();
-                const std::vector<std::string> dL_names = body.getLightcurveGradientNames();
-                size_t sz = dL.size();
-                std::map<std::string, std::vector<Matrix<double>>> gradient;
-                int n;
-
-                // Allocate memory
-                for (auto name : dL_names) {
-                    gradient[name].push_back(Matrix<double>(sz, body.nwav));
-                }
-
-                // Populate the dictionary
-                // Loop over all times
-                for (size_t t = 0; t < sz; ++t) {
-                    // Loop over all params
-                    n = 0;
-                    for (size_t i = 0; i < dL_names.size(); ++i) {
-                        if (dL_names[i].substr(1, 2) == ".y") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".y"))
-                                n = 0;
-                            gradient[dL_names[i]][n++].row(t) = dL(t).row(i).template cast<double>();
-                        } else if (dL_names[i].substr(1, 2) == ".u") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".u"))
-                                n = 0;
-                            gradient[dL_names[i]][n++].row(t) = dL(t).row(i).template cast<double>();
-                        } else {
-                            gradient[dL_names[i]][0].row(t) = dL(t).row(i).template cast<double>();
-                        }
-                    }
-                }
-
-                // Convert to an actual python dictionary. Necessary so
-                // we can transform 1-element lists of matrices to
-                // straight up matrices
-                // NOTE: All this copying could be slow: not ideal.
-                auto pygrad = py::dict();
-                for (auto& entry : gradient) {
-                    std::string const& name = entry.first;
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        pygrad[name.c_str()] = gradient[name][0];
-                    else
-                        pygrad[name.c_str()] = gradient[name];
-                }
-                return pygrad;
-
-            }, docstrings::Body::gradient);
+                }, docstrings::Body::L);
 
     }
 
@@ -858,7 +904,16 @@ namespace pybind_interface {
                     return py::cast(
                             body.getLightcurve().template cast<double>());
                 }
-            }, docstrings::Body::lightcurve);
+            }, docstrings::Body::lightcurve)
+
+            // The gradient of the light curve: a dictionary of views
+            // into the gradient buffer
+            .def_property_readonly("gradient", [](kepler::Body<T> &body)
+                    -> py::object {
+                return gradientDict(
+                    gradientAsDouble(body.getLightcurveGradient()),
+                    body.getLightcurveGradientNames(), body.nwav);
+            }, docstrings::Body::gradient);
 
         // Add type-specific attributes & methods
         addBodyExtras(Body);
@@ -1058,155 +1113,6 @@ namespace pybind_interface {
 
     }
 
-    /**
-    Add type-specific features to the System class: single-wavelength starry.
-
-    */
-    template <typename T>
-    typename std::enable_if<!std::is_base_of<Eigen::EigenBase<Row<T>>,
-                                             Row<T>>::value, void>::type
-    addSystemExtras(py::class_<kepler::System<T>>& System) {
-
-        System
-
-            // The gradient of the light curve: a dictionary of matrices/vectors
-            // NOTE: This may be slow because we need to swap some axes here:
-            //      dL(NT)(ngrad, nwav) --> gradient(ngrad)(NT, nwav)
-            // I haven't figured out a way of avoiding this yet...
-            .def_property_readonly("gradient", [](kepler::System<T> &sys) -> py::object {
-                const Vector<T>& dL = sys.getLightcurveGradient();
-                const std::vector<std::string> dL_names = sys.getLightcurveGradientNames();
-                size_t sz = dL.size();
-                std::map<std::string, Matrix<double>> gradient;
-                std::string param;
-                int n;
-
-                // Allocate memory for non-map coeffs
-                for (auto name : dL_names) {
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        gradient[name].resize(sz, 1);
-                }
-
-                // Allocate memory for the Ylms and Uls
-                for (auto var : {".y", ".u"}) {
-                    n = 0;
-                    for (auto name : dL_names) {
-                        if (name.substr(1, 2) == var) {
-                            param = name;
-                            ++n;
-                        } else if (n > 0) {
-                            gradient[param].resize(sz, n);
-                            n = 0;
-                        }
-                    }
-                    if (n > 0)
-                        gradient[param].resize(sz, n);
-                }
-
-                // Populate the dictionary
-                // Loop over all times
-                for (size_t t = 0; t < sz; ++t) {
-                    // Loop over all params
-                    n = 0;
-                    for (size_t i = 0; i < dL_names.size(); ++i) {
-                        if (dL_names[i].substr(1, 2) == ".y") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".y"))
-                                n = 0;
-                            gradient[dL_names[i]](t, n++) = static_cast<double>(dL(t)(i));
-                        } else if (dL_names[i].substr(1, 2) == ".u") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".u"))
-                                n = 0;
-                            gradient[dL_names[i]](t, n++) = static_cast<double>(dL(t)(i));
-                        } else {
-                            gradient[dL_names[i]](t, 0) = static_cast<double>(dL(t)(i));
-                        }
-                    }
-                }
-
-                // Convert to an actual python dictionary
-                // Necessary because we're mixing vectors and matrices
-                // among the dictionary items.
-                // NOTE: All this copying could be slow: not ideal.
-                auto pygrad = py::dict();
-                for (auto& entry : gradient) {
-                    std::string const& name = entry.first;
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        pygrad[name.c_str()] = gradient[name].col(0);
-                    else
-                        pygrad[name.c_str()] = gradient[name].transpose();
-                }
-                return pygrad;
-
-            }, docstrings::System::gradient);
-
-    }
-
-    /**
-    Add type-specific features to the System class: spectral starry.
-
-    */
-    template <typename T>
-    typename std::enable_if<std::is_base_of<Eigen::EigenBase<Row<T>>,
-                                            Row<T>>::value, void>::type
-    addSystemExtras(py::class_<kepler::System<T>>& System) {
-
-        System
-
-            // The gradient of the light curve: a dictionary of matrices/vectors
-            // NOTE: This may be slow because we need to swap some axes here:
-            //      dL(NT)(ngrad, nwav) --> gradient(ngrad)(NT, nwav)
-            // I haven't figured out a way of avoiding this yet...
-            .def_property_readonly("gradient", [](kepler::System<T> &sys) -> py::object {
-                const Vector<T>& dL = sys.getLightcurveGradient();
-                const std::vector<std::string> dL_names = sys.getLightcurveGradientNames();
-                size_t sz = dL.size();
-                std::map<std::string, std::vector<Matrix<double>>> gradient;
-                std::string param;
-                int n;
-
-                // Allocate memory
-                for (auto name : dL_names) {
-                    gradient[name].push_back(Matrix<double>(sz, sys.primary->nwav));
-                }
-
-                // Populate the dictionary
-                // Loop over all times
-                for (size_t t = 0; t < sz; ++t) {
-                    // Loop over all params
-                    n = 0;
-                    for (size_t i = 0; i < dL_names.size(); ++i) {
-                        if (dL_names[i].substr(1, 2) == ".y") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".y"))
-                                n = 0;
-                            gradient[dL_names[i]][n++].row(t) = dL(t).row(i).template cast<double>();
-                        } else if (dL_names[i].substr(1, 2) == ".u") {
-                            if ((i > 0) && (dL_names[i - 1].substr(1, 2) != ".u"))
-                                n = 0;
-                            gradient[dL_names[i]][n++].row(t) = dL(t).row(i).template cast<double>();
-                        } else {
-                            gradient[dL_names[i]][0].row(t) = dL(t).row(i).template cast<double>();
-                        }
-                    }
-                }
-
-                // Convert to an actual python dictionary. Necessary so
-                // we can transform 1-element lists of matrices to
-                // straight up matrices
-                // NOTE: All this copying could be slow: not ideal.
-                auto pygrad = py::dict();
-                for (auto& entry : gradient) {
-                    std::string const& name = entry.first;
-                    if ((name.substr(1, 2) != ".y") && (name.substr(1, 2) != ".u"))
-                        pygrad[name.c_str()] = gradient[name][0];
-                    else
-                        pygrad[name.c_str()] = gradient[name];
-                }
-                return pygrad;
-
-            }, docstrings::System::gradient);
-
-    }
-
     /**
     The pybind wrapper for the System class.
 
@@ -1238,13 +1144,122 @@ namespace pybind_interface {
                 return system.secondaries;
             }, docstrings::System::secondaries)
 
-            // Compute the light curve
+            // Compute the light curve. Note that `cast` is a no-op
+            // for double precision, so `time` is not copied.
             .def("compute", [](kepler::System<T> &system,
-                               const Vector<double>& time,
+                               const Eigen::Ref<const Vector<double>>& time,
                                bool gradient, bool numerical) {
                 system.compute(time.template cast<Scalar<T>>(), gradient, numerical);
             }, docstrings::System::compute, "time"_a, "gradient"_a=false, "numerical"_a=false)
 
+            // Compute the light curve in chunks of bounded size
+            .def("compute_stream", [](kepler::System<T> &system,
+                                      py::object& time, py::object& sink,
+                                      size_t chunk_size, bool gradient,
+                                      bool numerical, bool positions) {
+                if (chunk_size == 0)
+                    throw errors::ValueError("The chunk size must be positive.");
+                bool to_array = py::isinstance<py::array>(sink);
+                if (to_array && (gradient || positions))
+                    throw errors::ValueError("The gradient and the positions "
+                                             "can only be passed to a "
+                                             "callable sink.");
+                ssize_t start = 0;
+
+                // Compute the light curve for one chunk and pass it on
+                auto process = [&](const Eigen::Ref<const Vector<double>>& chunk) {
+                    {
+                        py::gil_scoped_release release;
+                        system.compute(chunk.template cast<Scalar<T>>(),
+                                       gradient, numerical);
+                    }
+                    ssize_t n = chunk.size();
+                    py::object lc;
+                    if (system.primary->nwav == 1)
+                        lc = py::cast(getColumn(system.getLightcurve(),
+                                                0).template cast<double>());
+                    else
+                        lc = py::cast(system.getLightcurve().template
+                                      cast<double>());
+                    if (to_array) {
+                        sink.attr("__setitem__")(py::slice(start, start + n, 1), lc);
+                    } else {
+                        py::dict kwargs;
+                        if (gradient)
+                            kwargs["gradient"] = gradientDict(
+                                gradientAsDouble(system.getLightcurveGradient()),
+                                system.getLightcurveGradientNames(),
+                                system.primary->nwav);
+                        if (positions) {
+                            py::list xyz;
+                            for (auto sec : system.secondaries)
+                                xyz.append(py::make_tuple(
+                                    sec->getXVector().template cast<double>(),
+                                    sec->getYVector().template cast<double>(),
+                                    sec->getZVector().template cast<double>()));
+                            kwargs["positions"] = xyz;
+                        }
+                        sink(start, lc, **kwargs);
+                    }
+                    start += n;
+                };
+
+                // Hold a contiguous double copy of each time array (if
+                // a conversion is needed) for as long as we use it
+                typedef py::array_t<double, py::array::c_style |
+                                            py::array::forcecast> TimeArray;
+                auto asVector = [](const TimeArray& arr) {
+                    if (arr.ndim() != 1)
+                        throw errors::ValueError("The time array must be "
+                                                 "one-dimensional.");
+                    return Eigen::Map<const Vector<double>>(arr.data(),
+                                                            arr.size());
+                };
+
+                if (py::isinstance<py::array>(time)) {
+                    // Split the time array into chunks
+                    TimeArray arr = py::cast<TimeArray>(time);
+                    Eigen::Map<const Vector<double>> t = asVector(arr);
+                    ssize_t NT = t.size();
+                    for (ssize_t i = 0; i < NT; i += chunk_size)
+                        process(t.segment(i, std::min(ssize_t(chunk_size), NT - i)));
+                } else {
+                    // Consume chunks from an iterable (e.g., a generator)
+                    for (auto item : time) {
+                        TimeArray arr = py::cast<TimeArray>(item);
+                        process(asVector(arr));
+                    }
+                }
+                return start;
+            }, docstrings::System::compute_stream, "time"_a, "sink"_a,
+               "chunk_size"_a=10000, "gradient"_a=false, "numerical"_a=false,
+               "positions"_a=false)
+
+            // Compute the light curve for an ensemble of parameter vectors
+            .def("compute_ensemble", [](kepler::System<T> &system,
+                                        const Matrix<double>& params,
+                                        const Eigen::Ref<const Vector<double>>& time,
+                                        const std::vector<std::string>& names,
+                                        int nthreads) -> py::object {
+                Matrix<Scalar<T>> result;
+                {
+                    py::gil_scoped_release release;
+                    system.computeEnsemble(params.template cast<Scalar<T>>(),
+                                           names,
+                                           time.template cast<Scalar<T>>(),
+                                           result, nthreads);
+                }
+                ssize_t nwav = system.primary->nwav;
+                if (nwav == 1)
+                    return py::cast(result.template cast<double>());
+                Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                              Eigen::RowMajor> res = result.template cast<double>();
+                return py::array_t<double>({ssize_t(res.rows()),
+                                            ssize_t(res.cols()) / nwav, nwav},
+                                           res.data());
+            }, docstrings::System::compute_ensemble, "params"_a, "time"_a,
+               "names"_a, "nthreads"_a=0)
+
             // Exposure time in days
             .def_property("exposure_time",
                 [](kepler::System<T> &sys) {
@@ -1284,10 +1299,17 @@ namespace pybind_interface {
                 }
             }, docstrings::System::lightcurve)
 
-            .def("__repr__", &kepler::System<T>::info);
+            // The gradient of the light curve: a dictionary of views
+            // into the gradient buffer
+            .def_property_readonly("gradient", [](kepler::System<T> &system)
+                    -> py::object {
+                return gradientDict(
+                    gradientAsDouble(system.getLightcurveGradient()),
+                    system.getLightcurveGradientNames(),
+                    system.primary->nwav);
+            }, docstrings::System::gradient)
 
-        // Add type-specific attributes & methods
-        addSystemExtras(System);
+            .def("__repr__", &kepler::System<T>::info);
 
         return System;
 
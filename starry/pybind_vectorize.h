@@ -1,11 +1,18 @@
 /**
 Vectorization wrappers for the `Map` methods.
 
+Inputs are read directly from the NumPy buffers via strided views
+(see `Arg`), with scalars broadcast on the fly, so no copies of the
+arguments are made. Outputs are written straight into NumPy arrays,
+which may optionally be provided by the user via the `out` keyword
+so that repeated calls do not allocate.
+
 */
 
 #ifndef _STARRY_VECTORIZE_H_
 #define _STARRY_VECTORIZE_H_
 
+#include <functional>
 #include <Eigen/Core>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -23,98 +30,218 @@ namespace pybind_vectorize {
     using namespace utils;
     namespace py = pybind11;
 
-    //! Vectorize a single python object
-    inline Vector<double> vectorize_arg(const py::array_t<double>& arg,
-                                        int& size){
-        Vector<double> res;
-        if (arg.size() == 1) {
-            res = Vector<double>::Constant(size, py::cast<double>(arg));
-            return res;
-        } else {
-            res = py::cast<Vector<double>>(arg);
-            if ((size == 0) || (res.size() == size)) {
-                size = res.size();
-                return res;
-            } else {
-                throw errors::ValueError("Mismatch in argument dimensions.");
+    /**
+    A read-only view into a vectorized argument. Scalars and
+    length-one arrays are broadcast lazily by using a zero stride.
+    The underlying array must outlive the view.
+
+    */
+    class Arg {
+
+        protected:
+
+            const double* data;
+            ssize_t stride;
+
+        public:
+
+            Arg() : data(nullptr), stride(0) {}
+
+            explicit Arg(const py::array_t<double>& arg) {
+                if (arg.ndim() > 1)
+                    throw errors::ValueError("Vectorized arguments must be "
+                                             "scalars or one-dimensional "
+                                             "arrays.");
+                data = arg.data();
+                if ((arg.ndim() == 0) || (arg.size() == 1))
+                    stride = 0;
+                else
+                    stride = arg.strides(0) / ssize_t(sizeof(double));
             }
-        }
+
+            inline double operator()(ssize_t i) const {
+                return data[i * stride];
+            }
+
+            //! The first `size` elements as a strided Eigen vector
+            inline Eigen::Map<const Vector<double>, 0, Eigen::InnerStride<>>
+            vector(ssize_t size) const {
+                return Eigen::Map<const Vector<double>, 0,
+                                  Eigen::InnerStride<>>(
+                    data, size, Eigen::InnerStride<>(stride));
+            }
+
+    };
+
+    //! Update the broadcast size of a set of arguments
+    inline void broadcast(const py::array_t<double>& arg, ssize_t& size) {
+        ssize_t n = arg.size();
+        if (n == 1)
+            return;
+        else if (size == 1)
+            size = n;
+        else if (n != size)
+            throw errors::ValueError("Mismatch in argument dimensions.");
     }
 
-    //! Vectorize function of three args
-    inline void vectorize_args(const py::array_t<double>& arg1,
-                               const py::array_t<double>& arg2,
-                               const py::array_t<double>& arg3,
-                               Vector<double>& arg1_v,
-                               Vector<double>& arg2_v,
-                               Vector<double>& arg3_v) {
-        int size = 0;
-        if (arg1.size() > 1) {
-            // arg1 is a vector
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-        } else if (arg2.size() > 1) {
-            // arg2 is a vector
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-            arg1_v = vectorize_arg(arg1, size);
-        } else if (arg3.size() > 1) {
-            // arg3 is a vector
-            arg3_v = vectorize_arg(arg3, size);
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-        } else {
-            // no arg is a vector
-            size = 1;
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-        }
+    //! Vectorize function of three args; returns the broadcast size
+    inline ssize_t vectorize_args(const py::array_t<double>& arg1,
+                                  const py::array_t<double>& arg2,
+                                  const py::array_t<double>& arg3,
+                                  Arg& arg1_v,
+                                  Arg& arg2_v,
+                                  Arg& arg3_v) {
+        ssize_t size = 1;
+        broadcast(arg1, size);
+        broadcast(arg2, size);
+        broadcast(arg3, size);
+        arg1_v = Arg(arg1);
+        arg2_v = Arg(arg2);
+        arg3_v = Arg(arg3);
+        return size;
     }
 
-    //! Vectorize function of four args
-    inline void vectorize_args(const py::array_t<double>& arg1,
-                               const py::array_t<double>& arg2,
-                               const py::array_t<double>& arg3,
-                               const py::array_t<double>& arg4,
-                               Vector<double>& arg1_v,
-                               Vector<double>& arg2_v,
-                               Vector<double>& arg3_v,
-                               Vector<double>& arg4_v) {
-        int size = 0;
-        if (arg1.size() > 1) {
-            // arg1 is a vector
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-            arg4_v = vectorize_arg(arg4, size);
-        } else if (arg2.size() > 1) {
-            // arg2 is a vector
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-            arg4_v = vectorize_arg(arg4, size);
-            arg1_v = vectorize_arg(arg1, size);
-        } else if (arg3.size() > 1) {
-            // arg3 is a vector
-            arg3_v = vectorize_arg(arg3, size);
-            arg4_v = vectorize_arg(arg4, size);
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-        } else if (arg4.size() > 1) {
-            // arg4 is a vector
-            arg4_v = vectorize_arg(arg4, size);
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-        } else {
-            // no arg is a vector
-            size = 1;
-            arg1_v = vectorize_arg(arg1, size);
-            arg2_v = vectorize_arg(arg2, size);
-            arg3_v = vectorize_arg(arg3, size);
-            arg4_v = vectorize_arg(arg4, size);
+    //! Vectorize function of four args; returns the broadcast size
+    inline ssize_t vectorize_args(const py::array_t<double>& arg1,
+                                  const py::array_t<double>& arg2,
+                                  const py::array_t<double>& arg3,
+                                  const py::array_t<double>& arg4,
+                                  Arg& arg1_v,
+                                  Arg& arg2_v,
+                                  Arg& arg3_v,
+                                  Arg& arg4_v) {
+        ssize_t size = 1;
+        broadcast(arg1, size);
+        broadcast(arg2, size);
+        broadcast(arg3, size);
+        broadcast(arg4, size);
+        arg1_v = Arg(arg1);
+        arg2_v = Arg(arg2);
+        arg3_v = Arg(arg3);
+        arg4_v = Arg(arg4);
+        return size;
+    }
+
+    /**
+    Return the array into which the output will be written: either
+    the user-provided `out` array, which must be a writeable, C-contiguous
+    array of doubles of the right size, or a newly allocated one.
+
+    */
+    inline py::array_t<double> get_output(const py::object& out,
+                                          const std::vector<ssize_t>& shape) {
+        ssize_t size = 1;
+        for (auto n : shape)
+            size *= n;
+        if (out.is_none())
+            return py::array_t<double>(shape);
+        if (!py::isinstance<py::array_t<double, py::array::c_style>>(out))
+            throw errors::TypeError("The `out` argument must be a "
+                                    "C-contiguous array of doubles.");
+        auto arr = py::reinterpret_borrow<py::array_t<double>>(out);
+        if (arr.size() != size)
+            throw errors::ValueError("The `out` argument has the wrong "
+                                     "number of elements.");
+        return arr;
+    }
+
+    //! Are all of these arguments zero-dimensional?
+    inline bool all_scalar(const py::array_t<double>& arg1,
+                           const py::array_t<double>& arg2,
+                           const py::array_t<double>& arg3,
+                           const py::array_t<double>& arg4) {
+        return (arg1.ndim() == 0) && (arg2.ndim() == 0) &&
+               (arg3.ndim() == 0) && (arg4.ndim() == 0);
+    }
+
+    //! Are all of these arguments zero-dimensional?
+    inline bool all_scalar(const py::array_t<double>& arg1,
+                           const py::array_t<double>& arg2,
+                           const py::array_t<double>& arg3) {
+        return (arg1.ndim() == 0) && (arg2.ndim() == 0) &&
+               (arg3.ndim() == 0);
+    }
+
+    //! Does any of these arguments have more than one dimension?
+    inline bool any_multidim(const py::array_t<double>& arg1,
+                             const py::array_t<double>& arg2,
+                             const py::array_t<double>& arg3) {
+        return (arg1.ndim() > 1) || (arg2.ndim() > 1) || (arg3.ndim() > 1);
+    }
+
+    //! Does any of these arguments have more than one dimension?
+    inline bool any_multidim(const py::array_t<double>& arg1,
+                             const py::array_t<double>& arg2,
+                             const py::array_t<double>& arg3,
+                             const py::array_t<double>& arg4) {
+        return (arg1.ndim() > 1) || (arg2.ndim() > 1) ||
+               (arg3.ndim() > 1) || (arg4.ndim() > 1);
+    }
+
+    //! Copy a (broadcast) argument into a vector of the map's scalar type
+    template <typename S>
+    inline Vector<S> gather(const Arg& arg, ssize_t size) {
+        Vector<S> vec(size);
+        for (ssize_t i = 0; i < size; ++i)
+            vec(i) = arg(i);
+        return vec;
+    }
+
+    /**
+    A (broadcast) argument as a vector of the map's scalar type `S`
+    that binds to `VectorRef<S>`. Double precision maps read the
+    NumPy buffer in place; all other types need a converted copy.
+
+    */
+    template <typename S>
+    struct ArgVector {
+        typedef Vector<S> type;
+        static inline type get(const Arg& arg, ssize_t size) {
+            return gather<S>(arg, size);
+        }
+    };
+
+    template <>
+    struct ArgVector<double> {
+        typedef Eigen::Map<const Vector<double>, 0, Eigen::InnerStride<>> type;
+        static inline type get(const Arg& arg, ssize_t size) {
+            return arg.vector(size);
         }
+    };
+
+    /**
+    Call `func` with a `MapRef<T>` view of the C-contiguous output
+    buffer `ptr` of shape `(size, nwav)`. Double precision maps
+    write straight into the buffer.
+
+    */
+    template <typename T>
+    inline typename std::enable_if<std::is_same<Scalar<T>, double>::value,
+                                   void>::type
+    into(double* ptr, ssize_t size, ssize_t nwav,
+         const std::function<void(MapRef<T>)>& func) {
+        typedef Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> Stride;
+        func(Eigen::Map<T, 0, Stride>(ptr, size, nwav, Stride(1, nwav)));
+    }
+
+    /**
+    Call `func` with a `MapRef<T>` view of the C-contiguous output
+    buffer `ptr` of shape `(size, nwav)`. Maps of other scalar types
+    write into a temporary, which we then cast into the buffer.
+
+    */
+    template <typename T>
+    inline typename std::enable_if<!std::is_same<Scalar<T>, double>::value,
+                                   void>::type
+    into(double* ptr, ssize_t size, ssize_t nwav,
+         const std::function<void(MapRef<T>)>& func) {
+        typedef Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> Stride;
+        T result;
+        resize(result, size, nwav);
+        func(result);
+        Eigen::Map<MapDouble<T>, 0, Stride>(ptr, size, nwav,
+                                            Stride(1, nwav)) =
+            result.template cast<double>();
     }
 
     //! Vectorized `flux` method: single-wavelength starry
@@ -123,78 +250,89 @@ namespace pybind_vectorize {
                                              Row<T>>::value, py::object>::type
     flux(maps::Map<T> &map, py::array_t<double>& theta, py::array_t<double>& xo,
          py::array_t<double>& yo, py::array_t<double>& ro, bool gradient,
-         bool numerical){
+         bool numerical, const py::object& out=py::none()){
+
+        // Easy! We'll just return F
+        if (!gradient && out.is_none() && (all_scalar(theta, xo, yo, ro) ||
+                                           any_multidim(theta, xo, yo, ro))) {
+            return py::vectorize([&map, &numerical](double theta, double xo,
+                                                    double yo, double ro) {
+                return static_cast<double>(map.flux(theta, xo, yo, ro, false,
+                                           numerical));
+            })(theta, xo, yo, ro);
+        }
+
+        // Vectorize the arguments manually
+        Arg theta_v, xo_v, yo_v, ro_v;
+        ssize_t sz = vectorize_args(theta, xo, yo, ro,
+                                    theta_v, xo_v, yo_v, ro_v);
+        bool scalar = out.is_none() && all_scalar(theta, xo, yo, ro);
+        auto F = get_output(out, {sz});
+        double* F_ptr = F.mutable_data();
 
         if (gradient) {
 
-            // Initialize a dictionary of derivatives
-            size_t n = max(theta.size(), max(xo.size(),
-                           max(yo.size(), ro.size())));
-            std::map<string, Matrix<double>> grad;
+            // Allocate the derivative arrays and keep track
+            // of where each derivative goes
             map.resizeGradient();
             auto dF_names = map.getGradientNames();
-            int n_ylm = 0, n_ul = 0;
+            ssize_t n_ylm = 0, n_ul = 0;
             for (auto name : dF_names) {
                 if (name == "y")
                     ++n_ylm;
                 else if (name == "u")
                     ++n_ul;
-                else
-                    grad[name].resize(n, 1);
             }
-            grad["y"].resize(n, n_ylm);
-            grad["u"].resize(n, n_ul);
-
-            // Nested lambda function;
-            // https://github.com/pybind/pybind11/issues/
-            // 761#issuecomment-288818460
-            int t = 0;
-            auto F = py::vectorize([&map, &grad, &t, &dF_names, &numerical]
-                        (double theta, double xo, double yo, double ro) {
-                // Evaluate the function
-                double res = static_cast<double>(map.flux(theta, xo, yo,
-                                                          ro, true,
-                                                          numerical));
-                // Gather the derivatives
-                auto dF = map.getGradient();
-                int n_ylm = 0, n_ul = 0;
-                for (int j = 0; j < dF.size(); j++) {
-                    if (dF_names[j] == "y") {
-                        grad["y"](t, n_ylm++) = static_cast<double>(dF(j));
-                    } else if (dF_names[j] == "u") {
-                        grad["u"](t, n_ul++) = static_cast<double>(dF(j));
-                    } else {
-                        grad[dF_names[j]](t, 0) = static_cast<double>(dF(j));
-                    }
-                }
-                t++;
-                return res;
-            })(theta, xo, yo, ro);
-
-            // Convert to an actual python dictionary
-            // Necessary because we're mixing vectors and matrices
-            // among the dictionary items.
-            // NOTE: All this copying could be slow: not ideal.
             auto pygrad = py::dict();
-            for (std::string name : dF_names) {
-                if ((name != "y") && (name != "u")) {
-                    pygrad[name.c_str()] = grad[name].col(0);
+            py::array_t<double> grad_y({n_ylm, sz}), grad_u({n_ul, sz});
+            std::vector<double*> grad_ptr(dF_names.size());
+            ssize_t ky = 0, ku = 0;
+            for (size_t j = 0; j < dF_names.size(); ++j) {
+                if (dF_names[j] == "y") {
+                    grad_ptr[j] = grad_y.mutable_data() + sz * ky++;
+                } else if (dF_names[j] == "u") {
+                    grad_ptr[j] = grad_u.mutable_data() + sz * ku++;
+                } else {
+                    py::array_t<double> arr(sz);
+                    grad_ptr[j] = arr.mutable_data();
+                    pygrad[dF_names[j].c_str()] = arr;
                 }
             }
-            pygrad["y"] = grad["y"].transpose();
-            pygrad["u"] = grad["u"].transpose();
+            pygrad["y"] = grad_y;
+            pygrad["u"] = grad_u;
+
+            // Iterate through the timeseries
+            for (ssize_t i = 0; i < sz; ++i) {
+                F_ptr[i] = static_cast<double>(map.flux(theta_v(i), xo_v(i),
+                           yo_v(i), ro_v(i), true, numerical));
+                const T& dF = map.getGradient();
+                for (size_t j = 0; j < dF_names.size(); ++j)
+                    grad_ptr[j][i] = static_cast<double>(dF(j));
+            }
 
             // Return a tuple of (F, dict(dF))
-            return py::make_tuple(F, pygrad);
+            if (scalar)
+                return py::make_tuple(F_ptr[0], pygrad);
+            else
+                return py::make_tuple(F, pygrad);
+
+        } else if (!map.batchedFlux(numerical)) {
+
+            // Iterate through the timeseries
+            for (ssize_t i = 0; i < sz; ++i)
+                F_ptr[i] = static_cast<double>(map.flux(theta_v(i), xo_v(i),
+                           yo_v(i), ro_v(i), false, numerical));
+            return std::move(F);
 
         } else {
 
-            // Easy! We'll just return F
-            return py::vectorize([&map, &numerical, &gradient](double theta, double xo,
-                                        double yo, double ro) {
-                return static_cast<double>(map.flux(theta, xo, yo, ro, gradient,
-                                           numerical));
-            })(theta, xo, yo, ro);
+            // Compute the entire timeseries at once
+            typedef ArgVector<Scalar<T>> V;
+            into<T>(F_ptr, sz, 1, [&](MapRef<T> F_b) {
+                map.flux(V::get(theta_v, sz), V::get(xo_v, sz),
+                         V::get(yo_v, sz), V::get(ro_v, sz), F_b, numerical);
+            });
+            return std::move(F);
 
         }
 
@@ -206,87 +344,82 @@ namespace pybind_vectorize {
                                             Row<T>>::value, py::object>::type
     flux(maps::Map<T> &map, py::array_t<double>& theta, py::array_t<double>& xo,
          py::array_t<double>& yo, py::array_t<double>& ro, bool gradient,
-         bool numerical){
+         bool numerical, const py::object& out=py::none()){
 
         // Vectorize the arguments manually
-        Vector<double> theta_v, xo_v, yo_v, ro_v;
-        vectorize_args(theta, xo, yo, ro,
-                       theta_v, xo_v, yo_v, ro_v);
-        size_t sz = theta_v.size();
+        Arg theta_v, xo_v, yo_v, ro_v;
+        ssize_t sz = vectorize_args(theta, xo, yo, ro,
+                                    theta_v, xo_v, yo_v, ro_v);
+        ssize_t nwav = map.nwav;
+        auto F = get_output(out, {sz, nwav});
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                                  Eigen::RowMajor>> F_mat(F.mutable_data(),
+                                                          sz, nwav);
 
         if (gradient) {
 
-            // Initialize the gradient matrix
-            std::map<string, Matrix<double>> grad;
+            // Allocate the derivative arrays and keep track
+            // of where each derivative goes
             map.resizeGradient();
             auto dF_names = map.getGradientNames();
-            int n_ylm = 0, n_ul = 0;
-            for (auto name : dF_names) {
-                if (name == "y")
-                    ++n_ylm;
-                else if (name == "u")
-                    ++n_ul;
+            auto pygrad = py::dict();
+            py::list grad_y, grad_u;
+            std::vector<double*> grad_ptr(dF_names.size());
+            for (size_t j = 0; j < dF_names.size(); ++j) {
+                py::array_t<double> arr({sz, nwav});
+                grad_ptr[j] = arr.mutable_data();
+                if (dF_names[j] == "y")
+                    grad_y.append(arr);
+                else if (dF_names[j] == "u")
+                    grad_u.append(arr);
                 else
-                    grad[name].resize(sz, map.nwav);
+                    pygrad[dF_names[j].c_str()] = arr;
             }
-
-            // Initialize the map coefficient gradients
-            std::vector<Matrix<double>> grad_y(n_ylm);
-            for (int i = 0; i < n_ylm; ++i)
-                grad_y[i].resize(sz, map.nwav);
-            std::vector<Matrix<double>> grad_u(n_ul);
-            for (int i = 0; i < n_ul; ++i)
-                grad_u[i].resize(sz, map.nwav);
+            pygrad["y"] = grad_y;
+            pygrad["u"] = grad_u;
 
             // Iterate through the timeseries
-            Matrix<double> F(sz, map.nwav);
-            for (size_t i = 0; i < sz; ++i) {
+            for (ssize_t i = 0; i < sz; ++i) {
 
                 // Function value
-                F.row(i) = map.flux(theta_v(i), xo_v(i),
-                           yo_v(i), ro_v(i), true,
-                           numerical).template cast<double>();
+                F_mat.row(i) = map.flux(theta_v(i), xo_v(i),
+                               yo_v(i), ro_v(i), true,
+                               numerical).template cast<double>();
 
                 // Gradient
-                auto dF = map.getGradient();
-                int ky = 0, ku = 0;
-                for (int j = 0; j < dF.rows(); ++j) {
-                    if (dF_names[j] == "y") {
-                        grad_y[ky++].row(i) = dF.row(j).template cast<double>();
-                    } else if (dF_names[j] == "u") {
-                        grad_u[ku++].row(i) = dF.row(j).template cast<double>();
-                    } else {
-                        grad[dF_names[j]].row(i) = dF.row(j).template cast<double>();
-                    }
+                const T& dF = map.getGradient();
+                for (size_t j = 0; j < dF_names.size(); ++j) {
+                    for (ssize_t n = 0; n < nwav; ++n)
+                        grad_ptr[j][i * nwav + n] =
+                            static_cast<double>(dF(j, n));
                 }
 
             }
 
-            // Convert to a python dictionary
-            auto pygrad = py::dict();
-            for (std::string name : dF_names) {
-                if ((name != "y") && (name != "u")) {
-                    pygrad[name.c_str()] = grad[name];
-                }
-            }
-            pygrad["y"] = grad_y;
-            pygrad["u"] = grad_u;
-
             // Cast to python object
             return py::make_tuple(F, pygrad);
 
-        } else {
+        } else if (!map.batchedFlux(numerical)) {
 
             // Iterate through the timeseries
-            Matrix<double> F(sz, map.nwav);
-            for (size_t i = 0; i < sz; ++i) {
-                F.row(i) = map.flux(theta_v(i), xo_v(i),
-                           yo_v(i), ro_v(i), false,
-                           numerical).template cast<double>();
-            }
+            for (ssize_t i = 0; i < sz; ++i)
+                F_mat.row(i) = map.flux(theta_v(i), xo_v(i), yo_v(i), ro_v(i),
+                               false, numerical).template cast<double>();
+
+            // Cast to python object
+            return std::move(F);
+
+        } else {
+
+            // Compute the entire timeseries at once
+            typedef ArgVector<Scalar<T>> V;
+            into<T>(F.mutable_data(), sz, nwav, [&](MapRef<T> F_b) {
+                map.flux(V::get(theta_v, sz), V::get(xo_v, sz),
+                         V::get(yo_v, sz), V::get(ro_v, sz), F_b, numerical);
+            });
 
             // Cast to python object
-            return py::cast(F);
+            return std::move(F);
 
         }
 
@@ -297,12 +430,32 @@ namespace pybind_vectorize {
     typename std::enable_if<!std::is_base_of<Eigen::EigenBase<Row<T>>,
                                              Row<T>>::value, py::object>::type
     evaluate(maps::Map<T> &map, py::array_t<double>& theta,
-             py::array_t<double>& x, py::array_t<double>& y){
+             py::array_t<double>& x, py::array_t<double>& y,
+             const py::object& out=py::none(), int nthreads=0){
 
         // Easy! We'll just return I
-        return py::vectorize([&map](double theta, double x, double y) {
-            return static_cast<double>(map(theta, x, y));
-        })(theta, x, y);
+        if (out.is_none() && (all_scalar(theta, x, y) ||
+                              any_multidim(theta, x, y))) {
+            return py::vectorize([&map](double theta, double x, double y) {
+                return static_cast<double>(map(theta, x, y));
+            })(theta, x, y);
+        }
+
+        // Vectorize the arguments manually
+        Arg theta_v, x_v, y_v;
+        ssize_t sz = vectorize_args(theta, x, y, theta_v, x_v, y_v);
+        auto I = get_output(out, {sz});
+
+        // Evaluate all the points at once
+        typedef ArgVector<Scalar<T>> V;
+        auto theta_b = V::get(theta_v, sz);
+        auto x_b = V::get(x_v, sz);
+        auto y_b = V::get(y_v, sz);
+        into<T>(I.mutable_data(), sz, 1, [&](MapRef<T> I_b) {
+            py::gil_scoped_release release;
+            map.evaluate(theta_b, x_b, y_b, I_b, nthreads);
+        });
+        return std::move(I);
 
     }
 
@@ -311,21 +464,27 @@ namespace pybind_vectorize {
     typename std::enable_if<std::is_base_of<Eigen::EigenBase<Row<T>>,
                                             Row<T>>::value, py::object>::type
     evaluate(maps::Map<T> &map, py::array_t<double>& theta,
-             py::array_t<double>& x, py::array_t<double>& y){
+             py::array_t<double>& x, py::array_t<double>& y,
+             const py::object& out=py::none(), int nthreads=0){
 
         // Vectorize the arguments manually
-        Vector<double> theta_v, x_v, y_v;
-        vectorize_args(theta, x, y, theta_v, x_v, y_v);
-        size_t sz = theta_v.size();
-
-        // Iterate through the timeseries
-        Matrix<double> I(sz, map.nwav);
-        for (size_t i = 0; i < sz; ++i) {
-            I.row(i) = map(theta_v(i), x_v(i), y_v(i)).template cast<double>();
-        }
+        Arg theta_v, x_v, y_v;
+        ssize_t sz = vectorize_args(theta, x, y, theta_v, x_v, y_v);
+        ssize_t nwav = map.nwav;
+        auto I = get_output(out, {sz, nwav});
+
+        // Evaluate all the points at once
+        typedef ArgVector<Scalar<T>> V;
+        auto theta_b = V::get(theta_v, sz);
+        auto x_b = V::get(x_v, sz);
+        auto y_b = V::get(y_v, sz);
+        into<T>(I.mutable_data(), sz, nwav, [&](MapRef<T> I_b) {
+            py::gil_scoped_release release;
+            map.evaluate(theta_b, x_b, y_b, I_b, nthreads);
+        });
 
         // Cast to python object
-        return py::cast(I);
+        return std::move(I);
 
     }
 
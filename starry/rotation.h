@@ -14,9 +14,11 @@ from the Wigner-D matrices for complex spherical harmonics.
 #define _STARRY_ROT_H_
 
 #include <cmath>
+#include <vector>
 #include <Eigen/Core>
 #include "utils.h"
 #include "tables.h"
+#include "profile.h"
 
 namespace starry {
 namespace rotation {
@@ -47,6 +49,97 @@ namespace rotation {
         return R;
     }
 
+    /**
+    A block-diagonal matrix with one `(2l + 1) x (2l + 1)` block for
+    each spherical harmonic degree `l`, packed contiguously in a single
+    buffer that this class owns. Block `l` starts at offset
+    `l (2l - 1) (2l + 1) / 3` and is exposed as an `Eigen::Map`.
+
+    */
+    template <typename T>
+    class BlockDiagonal {
+
+            std::vector<T> data;                                                /**< The packed blocks, in order of increasing `l` */
+
+        public:
+
+            const int lmax;                                                     /**< Highest degree */
+
+            explicit BlockDiagonal(int lmax) :
+                data(offset(lmax + 1)), lmax(lmax) {}
+
+            //! Offset of block `l` in the buffer
+            static inline int offset(int l) {
+                return l * (2 * l - 1) * (2 * l + 1) / 3;
+            }
+
+            //! Block `l`
+            inline Eigen::Map<Matrix<T>> operator[](int l) {
+                return Eigen::Map<Matrix<T>>(data.data() + offset(l),
+                                             2 * l + 1, 2 * l + 1);
+            }
+
+            //! Block `l` (read-only)
+            inline Eigen::Map<const Matrix<T>> operator[](int l) const {
+                return Eigen::Map<const Matrix<T>>(data.data() + offset(l),
+                                                   2 * l + 1, 2 * l + 1);
+            }
+
+            //! Set every block to `sign` times the identity
+            inline void setIdentity(const T& sign=1) {
+                for (int l = 0; l < lmax + 1; ++l)
+                    (*this)[l] = sign * Matrix<T>::Identity(2 * l + 1,
+                                                            2 * l + 1);
+            }
+
+            //! Set every block to the transpose of the corresponding block of `A`
+            inline void setTranspose(const BlockDiagonal<T>& A) {
+                for (int l = 0; l < lmax + 1; ++l)
+                    (*this)[l] = A[l].transpose();
+            }
+
+            //! Set every block to the product of the corresponding blocks of `A` and `B`
+            inline void setProduct(const BlockDiagonal<T>& A,
+                                   const BlockDiagonal<T>& B) {
+                for (int l = 0; l < lmax + 1; ++l)
+                    (*this)[l].noalias() = A[l] * B[l];
+            }
+
+            /**
+            Compute `out = this . in` for the map(s) `in`. The output
+            must already have the right shape and must not alias the input.
+
+            */
+            template <typename In, typename Out>
+            inline void apply(const Eigen::MatrixBase<In>& in,
+                              const Eigen::MatrixBase<Out>& out_) const {
+                Eigen::MatrixBase<Out>& out =
+                    const_cast<Eigen::MatrixBase<Out>&>(out_);
+                int ncols = in.cols();
+                for (int l = 0; l < lmax + 1; ++l)
+                    out.block(l * l, 0, 2 * l + 1, ncols).noalias() =
+                        (*this)[l] * in.block(l * l, 0, 2 * l + 1, ncols);
+            }
+
+            /**
+            Compute `out = this^T . in` for the map(s) `in`. The output
+            must already have the right shape and must not alias the input.
+
+            */
+            template <typename In, typename Out>
+            inline void applyTranspose(const Eigen::MatrixBase<In>& in,
+                                       const Eigen::MatrixBase<Out>& out_) const {
+                Eigen::MatrixBase<Out>& out =
+                    const_cast<Eigen::MatrixBase<Out>&>(out_);
+                int ncols = in.cols();
+                for (int l = 0; l < lmax + 1; ++l)
+                    out.block(l * l, 0, 2 * l + 1, ncols).noalias() =
+                        (*this)[l].transpose() *
+                        in.block(l * l, 0, 2 * l + 1, ncols);
+            }
+
+    };
+
     /**
     Rotation matrix class for the spherical harmonics.
 
@@ -69,11 +162,16 @@ namespace rotation {
         T cache_costheta;                                                       /**< Last value of cos(theta) used */
         T cache_sintheta;                                                       /**< Last value of sin(theta) used */
         MapType cache_y;                                                        /**< Last value of the rotated map coefficients */
+        UnitVector<T> cache_axis;                                               /**< Axis for which the `zeta` frame matrices were last computed */
+        T cache_R_costheta;                                                     /**< Value of cos(theta) for which `R` was last computed */
+        T cache_R_sintheta;                                                     /**< Value of sin(theta) for which `R` was last computed */
 
         // The actual Wigner matrices
-        Matrix<T>* DZeta;                                                       /**< The complex Wigner matrix in the `zeta` frame */
-        Matrix<T>* RZeta;                                                       /**< The real Wigner matrix in the `zeta` frame */
-        Matrix<T>* RZetaInv;                                                    /**< The inverse of the real Wigner matrix in the `zeta` frame */
+        BlockDiagonal<T> DZeta;                                                 /**< The complex Wigner matrix in the `zeta` frame */
+        BlockDiagonal<T> RZeta;                                                 /**< The real Wigner matrix in the `zeta` frame */
+        BlockDiagonal<T> RZetaInv;                                              /**< The inverse of the real Wigner matrix in the `zeta` frame */
+        Matrix<T> RZetaInvRz;                                                   /**< Workspace for `RZetaInv . Rz` */
+        Matrix<T> RZetaInvdRz;                                                  /**< Workspace for `RZetaInv . dRz / dtheta` */
 
         // `zhat` rotation params
         Vector<T> cosnt;                                                        /**< Vector of cos(n theta) values */
@@ -85,6 +183,15 @@ namespace rotation {
         UnitVector<T> axis_zeta;                                                /**< Axis of rotation to align the rotation axis with `zhat` */
         MapType y_zeta;                                                         /**< The base map in the `zeta` frame */
         MapType y_zeta_rot;                                                     /**< The base map in the `zeta` frame after a `zhat` rotation */
+        MapType y_zeta_drot;                                                    /**< Derivative of `y_zeta_rot` with respect to theta */
+
+        // Matrix-free rotation params
+        Vector<T> cosmt_grad;                                                   /**< cos(m theta) at the angle of the last call to `rotateWithGradient` */
+        Vector<T> sinmt_grad;                                                   /**< sin(m theta) at the angle of the last call to `rotateWithGradient` */
+        MapType ytmp1;                                                          /**< Workspace for `applyR` */
+        MapType ytmp2;                                                          /**< Workspace for `applyR` */
+        Vector<T> vtmp1;                                                        /**< Workspace for `dotR` */
+        Vector<T> vtmp2;                                                        /**< Workspace for `dotR` */
 
         // Methods
         inline void rotar(T& c1, T& s1, T& c2, T& s2, T& c3, T& s3);
@@ -92,40 +199,40 @@ namespace rotation {
         inline void computeZeta(const UnitVector<T>& axis, const T& costheta,
                                 const T& sintheta);
         inline void rotate(const T& costheta, const T& sintheta);
+        template <typename In, typename Out>
+        inline void applyRz(const Eigen::MatrixBase<In>& in,
+                            Eigen::MatrixBase<Out>& out, const T& sign);
 
     public:
 
-        Matrix<T>* R;                                                           /**< The full rotation matrix for real spherical harmonics */
-        Matrix<T>* dRdtheta;                                                    /**< The derivative of the rotation matrix with respect to theta */
+        BlockDiagonal<T> R;                                                     /**< The full rotation matrix for real spherical harmonics */
+        BlockDiagonal<T> dRdtheta;                                              /**< The derivative of the rotation matrix with respect to theta */
         Vector<T> cosmt;                                                        /**< Vector of cos(m theta) values */
         Vector<T> sinmt;                                                        /**< Vector of sin(m theta) values */
 
         // These methods are accessed by the `Map` class
         inline void update();
+        inline void updateAxis();
+        inline void updateY();
+        inline void updateY(int l);
         inline void rotate(const T& costheta, const T& sintheta,
                            MapType& yout);
         inline void compute(const T& costheta, const T& sintheta);
+        inline void rotateWithGradient(const T& costheta, const T& sintheta,
+                                       MapType& yout, MapType& dydtheta);
+        inline void applyR(const MapType& yin, MapType& yout);
+        inline void dotR(const VectorT<T>& u, VectorT<T>& uR);
         inline void rotatez(const T& costheta, const T& sintheta,
                             const MapType& yin, MapType& yout);
 
-        // Constructor: allocate the matrices
+        // Constructor
         Wigner(int lmax, int nwav, MapType& y, UnitVector<T>& axis) :
             lmax(lmax), N((lmax + 1) * (lmax + 1)), NW(nwav),
-            tol(10 * mach_eps<T>()), y(y), axis(axis) {
-
-            // Allocate the Wigner matrices
-            DZeta = new Matrix<T>[lmax + 1];
-            RZeta = new Matrix<T>[lmax + 1];
-            RZetaInv = new Matrix<T>[lmax + 1];
-            R = new Matrix<T>[lmax + 1];
-            dRdtheta = new Matrix<T>[lmax + 1];
-            for (int l = 0; l < lmax + 1; l++) {
-                DZeta[l].resize(2 * l + 1, 2 * l + 1);
-                RZeta[l].resize(2 * l + 1, 2 * l + 1);
-                RZetaInv[l].resize(2 * l + 1, 2 * l + 1);
-                R[l].resize(2 * l + 1, 2 * l + 1);
-                dRdtheta[l].resize(2 * l + 1, 2 * l + 1);
-            }
+            tol(10 * mach_eps<T>()), y(y), axis(axis),
+            DZeta(lmax), RZeta(lmax), RZetaInv(lmax),
+            RZetaInvRz(2 * lmax + 1, 2 * lmax + 1),
+            RZetaInvdRz(2 * lmax + 1, 2 * lmax + 1),
+            R(lmax), dRdtheta(lmax) {
 
             // Initialize our z rotation vectors
             cosnt.resize(max(2, lmax + 1));
@@ -142,15 +249,21 @@ namespace rotation {
             // The cached rotated map
             resize(cache_y, N, NW);
 
-        }
+            // Nothing has been computed yet
+            cache_axis.setConstant(NAN);
+            cache_R_costheta = NAN;
+            cache_R_sintheta = NAN;
+
+            // Matrix-free rotation workspaces; default to the identity
+            resize(y_zeta_rot, N, NW);
+            resize(y_zeta_drot, N, NW);
+            resize(ytmp1, N, NW);
+            resize(ytmp2, N, NW);
+            vtmp1.resize(N);
+            vtmp2.resize(N);
+            cosmt_grad.setOnes(N);
+            sinmt_grad.setZero(N);
 
-        // Destructor: free the matrices
-        ~Wigner() {
-            delete [] DZeta;
-            delete [] RZeta;
-            delete [] RZetaInv;
-            delete [] R;
-            delete [] dRdtheta;
         }
 
     };
@@ -164,20 +277,21 @@ namespace rotation {
                                         const typename MapType::Scalar& sintheta,
                                         MapType& yout) {
 
+        STARRY_PROFILE_SCOPE(profile::ROTATE);
+
         // Return the cached result?
         if ((costheta == cache_costheta) && (sintheta == cache_sintheta)) {
+            STARRY_PROFILE_CACHE(profile::WIGNER_ROTATE, true);
             yout = cache_y;
             return;
         }
+        STARRY_PROFILE_CACHE(profile::WIGNER_ROTATE, false);
 
         // Rotate `yzeta` about `zhat` and store in `yzeta_rot`;
         rotatez(costheta, sintheta, y_zeta, y_zeta_rot);
 
         // Rotate out of the `zeta` frame
-        for (int l = 0; l < lmax + 1; l++) {
-            cache_y.block(l * l, 0, 2 * l + 1, NW) =
-                RZetaInv[l] * y_zeta_rot.block(l * l, 0, 2 * l + 1, NW);
-        }
+        RZetaInv.apply(y_zeta_rot, cache_y);
 
         // Export the result and cache the angles
         yout = cache_y;
@@ -226,6 +340,15 @@ namespace rotation {
     inline void Wigner<MapType>::compute(const typename MapType::Scalar& costheta,
                                          const typename MapType::Scalar& sintheta) {
 
+        // The matrices depend only on the axis and the angle
+        bool cached = (costheta == cache_R_costheta) &&
+                      (sintheta == cache_R_sintheta);
+        STARRY_PROFILE_CACHE(profile::WIGNER_MATRIX, cached);
+        if (cached)
+            return;
+        cache_R_costheta = costheta;
+        cache_R_sintheta = sintheta;
+
         // Compute the cos and sin vectors for the zhat rotation
         cosnt(1) = costheta;
         sinnt(1) = sintheta;
@@ -250,17 +373,118 @@ namespace rotation {
         // Now compute the full rotation matrix
         int m;
         for (int l = 0; l < lmax + 1; l++) {
+            Eigen::Map<Matrix<T>> RZetaInvl(RZetaInv[l]);
             for (int j = 0; j < 2 * l + 1; j++) {
                 m = j - l;
-                R[l].col(j) = RZetaInv[l].col(j) * cosmt(l * l + j) +
-                              RZetaInv[l].col(2 * l - j) * sinmt(l * l + j);
-                dRdtheta[l].col(j) = RZetaInv[l].col(2 * l - j) * m * cosmt(l * l + j) -
-                                     RZetaInv[l].col(j) * m * sinmt(l * l + j);
+                RZetaInvRz.col(j).head(2 * l + 1) =
+                    RZetaInvl.col(j) * cosmt(l * l + j) +
+                    RZetaInvl.col(2 * l - j) * sinmt(l * l + j);
+                RZetaInvdRz.col(j).head(2 * l + 1) =
+                    RZetaInvl.col(2 * l - j) * (m * cosmt(l * l + j)) -
+                    RZetaInvl.col(j) * (m * sinmt(l * l + j));
+            }
+            R[l].noalias() =
+                RZetaInvRz.topLeftCorner(2 * l + 1, 2 * l + 1) * RZeta[l];
+            dRdtheta[l].noalias() =
+                RZetaInvdRz.topLeftCorner(2 * l + 1, 2 * l + 1) * RZeta[l];
+        }
+
+    }
+
+    /**
+    Rotate the base map given `costheta` and `sintheta` and compute the
+    derivative of the rotated map with respect to theta, without forming
+    the rotation matrices. Since
+
+        R . y = RZetaInv . Rz . (RZeta . y)
+
+    and `RZeta . y` is cached by `update()`, both products cost one
+    `zhat` rotation and one block-diagonal product each. The angle is
+    stored for subsequent calls to `applyR` and `dotR`.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::rotateWithGradient(
+            const typename MapType::Scalar& costheta,
+            const typename MapType::Scalar& sintheta,
+            MapType& yout, MapType& dydtheta) {
+
+        STARRY_PROFILE_SCOPE(profile::ROTATE);
+
+        // Rotate `yzeta` about `zhat`; this also sets `cosmt`,
+        // `sinmt` and the degree-wise reversed map `yrev`
+        rotatez(costheta, sintheta, y_zeta, y_zeta_rot);
+        cosmt_grad = cosmt;
+        sinmt_grad = sinmt;
+
+        // Apply dRz / dtheta to `yzeta`
+        int n = 0;
+        for (int l = 0; l < lmax + 1; l++) {
+            for (int m = -l; m < l + 1; m++) {
+                y_zeta_drot.row(n) = -m * (sinmt(n) * y_zeta.row(n) +
+                                           cosmt(n) * yrev.row(n));
+                n++;
             }
-            R[l] = R[l] * RZeta[l];
-            dRdtheta[l] = dRdtheta[l] * RZeta[l];
         }
 
+        // Rotate out of the `zeta` frame
+        RZetaInv.apply(y_zeta_rot, cache_y);
+        RZetaInv.apply(y_zeta_drot, dydtheta);
+
+        // Export the result and cache the angles
+        yout = cache_y;
+        cache_costheta = costheta;
+        cache_sintheta = sintheta;
+
+    }
+
+    /**
+    Compute `yout = R . yin` for an arbitrary map `yin`, where `R` is
+    the rotation matrix at the angle of the last call to
+    `rotateWithGradient`.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::applyR(const MapType& yin, MapType& yout) {
+        RZeta.apply(yin, ytmp1);
+        applyRz(ytmp1, ytmp2, 1);
+        RZetaInv.apply(ytmp2, yout);
+    }
+
+    /**
+    Compute the row vector `uR = u . R`, where `R` is the rotation matrix
+    at the angle of the last call to `rotateWithGradient`. This is the
+    matrix-free equivalent of `R^T . u^T`, used in the gradient with
+    respect to the map coefficients.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::dotR(const VectorT<typename MapType::Scalar>& u,
+                                      VectorT<typename MapType::Scalar>& uR) {
+        RZetaInv.applyTranspose(u.transpose(), vtmp1);
+        applyRz(vtmp1, vtmp2, -1);
+        RZeta.applyTranspose(vtmp2, vtmp1);
+        uR = vtmp1.transpose();
+    }
+
+    /**
+    Apply the `zhat` rotation matrix `Rz` (if `sign = 1`) or its
+    transpose (if `sign = -1`) at the angle of the last call to
+    `rotateWithGradient`.
+
+    */
+    template <class MapType>
+    template <typename In, typename Out>
+    inline void Wigner<MapType>::applyRz(const Eigen::MatrixBase<In>& in,
+                                         Eigen::MatrixBase<Out>& out,
+                                         const typename MapType::Scalar& sign) {
+        for (int l = 0; l < lmax + 1; l++) {
+            for (int j = 0; j < 2 * l + 1; j++) {
+                out.row(l * l + j) =
+                    cosmt_grad(l * l + j) * in.row(l * l + j) -
+                    (sign * sinmt_grad(l * l + j)) * in.row(l * l + 2 * l - j);
+            }
+        }
     }
 
     /**
@@ -270,6 +494,26 @@ namespace rotation {
     */
     template <class MapType>
     inline void Wigner<MapType>::update() {
+        updateAxis();
+        updateY();
+    }
+
+    /**
+    Update the zeta rotation matrix. This is keyed on the axis, so it
+    is a no-op unless the axis changed since the last call.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::updateAxis() {
+
+        // Nothing to do if the axis hasn't changed
+        bool cached = (axis == cache_axis);
+        STARRY_PROFILE_CACHE(profile::WIGNER_AXIS, cached);
+        if (cached)
+            return;
+        cache_axis = axis;
+        cache_R_costheta = NAN;
+        cache_R_sintheta = NAN;
 
         // Compute the rotation transformation into and out of the `zeta` frame
         cos_zeta = axis(2);
@@ -278,15 +522,9 @@ namespace rotation {
         if (abs(norm) < tol) {
             // The rotation axis is zhat, so our zeta transform
             // is just the identity matrix.
-            for (int l = 0; l < lmax + 1; l++) {
-               if (axis(2) > 0) {
-                   RZeta[l] = Matrix<T>::Identity(2 * l + 1, 2 * l + 1);
-                   RZetaInv[l] = Matrix<T>::Identity(2 * l + 1, 2 * l + 1);
-               } else {
-                   RZeta[l] = -Matrix<T>::Identity(2 * l + 1, 2 * l + 1);
-                   RZetaInv[l] = -Matrix<T>::Identity(2 * l + 1, 2 * l + 1);
-               }
-            }
+            T sign = (axis(2) > 0) ? 1 : -1;
+            RZeta.setIdentity(sign);
+            RZetaInv.setIdentity(sign);
         } else {
             // We need to compute the actual Wigner matrices
             axis_zeta(0) = axis(1) / norm;
@@ -295,12 +533,42 @@ namespace rotation {
             computeZeta(axis_zeta, cos_zeta, sin_zeta);
         }
 
+    }
+
+    /**
+    Update the base map in the zeta frame after the map coeffs changed.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::updateY() {
+
         // Update the map in the `zeta` frame
-        for (int l = 0; l < lmax + 1; l++) {
-            y_zeta.block(l * l, 0, 2 * l + 1, NW) =
-                RZeta[l] * y.block(l * l, 0, 2 * l + 1, NW);
+        RZeta.apply(y, y_zeta);
+
+        // Reset the cache
+        cache_costheta = NAN;
+        cache_sintheta = NAN;
+
+    }
+
+    /**
+    Update degree `l` of the base map in the zeta frame after only
+    coefficients of that degree changed.
+
+    */
+    template <class MapType>
+    inline void Wigner<MapType>::updateY(int l) {
+
+        // If the axis moved under us, we need a full update
+        if (axis != cache_axis) {
+            update();
+            return;
         }
 
+        // Update the map in the `zeta` frame
+        y_zeta.block(l * l, 0, 2 * l + 1, NW) =
+            RZeta[l] * y.block(l * l, 0, 2 * l + 1, NW);
+
         // Reset the cache
         cache_costheta = NAN;
         cache_sintheta = NAN;
@@ -404,8 +672,7 @@ namespace rotation {
         rotar(cosalpha, sinalpha, cosbeta, sinbeta, cosgamma, singamma);
 
         // Set the inverse transform
-        for (int l = 0; l < lmax + 1; l++)
-            RZetaInv[l] = RZeta[l].transpose();
+        RZetaInv.setTranspose(RZeta);
 
         return;
 
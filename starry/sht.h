@@ -0,0 +1,407 @@
+/**
+Forward spherical harmonic transforms of HEALPix and latitude-longitude
+maps, used to load images into a `Map`.
+
+This reproduces what `healpy.map2alm` does (quadrature on the HEALPix
+grid, refined with `STARRY_SHT_ITER` Jacobi iterations), but directly
+in the real spherical harmonic basis used by `starry` and for many maps
+(e.g., wavelength bins) at once. Latitude-longitude images are first
+resampled onto a HEALPix grid by nearest pixel, as in
+`starry.maps.array2map`.
+
+*/
+
+#ifndef _STARRY_SHT_H_
+#define _STARRY_SHT_H_
+
+#include <cmath>
+#include <vector>
+#include <Eigen/Core>
+#include "errors.h"
+#include "utils.h"
+
+namespace starry {
+namespace sht {
+
+    using namespace utils;
+    using std::abs;
+    using std::sqrt;
+
+    /**
+    The geometry of a HEALPix grid in the RING scheme (Gorski et al. 2005).
+    Ring `r = 0, ..., nring - 1` contains the `nphi[r]` pixels starting at
+    index `start[r]`, equally spaced in longitude beginning at `phi0[r]`.
+
+    */
+    template <class T>
+    class HEALPix {
+
+        public:
+
+            const int nside;                                                    /**< Number of pixels on the side of a base pixel */
+            const long npix;                                                    /**< Number of pixels */
+            const int nring;                                                    /**< Number of iso-latitude rings */
+            std::vector<T> z;                                                   /**< Cosine of the colatitude of each ring */
+            std::vector<T> sinth;                                               /**< Sine of the colatitude of each ring */
+            std::vector<int> nphi;                                              /**< Number of pixels in each ring */
+            std::vector<long> start;                                            /**< Index of the first pixel in each ring */
+            std::vector<T> phi0;                                                /**< Longitude of the first pixel in each ring */
+
+            //! Constructor
+            explicit HEALPix(int nside) :
+                nside(nside),
+                npix(12L * nside * nside),
+                nring(4 * nside - 1),
+                z(nring),
+                sinth(nring),
+                nphi(nring),
+                start(nring),
+                phi0(nring) {
+
+                if (nside < 1)
+                    throw errors::ValueError("Invalid HEALPix `nside`.");
+                T pi_ = pi<T>();
+                for (int r = 0; r < nring; ++r) {
+                    int ir = r + 1;
+                    if ((ir < nside) || (ir > 3 * nside)) {
+                        // Polar caps
+                        int i = (ir < nside) ? ir : 4 * nside - ir;
+                        T tmp = T(i) * i / (3. * nside * nside);
+                        z[r] = (ir < nside) ? T(1 - tmp) : T(tmp - 1);
+                        sinth[r] = sqrt(tmp * (2 - tmp));
+                        nphi[r] = 4 * i;
+                        start[r] = (ir < nside) ? 2L * i * (i - 1) :
+                                                  npix - 2L * i * (i + 1);
+                        phi0[r] = pi_ / (4 * i);
+                    } else {
+                        // Equatorial belt
+                        z[r] = T(2 * nside - ir) * 2 / (3. * nside);
+                        sinth[r] = sqrt((1 - z[r]) * (1 + z[r]));
+                        nphi[r] = 4 * nside;
+                        start[r] = 2L * nside * (nside - 1) +
+                                   4L * nside * (ir - nside);
+                        phi0[r] = ((ir + nside) & 1) ? T(0) :
+                                                       T(pi_ / (4 * nside));
+                    }
+                }
+            }
+
+            inline long ang2pix(const T& theta, const T& phi) const;
+
+    };
+
+    /**
+    Index of the pixel containing the point at colatitude `theta` and
+    longitude `phi`. This follows `healpy.ang2pix` to the letter so that
+    we resample images onto the grid exactly as `starry.maps` does.
+
+    */
+    template <class T>
+    inline long HEALPix<T>::ang2pix(const T& theta, const T& phi) const {
+        T za = abs(cos(theta));
+        T tt = phi * T(0.6366197723675813430755350534900574);
+        if (tt < 0) {
+            tt = fmod(tt, T(4)) + 4;
+            if (tt == 4) tt = 0;
+        } else if (tt >= 4) {
+            tt = fmod(tt, T(4));
+        }
+        if (za <= T(2) / 3) {
+            // Equatorial region
+            long nl4 = 4L * nside;
+            T temp1 = nside * (T(0.5) + tt);
+            T temp2 = nside * cos(theta) * T(0.75);
+            long jp = long(temp1 - temp2);
+            long jm = long(temp1 + temp2);
+            long ir = nside + 1 + jp - jm;
+            long kshift = 1 - (ir & 1);
+            long t1 = jp + jm - nside + kshift + 1 + nl4 + nl4;
+            long ip = (t1 >> 1) % nl4;
+            return 2L * nside * (nside - 1) + (ir - 1) * nl4 + ip;
+        } else {
+            // Polar caps
+            T tp = tt - long(tt);
+            T tmp;
+            if ((za < T(0.99)) || !((theta < T(0.01)) ||
+                                    (theta > T(3.14159 - 0.01))))
+                tmp = nside * sqrt(3 * (1 - za));
+            else
+                tmp = nside * sin(theta) / sqrt((1 + za) / 3);
+            long jp = long(tp * tmp);
+            long jm = long((1 - tp) * tmp);
+            long ir = jp + jm + 1;
+            long ip = long(tt * ir);
+            return (cos(theta) > 0) ? 2 * ir * (ir - 1) + ip :
+                                      npix - 2 * ir * (ir + 1) + ip;
+        }
+    }
+
+    /**
+    Forward spherical harmonic transform on a HEALPix grid.
+
+    The maps are the columns of a `(npix, nmaps)` matrix and the
+    coefficients are the columns of a `(N, nmaps)` matrix, ordered
+    as in `Map::y`. Each ring of the grid is transformed in longitude
+    with a pair of dense products against tables of `cos(m phi)` and
+    `sin(m phi)` and then projected onto the associated Legendre
+    functions at its colatitude; the rings are distributed over
+    `nthreads` threads (default: one per hardware thread).
+
+    */
+    template <class T>
+    class Transform {
+
+        protected:
+
+            std::vector<Matrix<T>> P;                                           /**< Normalized Legendre functions `P(l, m)` on each ring */
+
+            inline void trig(int r, Matrix<T>& cosmphi, Matrix<T>& sinmphi);
+
+        public:
+
+            const int lmax;                                                     /**< Highest degree of the transform */
+            const int N;                                                        /**< Number of spherical harmonic coefficients */
+            const HEALPix<T> grid;                                              /**< The HEALPix grid */
+
+            //! Constructor
+            explicit Transform(int lmax, int nside) :
+                P(4 * nside - 1),
+                lmax(lmax),
+                N((lmax + 1) * (lmax + 1)),
+                grid(nside) {
+
+                // Orthonormal associated Legendre functions (no
+                // Condon-Shortley phase), with a factor of sqrt(2)
+                // for m > 0 from the real spherical harmonics
+                T norm = 1. / sqrt(4 * pi<T>());
+                for (int r = 0; r < grid.nring; ++r) {
+                    T x = grid.z[r];
+                    T s = grid.sinth[r];
+                    Matrix<T>& Pr = P[r];
+                    Pr.setZero(lmax + 1, lmax + 1);
+                    T pmm = norm;
+                    for (int m = 0; m < lmax + 1; ++m) {
+                        if (m > 0)
+                            pmm *= sqrt(T(2 * m + 1) / (2 * m)) * s;
+                        Pr(m, m) = pmm;
+                        if (m < lmax)
+                            Pr(m + 1, m) = sqrt(T(2 * m + 3)) * x * pmm;
+                        for (int l = m + 2; l < lmax + 1; ++l) {
+                            T a = sqrt(T(4 * l * l - 1) / (l * l - m * m));
+                            T b = sqrt(T((l - 1) * (l - 1) - m * m) /
+                                       (4 * (l - 1) * (l - 1) - 1));
+                            Pr(l, m) = a * (x * Pr(l - 1, m) -
+                                            b * Pr(l - 2, m));
+                        }
+                        if (m > 0)
+                            Pr.col(m) *= sqrt(T(2));
+                    }
+                }
+
+            }
+
+            inline void analyze(const Matrix<T>& f, Matrix<T>& y,
+                                int nthreads=0);
+            inline void synthesize(const Matrix<T>& y, Matrix<T>& f,
+                                   int nthreads=0);
+            inline void compute(const Matrix<T>& f, Matrix<T>& y,
+                                int iter=STARRY_SHT_ITER, int nthreads=0);
+
+    };
+
+    /**
+    Tabulate `cos(m phi)` and `sin(m phi)` for the pixels in ring `r`.
+
+    */
+    template <class T>
+    inline void Transform<T>::trig(int r, Matrix<T>& cosmphi,
+                                   Matrix<T>& sinmphi) {
+        int nphi = grid.nphi[r];
+        T dphi = 2 * pi<T>() / nphi;
+        cosmphi.resize(nphi, lmax + 1);
+        sinmphi.resize(nphi, lmax + 1);
+        for (int j = 0; j < nphi; ++j) {
+            T phi = grid.phi0[r] + j * dphi;
+            T c = cos(phi);
+            T s = sin(phi);
+            cosmphi(j, 0) = 1;
+            sinmphi(j, 0) = 0;
+            for (int m = 1; m < lmax + 1; ++m) {
+                cosmphi(j, m) = c * cosmphi(j, m - 1) - s * sinmphi(j, m - 1);
+                sinmphi(j, m) = s * cosmphi(j, m - 1) + c * sinmphi(j, m - 1);
+            }
+        }
+    }
+
+    /**
+    Add the quadrature estimate of the coefficients of the maps `f`
+    to `y`.
+
+    */
+    template <class T>
+    inline void Transform<T>::analyze(const Matrix<T>& f, Matrix<T>& y,
+                                      int nthreads) {
+        if (f.rows() != grid.npix)
+            throw errors::ValueError("Invalid number of pixels in map.");
+        int nmaps = f.cols();
+        T w = 4 * pi<T>() / grid.npix;
+
+        // Each thread takes every `nthreads`-th ring and accumulates
+        // into its own coefficients, which we add up in a fixed order
+        nthreads = std::min(numThreads(nthreads), grid.nring);
+        std::vector<Matrix<T>> yw(nthreads);
+        runThreads(nthreads, [&](int t) {
+            Matrix<T> cosmphi, sinmphi, C, S;
+            yw[t].setZero(N, nmaps);
+            for (int r = t; r < grid.nring; r += nthreads) {
+                trig(r, cosmphi, sinmphi);
+                auto fr = f.middleRows(grid.start[r], grid.nphi[r]);
+                C.noalias() = cosmphi.transpose() * fr;
+                S.noalias() = sinmphi.transpose() * fr;
+                for (int l = 0; l < lmax + 1; ++l) {
+                    yw[t].row(l * l + l) += (w * P[r](l, 0)) * C.row(0);
+                    for (int m = 1; m < l + 1; ++m) {
+                        yw[t].row(l * l + l + m) += (w * P[r](l, m)) *
+                                                    C.row(m);
+                        yw[t].row(l * l + l - m) -= (w * P[r](l, m)) *
+                                                    S.row(m);
+                    }
+                }
+            }
+        });
+        if ((y.rows() != N) || (y.cols() != nmaps))
+            y.setZero(N, nmaps);
+        for (int t = 0; t < nthreads; ++t)
+            y += yw[t];
+    }
+
+    /**
+    Compute the maps `f` on the grid given their coefficients `y`.
+
+    */
+    template <class T>
+    inline void Transform<T>::synthesize(const Matrix<T>& y, Matrix<T>& f,
+                                         int nthreads) {
+        if (y.rows() != N)
+            throw errors::ValueError("Invalid number of coefficients.");
+        int nmaps = y.cols();
+        f.resize(grid.npix, nmaps);
+        nthreads = std::min(numThreads(nthreads), grid.nring);
+        runThreads(nthreads, [&](int t) {
+            Matrix<T> cosmphi, sinmphi, A, B;
+            for (int r = t; r < grid.nring; r += nthreads) {
+                A.setZero(lmax + 1, nmaps);
+                B.setZero(lmax + 1, nmaps);
+                for (int l = 0; l < lmax + 1; ++l) {
+                    A.row(0) += P[r](l, 0) * y.row(l * l + l);
+                    for (int m = 1; m < l + 1; ++m) {
+                        A.row(m) += P[r](l, m) * y.row(l * l + l + m);
+                        B.row(m) -= P[r](l, m) * y.row(l * l + l - m);
+                    }
+                }
+                trig(r, cosmphi, sinmphi);
+                f.middleRows(grid.start[r], grid.nphi[r]).noalias() =
+                    cosmphi * A + sinmphi * B;
+            }
+        });
+    }
+
+    /**
+    Compute the coefficients `y` of the maps `f`, refining the
+    quadrature estimate with `iter` Jacobi iterations.
+
+    */
+    template <class T>
+    inline void Transform<T>::compute(const Matrix<T>& f, Matrix<T>& y,
+                                      int iter, int nthreads) {
+        Matrix<T> residual;
+        y.setZero(N, f.cols());
+        analyze(f, y, nthreads);
+        for (int i = 0; i < iter; ++i) {
+            synthesize(y, residual, nthreads);
+            residual = f - residual;
+            analyze(residual, y, nthreads);
+        }
+    }
+
+    /**
+    The HEALPix `nside` of a map with `npix` pixels.
+
+    */
+    inline int npix2nside(long npix) {
+        int nside = static_cast<int>(std::round(std::sqrt(npix / 12.)));
+        if ((nside < 1) || (12L * nside * nside != npix))
+            throw errors::ValueError("Invalid number of pixels "
+                                     "in HEALPix map.");
+        return nside;
+    }
+
+    /**
+    The spherical harmonic coefficients `y` of the HEALPix maps in
+    the columns of `f` (RING ordering).
+
+    */
+    template <class T>
+    inline void healpix2ylm(const Matrix<T>& f, int lmax, Matrix<T>& y,
+                            int nthreads=0) {
+        Transform<T> SHT(lmax, npix2nside(f.rows()));
+        SHT.compute(f, y, STARRY_SHT_ITER, nthreads);
+    }
+
+    /**
+    The spherical harmonic coefficients `y` of a set of latitude-longitude
+    images of the same shape. Row `i` of each image is at colatitude
+    `pi * i / (nrows - 1)` and column `j` at longitude
+    `pi - 2 pi * j / (ncols - 1)`. The images are resampled onto the
+    coarsest HEALPix grid with at least one eighth as many pixels by
+    assigning each image pixel to the grid pixel that contains it (the
+    last one wins); grid pixels that contain no image pixels are zero.
+
+    */
+    template <class T>
+    inline void latlon2ylm(const std::vector<Matrix<T>>& images, int lmax,
+                           Matrix<T>& y, int nthreads=0) {
+        int nmaps = images.size();
+        if (nmaps == 0)
+            throw errors::ValueError("No images provided.");
+        long nrows = images[0].rows();
+        long ncols = images[0].cols();
+        for (auto& image : images) {
+            if ((image.rows() != nrows) || (image.cols() != ncols))
+                throw errors::ValueError("All images must have the "
+                                         "same shape.");
+        }
+        if ((nrows < 2) || (ncols < 2))
+            throw errors::ValueError("The image must be at least 2 x 2.");
+        int nside = 2;
+        while (12L * nside * nside * 8 < nrows * ncols)
+            nside *= 2;
+        Transform<T> SHT(lmax, nside);
+
+        // Same grid as `numpy.linspace`
+        T pi_ = pi<T>();
+        std::vector<T> theta(nrows), phi(ncols);
+        for (long i = 0; i < nrows; ++i)
+            theta[i] = (i == nrows - 1) ? pi_ : T(i * (pi_ / (nrows - 1)));
+        for (long j = 0; j < ncols; ++j) {
+            long k = ncols - 1 - j;
+            phi[j] = (k == ncols - 1) ? pi_ :
+                     T(k * (2 * pi_ / (ncols - 1)) - pi_);
+        }
+
+        // Resample onto the grid
+        Matrix<T> f = Matrix<T>::Zero(SHT.grid.npix, nmaps);
+        for (long i = 0; i < nrows; ++i) {
+            for (long j = 0; j < ncols; ++j) {
+                long pix = SHT.grid.ang2pix(theta[i], phi[j]);
+                for (int n = 0; n < nmaps; ++n)
+                    f(pix, n) = images[n](i, j);
+            }
+        }
+        SHT.compute(f, y, STARRY_SHT_ITER, nthreads);
+    }
+
+} // namespace sht
+} // namespace starry
+
+#endif
@@ -19,6 +19,7 @@ TODO: Re-code this with `limbdark.h` as a template.
 #include "utils.h"
 #include "tables.h"
 #include "lld.h"
+#include "profile.h"
 
 namespace starry {
 namespace solver {
@@ -406,6 +407,7 @@ namespace solver {
                     if (n == STARRY_IJ_MAX_ITER)
                         throw errors::ConvergenceError("Primitive integral "
                                                        "`I` did not converge.");
+                    STARRY_PROFILE_TERMS(profile::SERIES_I, n);
 
                     value(vmax) = ksq(vmax) * k * res;
                     set(vmax) = true;
@@ -549,6 +551,7 @@ namespace solver {
                         // Check convergence
                         if (n == STARRY_IJ_MAX_ITER)
                             throw errors::ConvergenceError("Primitive integral `J` did not converge.");
+                        STARRY_PROFILE_TERMS(profile::SERIES_J, n);
 
                         // Store the result
                         if (ksq() >= 1)
@@ -780,6 +783,8 @@ namespace solver {
     template <class T>
     inline void Greens<T>::compute(const T& b_, const T& r_) {
 
+        STARRY_PROFILE_SCOPE(profile::GreensStage<T>::value);
+
         // Initialize the basic variables
         int n = 0;
         b = b_;
@@ -850,6 +855,11 @@ namespace solver {
         H_Q.reset();
         I_P.reset(ksq_ < 0.5);
         J_P.reset((ksq_ < 0.5) || (ksq_ > 2));
+        STARRY_PROFILE_BRANCH((ksq_ >= 1) ? profile::G_I_TABULATED :
+                              (ksq_ < 0.5) ? profile::G_I_DOWN :
+                              profile::G_I_UP);
+        STARRY_PROFILE_BRANCH(((ksq_ < 0.5) || (ksq_ > 2)) ?
+                              profile::G_J_DOWN : profile::G_J_UP);
         A_P.reset();
 
         // Populate the solution vector
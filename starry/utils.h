@@ -13,6 +13,9 @@ Miscellaneous stuff used throughout the code.
 #include <iostream>
 #include <limits>
 #include <type_traits>
+#include <exception>
+#include <thread>
+#include <vector>
 #include "errors.h"
 
 namespace starry {
@@ -36,6 +39,69 @@ namespace starry {
 #define STARRY_IJ_MAX_ITER                      200
 #endif
 
+//! Number of nodes in the Chebyshev fits to the J_v series
+#ifndef STARRY_IJ_CHEB_NODES
+#define STARRY_IJ_CHEB_NODES                    64
+#endif
+
+//! Number of points processed at a time in the batched
+//! limb darkening solver
+#ifndef STARRY_LD_BLOCK_SIZE
+#define STARRY_LD_BLOCK_SIZE                    64
+#endif
+
+//! Number of initial nodes between contact points
+//! in the limb darkening interpolation table
+#ifndef STARRY_LD_TABLE_INIT_NODES
+#define STARRY_LD_TABLE_INIT_NODES              16
+#endif
+
+//! Max number of bisections of each initial interval
+//! in the limb darkening interpolation table
+#ifndef STARRY_LD_TABLE_MAX_DEPTH
+#define STARRY_LD_TABLE_MAX_DEPTH               30
+#endif
+
+//! Number of local minima of the grid search refined with gradient
+//! descent when checking if a map is positive semi-definite
+#ifndef STARRY_MIN_RESTARTS
+#define STARRY_MIN_RESTARTS                     1
+#endif
+
+//! Max number of bisection steps in the exact minimization
+//! of quadratic maps
+#ifndef STARRY_QUAD_MAX_ITER
+#define STARRY_QUAD_MAX_ITER                    200
+#endif
+
+//! Max degree of the maps for which we attempt to certify
+//! positivity before searching for the minimum numerically
+#ifndef STARRY_MIN_CERT_DEG
+#define STARRY_MIN_CERT_DEG                     4
+#endif
+
+//! Number of points per block in the batched evaluation of a map
+#ifndef STARRY_EVAL_BLOCK
+#define STARRY_EVAL_BLOCK                       64
+#endif
+
+//! Max number of distinct rotation angles held at once
+//! in the batched evaluation of a map
+#ifndef STARRY_EVAL_GROUPS
+#define STARRY_EVAL_GROUPS                      256
+#endif
+
+//! Number of refinement iterations in the spherical harmonic
+//! transform of HEALPix maps (same as `healpy.map2alm`)
+#ifndef STARRY_SHT_ITER
+#define STARRY_SHT_ITER                         3
+#endif
+
+//! Order of the small-occultor expansion of the flux (even)
+#ifndef STARRY_APPROX_ORDER
+#define STARRY_APPROX_ORDER                     8
+#endif
+
 //! Max iterations in Kepler solver
 #ifndef STARRY_KEPLER_MAX_ITER
 #define STARRY_KEPLER_MAX_ITER                  100
@@ -65,6 +131,12 @@ namespace starry {
 #define STARRY_EPS_B_ZERO                       1e-1
 #endif
 
+//! Record call counts, timings and cache statistics
+//! of the hot paths (see `profile.h`)
+#ifndef STARRY_PROFILE
+#define STARRY_PROFILE                          0
+#endif
+
 namespace utils {
 
 
@@ -95,6 +167,10 @@ namespace utils {
     template <typename T>
     using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
 
+    //! A read-only strided view of a vector (zero stride broadcasts a scalar)
+    template <typename T>
+    using VectorRef = Eigen::Ref<const Vector<T>, 0, Eigen::InnerStride<>>;
+
     //! A generic 3-component unit vector
     template <typename T>
     using UnitVector = Eigen::Matrix<T, 3, 1>;
@@ -155,6 +231,11 @@ namespace utils {
         return "double";
     }
 
+    //! @private
+    template<> inline std::string precision(tag<float>) {
+        return "single";
+    }
+
     //! @private
     template<> inline std::string precision(tag<Multi>) {
         return std::to_string(STARRY_NMULTI) + " digits";
@@ -269,6 +350,8 @@ namespace utils {
             using Row = VectorT<T>;
             using Scalar = T;
             using MapDouble = Matrix<double>;
+            using MapRef = Eigen::Ref<Matrix<T>, 0,
+                Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
             using ColumnDouble = Vector<double>;
             using RowDouble = VectorT<double>;
             using RowBool = VectorT<bool>;
@@ -280,11 +363,22 @@ namespace utils {
             using Row = T;
             using Scalar = T;
             using MapDouble = Vector<double>;
+            using MapRef = Eigen::Ref<Vector<T>, 0, Eigen::InnerStride<>>;
             using ColumnDouble = double;
             using RowDouble = double;
             using RowBool = bool;
         };
 
+        template <typename T>
+        struct SolverSelector {
+            using Scalar = T;
+        };
+
+        template <>
+        struct SolverSelector <float> {
+            using Scalar = double;
+        };
+
     }
 
     //! The type of a `Map` row (Vector^T or scalar)
@@ -299,6 +393,13 @@ namespace utils {
     template <class MapType>
     using Scalar = typename types::TypeSelector<MapType>::Scalar;
 
+    //! The scalar type of the occultation solver of a `Map`. Single
+    //! precision maps solve for the occultation integrals in double
+    //! precision, since the `I` and `J` recursions amplify roundoff.
+    template <class MapType>
+    using SolverScalar = typename types::SolverSelector<
+        typename types::TypeSelector<MapType>::Scalar>::Scalar;
+
     //! The type of a `Map` row cast to double (Vector^T or scalar)
     template <class MapType>
     using RowDouble = typename types::TypeSelector<MapType>::RowDouble;
@@ -311,6 +412,10 @@ namespace utils {
     template <class MapType>
     using MapDouble = typename types::TypeSelector<MapType>::MapDouble;
 
+    //! A writeable strided view of a `Map`-shaped array (e.g., a NumPy buffer)
+    template <class MapType>
+    using MapRef = typename types::TypeSelector<MapType>::MapRef;
+
     //! The type of a `Map` row cast to bool (Vector or scalar)
     template <class MapType>
     using RowBool = typename types::TypeSelector<MapType>::RowBool;
@@ -386,6 +491,23 @@ namespace utils {
         vec.row(row) = val.template cast<T>();
     }
 
+    //! Set a row in a strided view of a map: Vector specialization
+    template <class T, class U>
+    inline void setRow(Eigen::Ref<Vector<T>, 0, Eigen::InnerStride<>> vec,
+                       int row, U val) {
+        vec(row) = static_cast<T>(val);
+    }
+
+    //! Set a row in a strided view of a map: Matrix specialization
+    template <class T, class U>
+    inline void setRow(Eigen::Ref<Matrix<T>, 0, Eigen::Stride<Eigen::Dynamic,
+                                                                Eigen::Dynamic>> vec,
+                       int row, const VectorT<U>& val) {
+        if (val.size() != vec.cols())
+            throw errors::ValueError("Size mismatch in the wavelength dimension.");
+        vec.row(row) = val.template cast<T>();
+    }
+
     //! Set a row in a map to a constant value: specialization for all eigen types
     template <class T, class U>
     inline typename std::enable_if<!std::is_base_of<Eigen::EigenBase<U>, U>::value, void>::type
@@ -520,6 +642,21 @@ namespace utils {
         return v == 1.0;
     }
 
+    //! Largest absolute value in a map tensor row. Specialization for all Eigen types
+    template <typename T>
+    inline typename std::enable_if<std::is_base_of<Eigen::EigenBase<T>, T>::value, typename T::Scalar>::type
+    maxAbs(const T& v) {
+        return v.cwiseAbs().maxCoeff();
+    }
+
+    //! Largest absolute value in a map tensor row. Specialization for Scalar
+    template <typename T>
+    inline typename std::enable_if<!std::is_base_of<Eigen::EigenBase<T>, T>::value, T>::type
+    maxAbs(const T& v) {
+        using std::abs;
+        return abs(v);
+    }
+
     //! VectorT-Vector dot product
     template <typename T>
     T dot(const VectorT<T>& vT, const Vector<T>& u) {
@@ -581,6 +718,41 @@ namespace utils {
         return vec * scal;
     }
 
+    //! Number of threads to use; one per hardware thread if `nthreads` <= 0
+    inline int numThreads(int nthreads) {
+        if (nthreads <= 0)
+            nthreads = std::thread::hardware_concurrency();
+        return (nthreads <= 0) ? 1 : nthreads;
+    }
+
+    /**
+    Call `work(w)` for `w = 0, ..., nthreads - 1`, each on its own
+    thread (`w = 0` runs on the calling thread), and rethrow the
+    first exception raised by any of them once they have all finished.
+
+    */
+    template <typename F>
+    inline void runThreads(int nthreads, F work) {
+        std::vector<std::exception_ptr> exceptions(nthreads);
+        auto run = [&](int w) {
+            try {
+                work(w);
+            } catch (...) {
+                exceptions[w] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int w = 1; w < nthreads; ++w)
+            threads.emplace_back(run, w);
+        run(0);
+        for (auto& thread : threads)
+            thread.join();
+        for (auto& exception : exceptions) {
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+    }
+
 
 } // namespace utils
 } // namespace starry
@@ -0,0 +1,50 @@
+"""Test the small-occultor approximation of the flux."""
+from starry import Map
+import numpy as np
+
+
+def test_approx_ld():
+    """Compare the approximate limb-darkened flux to the exact flux."""
+    map = Map(3)
+    map[1] = 0.4
+    map[2] = 0.26
+    map[3] = 0.1
+    npts = 500
+    xo = np.linspace(-1.2, 1.2, npts)
+    yo = 0.3
+    for ro in [0.01, 0.05, 0.1]:
+        map.approx_tol = 0
+        exact = map.flux(xo=xo, yo=yo, ro=ro)
+        for tol in [1e-8, 1e-10, 1e-12]:
+            map.approx_tol = tol
+            approx = map.flux(xo=xo, yo=yo, ro=ro)
+            assert np.allclose(approx, exact, atol=2 * tol, rtol=0)
+            for i in range(0, npts, 25):
+                assert np.allclose(map.flux(xo=xo[i], yo=yo, ro=ro),
+                                   exact[i], atol=2 * tol, rtol=0)
+
+
+def test_approx_ylm():
+    """Compare the approximate flux of a spherical harmonic map."""
+    for u in [0, 0.4]:
+        map = Map(5)
+        map[1, 0] = 0.3
+        map[2, 1] = 0.2
+        map[3, -2] = 0.1
+        map[1] = u
+        npts = 500
+        theta = np.linspace(0, 60, npts)
+        xo = np.linspace(-1.2, 1.2, npts)
+        yo = 0.3
+        for ro in [0.01, 0.05, 0.1]:
+            map.approx_tol = 0
+            exact = map.flux(theta=theta, xo=xo, yo=yo, ro=ro)
+            for tol in [1e-8, 1e-10, 1e-12]:
+                map.approx_tol = tol
+                approx = map.flux(theta=theta, xo=xo, yo=yo, ro=ro)
+                assert np.allclose(approx, exact, atol=2 * tol, rtol=0)
+
+
+if __name__ == "__main__":
+    test_approx_ld()
+    test_approx_ylm()
@@ -0,0 +1,44 @@
+"""Test the ensemble light curve evaluation."""
+from starry.kepler import Primary, Secondary, System
+import numpy as np
+np.random.seed(43)
+
+
+def test_ensemble():
+    """Compare `compute_ensemble` to repeated calls to `compute`."""
+    star = Primary()
+    star[1] = 0.4
+    star[2] = 0.26
+    planet = Secondary(lmax=1)
+    planet.lambda0 = 270
+    planet.r = 0.0916
+    planet.L = 5e-3
+    planet.inc = 87
+    planet.a = 11.12799
+    planet.prot = 4.3
+    planet.porb = 4.3
+    planet.tref = 2.0
+    system = System(star, planet)
+    time = np.linspace(1, 5.3, 500)
+
+    # Vary the planet map and radius
+    nwalk = 10
+    names = ["b.y[1]", "b.y[2]", "b.y[3]", "b.r"]
+    params = np.hstack([np.random.randn(nwalk, 3),
+                        0.09 + 0.01 * np.random.rand(nwalk, 1)])
+    flux = system.compute_ensemble(params, time, names, nthreads=4)
+    assert flux.shape == (nwalk, len(time))
+
+    # The system itself should be unchanged
+    assert planet.r == 0.0916
+
+    # Compare to the serial computation
+    for k in range(nwalk):
+        planet[1, :] = params[k, :3]
+        planet.r = params[k, 3]
+        system.compute(time)
+        assert np.allclose(flux[k], system.lightcurve)
+
+
+if __name__ == "__main__":
+    test_ensemble()
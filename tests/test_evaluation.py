@@ -1,6 +1,7 @@
 """Test the map evaluation."""
 import starry
 import numpy as np
+import time
 norm = 0.5 * np.sqrt(np.pi)
 
 
@@ -47,6 +48,82 @@ def test_evaluation_multi():
     return run(multi=True)
 
 
+def point_cloud(npts, frames):
+    """A cloud of points, some of them off the disk, in runs of theta."""
+    np.random.seed(42)
+    theta = np.repeat(np.linspace(0, 360, frames), npts // frames)
+    x = np.random.uniform(-1.1, 1.1, len(theta))
+    y = np.random.uniform(-1.1, 1.1, len(theta))
+    return theta, x, y
+
+
+def test_evaluation_batch():
+    """Compare the batched evaluation to the pointwise evaluation."""
+    map = starry.Map(5)
+    map.axis = [1, 1, 1] / np.sqrt(3)
+    map[1, 0] = 0.3
+    map[2, 1] = 0.2
+    map[3, -2] = 0.1
+    map[4, 3] = 0.05
+    map[1] = 0.4
+    map[2] = 0.1
+    theta, x, y = point_cloud(1000, 7)
+    I = map(theta=theta, x=x, y=y)
+    I0 = np.array([map(theta=t, x=xi, y=yi) for t, xi, yi in zip(theta, x, y)])
+    assert np.allclose(I, I0, equal_nan=True)
+    assert np.array_equal(np.isnan(I), x ** 2 + y ** 2 > 1)
+    assert np.allclose(map(theta=theta, x=x, y=y, nthreads=3), I,
+                       equal_nan=True)
+
+    # Points with distinct angles, in no particular order
+    np.random.shuffle(theta)
+    I = map(theta=theta, x=x, y=y)
+    I0 = np.array([map(theta=t, x=xi, y=yi) for t, xi, yi in zip(theta, x, y)])
+    assert np.allclose(I, I0, equal_nan=True)
+
+    # NaN angles must not share a polynomial map with other angles
+    theta[::7] = np.nan
+    I = map(theta=theta, x=x, y=y)
+    I0 = np.array([map(theta=t, x=xi, y=yi) for t, xi, yi in zip(theta, x, y)])
+    assert np.allclose(I, I0, equal_nan=True)
+    assert np.all(np.isnan(I[::7]))
+
+
+def test_evaluation_batch_spectral():
+    """Compare the batched evaluation to the pointwise evaluation."""
+    nwav = 3
+    map = starry.Map(3, nwav=nwav)
+    map[1, 0] = [0.3, 0.2, 0.1]
+    map[2, 1] = [0.1, 0.2, 0.3]
+    map[1] = 0.4 * np.ones(nwav)
+    theta, x, y = point_cloud(300, 3)
+    I = map(theta=theta, x=x, y=y)
+    assert I.shape == (len(theta), nwav)
+    I0 = np.array([map(theta=t, x=xi, y=yi)
+                   for t, xi, yi in zip(theta, x, y)]).reshape(-1, nwav)
+    assert np.allclose(I, I0, equal_nan=True)
+
+
+def test_evaluation_timing(npts=1000000, frames=10):
+    """Benchmark the batched evaluation against pointwise evaluation."""
+    map = starry.Map(5)
+    map.load_image('earth')
+    map.axis = [1, 1, 1] / np.sqrt(3)
+    theta, x, y = point_cloud(npts, frames)
+    tstart = time.time()
+    map(theta=theta, x=x, y=y)
+    t_batch = time.time() - tstart
+    nchk = 10000
+    tstart = time.time()
+    for t, xi, yi in zip(theta[:nchk], x[:nchk], y[:nchk]):
+        map(theta=t, x=xi, y=yi)
+    t_point = (time.time() - tstart) * len(theta) / nchk
+    print("Evaluation time [Pointwise]: %.3f [%.3f]" % (t_batch, t_point))
+
+
 if __name__ == "__main__":
     test_evaluation_double()
     test_evaluation_multi()
+    test_evaluation_batch()
+    test_evaluation_batch_spectral()
+    test_evaluation_timing()
@@ -1,6 +1,7 @@
 """Test exposure time integration."""
 import starry
 import numpy as np
+import pytest
 
 
 def moving_average(a, n):
@@ -52,5 +53,20 @@ def test_exposure():
     assert np.all(np.abs(dFdt_exp - dFdt_num[::thin]) < 1e-3)
 
 
+def test_exposure_max_depth():
+    """The maximum recursion depth cannot be negative."""
+    star = starry.kepler.Primary()
+    planet = starry.kepler.Secondary()
+    system = starry.kepler.System(star, planet)
+    system.exposure_time = 0.003
+    with pytest.raises(ValueError):
+        system.exposure_max_depth = -1
+    assert system.exposure_max_depth == 4
+    system.exposure_max_depth = 0
+    system.compute(np.linspace(-0.01, 0.01, 10))
+    assert np.all(np.isfinite(system.lightcurve))
+
+
 if __name__ == "__main__":
     test_exposure()
+    test_exposure_max_depth()
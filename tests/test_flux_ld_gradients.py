@@ -135,6 +135,29 @@ def test_ld_flux_with_gradients_multi():
         run_flux(multi=True, case=case)
 
 
+def test_ld_flux_with_gradients_high_degree():
+    """Test the flux with gradients for a high degree map."""
+    lmax = 8
+    y_deg = 5
+    map = starry.Map(lmax)
+    map.axis = [1, 1, 1] / np.sqrt(3)
+    np.random.seed(42)
+    for l in range(1, y_deg + 1):
+        map[l, :] = 0.1 * np.random.randn(2 * l + 1) / l
+    map[1] = 0.4
+    map[2] = 0.2
+    map[3] = 0.05
+    I = map.flux(xo=0.2, yo=-0.3, ro=0.25, theta=40)
+    I_grad, dI = map.flux(xo=0.2, yo=-0.3, ro=0.25, theta=40, gradient=True)
+    assert np.allclose(I, I_grad, atol=1e-7)
+    dI_num = num_grad_flux(False, lmax, y_deg, map.y, map.u,
+                           map.axis, 40, 0.2, -0.3, 0.25, eps=1e-7)
+    for key in dI.keys():
+        if key in dI_num.keys():
+            assert np.allclose(dI[key], dI_num[key], atol=1e-6)
+
+
 if __name__ == "__main__":
     test_ld_flux_with_gradients_double()
     test_ld_flux_with_gradients_multi()
+    test_ld_flux_with_gradients_high_degree()
@@ -0,0 +1,108 @@
+"""Test the positivity check for spherical harmonic maps."""
+from starry import Map
+import numpy as np
+import pytest
+import time
+
+
+def random_map(lmax, amp, nwav=1, seed=0):
+    """Return a map with random spherical harmonic coefficients."""
+    np.random.seed(seed)
+    map = Map(lmax, nwav=nwav)
+    for l in range(1, lmax + 1):
+        for m in range(-l, l + 1):
+            if nwav == 1:
+                map[l, m] = amp * np.random.randn() / l ** 2
+            else:
+                map[l, m] = amp * np.random.randn(nwav) / l ** 2
+    return map
+
+
+def test_is_physical():
+    """Check some maps whose positivity we know."""
+    map = Map(3)
+    map[2, 0] = 0.1
+    map[3, 1] = 0.05
+    assert map.is_physical()
+    map[2, 0] = 1.0
+    assert not map.is_physical()
+    map[2, 0] = 0
+    map[3, 1] = 0
+    assert map.is_physical()
+
+
+def test_is_physical_axisymmetric():
+    """Axisymmetric quadratic maps whose minimum is at a pole."""
+    np.random.seed(1)
+    map = Map(2)
+    for n in range(1000):
+        map[1, 0] = np.random.uniform(-0.3, 0.3)
+        map[2, 0] = np.random.uniform(-0.15, 0)
+        assert map.is_physical()
+    map[1, 0] = 1.0
+    map[2, 0] = 0
+    assert not map.is_physical()
+
+
+def test_is_physical_spectral():
+    """The spectral check is the same as the check in each bin."""
+    nwav = 10
+    map = random_map(4, 0.3, nwav=nwav)
+    physical = map.is_physical()
+    assert len(physical) == nwav
+    assert 0 < np.count_nonzero(physical) < nwav
+    for n in range(nwav):
+        map0 = Map(4)
+        map0[:, :] = map.y[:, n]
+        assert map0.is_physical() == physical[n]
+
+
+def test_is_physical_restarts():
+    """More restarts can only find more negative maps."""
+    for seed in range(100):
+        map = random_map(3, 0.4, seed=seed)
+        physical = map.is_physical()
+        physical3 = map.is_physical(restarts=3, nthreads=3)
+        assert physical or not physical3
+    with pytest.raises(ValueError):
+        map.is_physical(restarts=0)
+
+
+def brute_minimum(map, res=300):
+    """Minimum of the map over both hemispheres on a dense grid."""
+    x, y = np.meshgrid(np.linspace(-1, 1, res), np.linspace(-1, 1, res))
+    x = x.flatten()
+    y = y.flatten()
+    I = np.concatenate([map(theta=0, x=x, y=y), map(theta=180, x=x, y=y)])
+    return np.nanmin(I)
+
+
+@pytest.mark.parametrize("lmax", [2, 3, 4])
+def test_is_physical_brute(lmax):
+    """Compare to a brute force search for the minimum."""
+    for seed in range(50):
+        map = random_map(lmax, 0.3, seed=seed)
+        minimum = brute_minimum(map)
+        if np.abs(minimum) > 1e-2:
+            assert map.is_physical() == (minimum > 0)
+
+
+def test_is_physical_timing(nmaps=1000):
+    """Time the positivity check."""
+    for lmax in [2, 4, 6]:
+        maps = [random_map(lmax, 0.15, seed=seed) for seed in range(nmaps)]
+        tstart = time.time()
+        for map in maps:
+            map.is_physical()
+        t = (time.time() - tstart) / nmaps
+        print("lmax = %d: %.1f us per call" % (lmax, 1e6 * t))
+
+
+if __name__ == "__main__":
+    test_is_physical()
+    test_is_physical_axisymmetric()
+    test_is_physical_spectral()
+    test_is_physical_restarts()
+    for lmax in [2, 3, 4]:
+        test_is_physical_brute(lmax)
+    test_is_physical_timing()
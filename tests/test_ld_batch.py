@@ -0,0 +1,45 @@
+"""Test the batched limb darkening flux computation."""
+from starry import Map
+import numpy as np
+
+
+def test_ld_batch():
+    """Compare the vectorized flux to point-by-point evaluation."""
+    for lmax, nwav in [(2, 1), (8, 1), (20, 1), (8, 3)]:
+        map = Map(lmax, nwav=nwav)
+        for l in range(1, lmax + 1):
+            if nwav == 1:
+                map[l] = 0.1 / l
+            else:
+                map[l] = 0.1 / l * np.ones(nwav)
+        npts = 500
+        xo = np.linspace(-2.5, 2.5, npts)
+        yo = 0.1
+        ro = np.array([0.01, 0.1, 0.5, 1.5])[np.arange(npts) % 4]
+        flux = map.flux(xo=xo, yo=yo, ro=ro)
+        for i in range(npts):
+            assert np.allclose(flux[i], map.flux(xo=xo[i], yo=yo, ro=ro[i]),
+                               atol=1e-12)
+
+
+
+def test_ld_batch_nan():
+    """Check that NaN inputs give NaN fluxes and don't affect the rest."""
+    map = Map(4)
+    map[1] = 0.4
+    map[2] = 0.26
+    npts = 500
+    xo = np.linspace(-1.5, 1.5, npts)
+    ro = 0.1 + 0.5 * (np.arange(npts) % 2)
+    flux = map.flux(xo=xo, yo=0.1, ro=ro)
+    xo[::3] = np.nan
+    ro[::7] = np.nan
+    bad = np.isnan(xo) | np.isnan(ro)
+    flux_nan = map.flux(xo=xo, yo=0.1, ro=ro)
+    assert np.all(np.isnan(flux_nan[bad]))
+    assert np.allclose(flux_nan[~bad], flux[~bad], atol=1e-14)
+
+
+if __name__ == "__main__":
+    test_ld_batch()
+    test_ld_batch_nan()
@@ -0,0 +1,83 @@
+"""Test the interpolation table for limb-darkened occultations."""
+from starry import Map
+import numpy as np
+import time
+
+
+def test_table():
+    """Compare the tabulated limb-darkened flux to the exact flux."""
+    map = Map(4)
+    map[1] = 0.4
+    map[2] = 0.26
+    map[4] = 0.05
+    npts = 1000
+    xo = np.linspace(-2.5, 2.5, npts)
+    yo = 0.2
+    for ro in [0.01, 0.1, 0.5, 1.0, 1.5, 10.0]:
+        map.table_tol = 0
+        exact = map.flux(xo=xo, yo=yo, ro=ro)
+        for tol in [1e-6, 1e-10]:
+            map.table_tol = tol
+            table = map.flux(xo=xo, yo=yo, ro=ro)
+            assert np.allclose(table, exact, atol=10 * tol, rtol=0)
+            for i in range(0, npts, 50):
+                assert np.allclose(map.flux(xo=xo[i], yo=yo, ro=ro),
+                                   exact[i], atol=10 * tol, rtol=0)
+
+
+def test_table_dr():
+    """Test the first order correction in the occultor radius."""
+    map = Map(2)
+    map[1] = 0.4
+    map[2] = 0.26
+    xo = np.linspace(-1.5, 1.5, 1000)
+    map.table_tol = 1e-10
+    map.table_dr = 1e-3
+    map.flux(xo=xo, ro=0.1)
+    ro = 0.1 + 1e-5
+    table = map.flux(xo=xo, ro=ro)
+    map.table_tol = 0
+    exact = map.flux(xo=xo, ro=ro)
+    assert np.allclose(table, exact, atol=1e-8, rtol=0)
+
+
+def test_table_timing(npts=100000, ntries=5):
+    """Benchmark the cost of building the table against lookups."""
+    map = Map(2)
+    map[1] = 0.4
+    map[2] = 0.26
+    xo = np.linspace(-1.2, 1.2, npts)
+    for ro in [0.1, 0.5]:
+        t_exact = np.zeros(ntries)
+        t_build = np.zeros(ntries)
+        t_table = np.zeros(ntries)
+        for i in range(ntries):
+            map.table_tol = 0
+            tstart = time.time()
+            map.flux(xo=xo, ro=ro)
+            t_exact[i] = time.time() - tstart
+
+            # Setting the tolerance resets the table. Build it at
+            # an occulted point on the limb, where the small radius
+            # expansion does not apply
+            map.table_tol = 1e-10
+            tstart = time.time()
+            map.flux(xo=1.0, ro=ro)
+            t_build[i] = time.time() - tstart
+            tstart = time.time()
+            map.flux(xo=xo, ro=ro)
+            t_table[i] = time.time() - tstart
+        t_exact = np.min(t_exact)
+        t_build = np.min(t_build)
+        t_table = np.min(t_table)
+        print("ro = %.1f: build %.3f ms, table %.1f ns/pt, exact %.1f ns/pt, "
+              "break-even at %d points" %
+              (ro, 1e3 * t_build, 1e9 * t_table / npts,
+               1e9 * t_exact / npts,
+               t_build / max(1e-12, (t_exact - t_table) / npts)))
+
+
+if __name__ == "__main__":
+    test_table()
+    test_table_dr()
+    test_table_timing()
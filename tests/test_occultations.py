@@ -36,5 +36,35 @@ def test_occultations():
     assert error < 0.03
 
 
+def test_occultations_ld():
+    """Test occultations of limb-darkened spherical harmonic maps."""
+    npts = 30
+    ro = 0.3
+    xo = np.linspace(-1 - ro - 0.1, 1 + ro + 0.1, npts)
+
+    # A vanishingly small Ylm term shouldn't change the
+    # limb-darkened light curve
+    map = Map(4)
+    map[1] = 0.4
+    map[2] = 0.26
+    F0 = np.array(map.flux(xo=xo, yo=0.1, ro=ro))
+    map[1, 0] = 1e-12
+    F = np.array(map.flux(theta=30, xo=xo, yo=0.1, ro=ro))
+    assert np.allclose(F, F0, atol=1e-10)
+
+    # Changing the limb darkening at a fixed angle must
+    # update the precomputed operator
+    map[2, 1] = 0.3
+    F1 = np.array(map.flux(theta=30, xo=xo, yo=0.1, ro=ro))
+    map[1] = 0.2
+    F2 = np.array(map.flux(theta=30, xo=xo, yo=0.1, ro=ro))
+    map2 = Map(4)
+    map2[:, :] = map.y
+    map2[:] = map.u
+    assert np.allclose(F2, map2.flux(theta=30, xo=xo, yo=0.1, ro=ro))
+    assert not np.allclose(F1, F2)
+
+
 if __name__ == "__main__":
     test_occultations()
+    test_occultations_ld()
@@ -0,0 +1,66 @@
+"""Test the `out` keyword of the vectorized `Map` methods."""
+import starry
+import numpy as np
+
+
+def test_flux_out():
+    """Test writing the flux into a user-provided array."""
+    map = starry.Map(2)
+    map[1, 0] = 0.5
+    map[1] = 0.4
+    xo = np.linspace(-1.5, 1.5, 100)
+    flux = map.flux(xo=xo, yo=0.1, ro=0.1)
+    out = np.empty(100)
+    res = map.flux(xo=xo, yo=0.1, ro=0.1, out=out)
+    assert res is out
+    assert np.allclose(out, flux)
+
+    # Strided (non-contiguous) inputs
+    xo2 = np.repeat(xo, 2)[::2]
+    assert np.allclose(map.flux(xo=xo2, yo=0.1, ro=0.1, out=out), flux)
+
+    # Gradients are unaffected by `out`
+    _, grad = map.flux(xo=xo, yo=0.1, ro=0.1, gradient=True)
+    _, grad_out = map.flux(xo=xo, yo=0.1, ro=0.1, gradient=True, out=out)
+    assert np.allclose(out, flux)
+    for key in grad.keys():
+        assert np.allclose(grad[key], grad_out[key])
+
+
+def test_evaluate_out():
+    """Test writing the intensity into a user-provided array."""
+    map = starry.Map(2)
+    map[1, 1] = 0.5
+    x = np.linspace(-0.5, 0.5, 10)
+    out = np.empty(10)
+    map(x=x, y=0.1, theta=30, out=out)
+    assert np.allclose(out, map(x=x, y=0.1, theta=30))
+
+
+def test_spectral_out():
+    """Test writing the flux into a user-provided array [spectral]."""
+    map = starry.Map(2, nwav=3)
+    map[1, 0] = [0.1, 0.2, 0.3]
+    xo = np.linspace(-1.5, 1.5, 50)
+    out = np.empty((50, 3))
+    map.flux(xo=xo, yo=0.1, ro=0.1, out=out)
+    assert np.allclose(out, map.flux(xo=xo, yo=0.1, ro=0.1))
+
+
+def test_bad_out():
+    """Test that we catch invalid output arrays."""
+    map = starry.Map(2)
+    for out in [np.empty(3), np.empty(10, dtype=np.float32)]:
+        try:
+            map.flux(xo=np.linspace(-1, 1, 10), ro=0.1, out=out)
+        except Exception:
+            pass
+        else:
+            raise AssertionError("Invalid `out` array was not caught.")
+
+
+if __name__ == "__main__":
+    test_flux_out()
+    test_evaluate_out()
+    test_spectral_out()
+    test_bad_out()
@@ -0,0 +1,83 @@
+"""Test the hot-path instrumentation counters."""
+import starry
+import numpy as np
+
+
+def test_profile():
+    """Check the layout of the counters and that they can be reset."""
+    starry.profile(reset=True)
+    star = starry.kepler.Primary()
+    star[1] = 0.4
+    star[2] = 0.26
+    planet = starry.kepler.Secondary()
+    planet.ecc = 0.1
+    system = starry.kepler.System(star, planet)
+    system.exposure_time = 0.01
+    system.compute(np.linspace(-0.1, 0.1, 100))
+    prof = starry.profile()
+    assert set(prof["stages"]) == set(["rotate", "limbDarken", "G",
+                                       "G_grad", "L", "kepler",
+                                       "integrate"])
+    assert set(prof["caches"]) == set(["map", "wigner_rotate",
+                                       "wigner_axis", "wigner_R",
+                                       "ld_table"])
+    assert set(prof["series"]) == set(["I", "J", "ellip"])
+    assert len(prof["series"]["J"]["histogram"]) > 0
+    if prof["enabled"]:
+        assert prof["stages"]["kepler"]["calls"] > 0
+        assert prof["stages"]["integrate"]["calls"] == 100
+        assert sum(prof["depth"]) >= 100
+        assert prof["branches"]["L_I_tabulated"] + \
+            prof["branches"]["L_I_down"] + \
+            prof["branches"]["L_I_up"] <= prof["stages"]["L"]["calls"]
+    else:
+        assert sum(prof["depth"]) == 0
+    starry.profile(reset=True)
+    prof = starry.profile()
+    assert sum(s["calls"] for s in prof["stages"].values()) == 0
+    assert sum(prof["depth"]) == 0
+    assert sum(prof["branches"].values()) == 0
+    assert np.isnan(prof["series"]["I"]["mean"])
+    assert np.isnan(prof["caches"]["map"]["hit_rate"])
+
+
+
+def test_profile_ld():
+    """Check that the limb-darkened flux paths are instrumented."""
+    xo = np.linspace(-1.5, 1.5, 100)
+    map = starry.Map(3)
+    map[1] = 0.4
+    map[2] = 0.26
+
+    # Batched solver
+    starry.profile(reset=True)
+    map.flux(xo=xo, yo=0.2, ro=0.1)
+    prof = starry.profile()
+    if prof["enabled"]:
+        assert prof["stages"]["L"]["calls"] > 0
+
+    # Interpolation table
+    map.table_tol = 1e-10
+    starry.profile(reset=True)
+    map.flux(xo=xo, yo=0.2, ro=0.1)
+    prof = starry.profile()
+    if prof["enabled"]:
+        assert prof["stages"]["L"]["calls"] > 0
+        assert prof["caches"]["ld_table"]["misses"] == 1
+        assert prof["caches"]["ld_table"]["hits"] > 0
+    map.table_tol = 0
+
+    # Limb darkening of a map with spherical harmonics
+    map[1, 0] = 0.3
+    starry.profile(reset=True)
+    map.flux(xo=xo, yo=0.2, ro=0.1)
+    prof = starry.profile()
+    if prof["enabled"]:
+        assert prof["stages"]["limbDarken"]["calls"] > 0
+        assert prof["stages"]["L"]["calls"] == 0
+    starry.profile(reset=True)
+
+
+if __name__ == "__main__":
+    test_profile()
+    test_profile_ld()
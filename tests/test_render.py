@@ -0,0 +1,71 @@
+"""Test the rendering of maps on a pixel grid."""
+from starry import Map
+import numpy as np
+import time
+
+
+def evaluate_grid(map, theta, res):
+    """Render the map by evaluating it at every pixel."""
+    x, y = np.meshgrid(np.linspace(-1, 1, res), np.linspace(-1, 1, res))
+    x = x.flatten()
+    y = y.flatten()
+    I = [map(theta=t * np.ones_like(x), x=x, y=y) for t in theta]
+    if map.nwav == 1:
+        return np.array(I).reshape(len(theta), res, res)
+    else:
+        return np.array(I).reshape(len(theta), res, res, map.nwav)
+
+
+def test_render():
+    """Compare the rendered map to the pointwise intensity."""
+    map = Map(5)
+    map.axis = [1, 1, 1] / np.sqrt(3)
+    map[1, 0] = 0.3
+    map[2, 1] = 0.2
+    map[3, -2] = 0.1
+    map[1] = 0.4
+    res = 50
+    theta = np.linspace(0, 360, 7)
+    I = map.render(theta=theta, res=res)
+    assert I.shape == (len(theta), res, res)
+    assert np.allclose(I, evaluate_grid(map, theta, res), equal_nan=True)
+    assert np.allclose(map.render(theta=theta[2], res=res), I[2],
+                       equal_nan=True)
+    assert np.allclose(map.render(theta=theta, res=res, nthreads=3), I,
+                       equal_nan=True)
+
+
+def test_render_spectral():
+    """Compare the rendered spectral map to the pointwise intensity."""
+    nwav = 3
+    map = Map(3, nwav=nwav)
+    map[1, 0] = [0.3, 0.2, 0.1]
+    map[2, 1] = [0.1, 0.2, 0.3]
+    map[1] = 0.4 * np.ones(nwav)
+    res = 40
+    theta = np.array([0, 45, 90])
+    I = map.render(theta=theta, res=res)
+    assert I.shape == (len(theta), nwav, res, res)
+    I0 = np.moveaxis(evaluate_grid(map, theta, res), -1, 1)
+    assert np.allclose(I, I0, equal_nan=True)
+
+
+def test_render_timing(res=300, frames=100):
+    """Benchmark the renderer against pointwise evaluation."""
+    map = Map(5)
+    map.load_image('earth')
+    map.axis = [1, 1, 1] / np.sqrt(3)
+    theta = np.linspace(0, 360, frames)
+    tstart = time.time()
+    map.render(theta=theta, res=res)
+    t_render = time.time() - tstart
+    tstart = time.time()
+    evaluate_grid(map, theta, res)
+    t_eval = time.time() - tstart
+    print("Render time [Pointwise]: %.3f [%.3f]" % (t_render, t_eval))
+
+
+if __name__ == "__main__":
+    test_render()
+    test_render_spectral()
+    test_render_timing()
@@ -1,6 +1,7 @@
 """Test the rotation matrices."""
 import starry
 import numpy as np
+import time
 norm = 0.5 * np.sqrt(np.pi)
 
 
@@ -68,6 +69,68 @@ def test_rotation_multi():
     return run(multi=True)
 
 
+def test_rotation_high_degree():
+    """Rotations of high degree maps are orthogonal and compose."""
+    np.random.seed(0)
+    lmax = 30
+    map = starry.Map(lmax)
+    map[:, :] = np.random.randn(map.N)
+    y0 = np.array(map.y)
+    map.axis = [1, 2, 3]
+    map.rotate(37)
+    assert np.allclose(np.linalg.norm(map.y), np.linalg.norm(y0))
+    map.rotate(-37)
+    assert np.allclose(map.y, y0)
+
+    # A rotation about -z is the inverse of one about +z
+    map.axis = [0, 0, -1]
+    map.rotate(25)
+    map.axis = [0, 0, 1]
+    map.rotate(25)
+    assert np.allclose(map.y, y0)
+
+
+def test_rotation_axis_cache():
+    """Changing the coefficients or revisiting an axis is consistent."""
+    np.random.seed(1)
+    y1 = np.random.randn(16)
+    y2 = np.random.randn(16)
+    theta = np.linspace(0, 360, 7)
+
+    # Set the coefficients, then move the axis away and back
+    map1 = starry.Map(3)
+    map1.axis = [1, 2, 3]
+    map1[:, :] = y1
+    map1.axis = [0, 1, 0]
+    map1[:, :] = y2
+    map1.axis = [1, 2, 3]
+
+    # Same final state, set in one go
+    map2 = starry.Map(3)
+    map2[:, :] = y2
+    map2.axis = [1, 2, 3]
+    assert np.allclose(map1(theta=theta, x=0.3, y=0.1),
+                       map2(theta=theta, x=0.3, y=0.1))
+    assert np.allclose(map1.flux(theta=theta, xo=0.2, ro=0.3),
+                       map2.flux(theta=theta, xo=0.2, ro=0.3))
+
+
+def test_rotation_timing():
+    """Time the rotation of maps of increasing degree."""
+    for lmax in [5, 15, 30]:
+        map = starry.Map(lmax)
+        map[:, :] = 1
+        map.axis = [1, 2, 3]
+        theta = np.linspace(0, 360, 100)
+        tstart = time.time()
+        map(theta=theta, x=0.1, y=0.2)
+        t = (time.time() - tstart) / len(theta)
+        print("lmax = %d: %.1f us per rotation" % (lmax, 1e6 * t))
+
+
 if __name__ == "__main__":
     test_rotation_double()
     test_rotation_multi()
+    test_rotation_high_degree()
+    test_rotation_axis_cache()
+    test_rotation_timing()
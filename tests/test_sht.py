@@ -0,0 +1,81 @@
+"""Test the native spherical harmonic transform of images."""
+import starry
+from starry import Map
+import numpy as np
+import pytest
+
+
+def rotate_to_observer(map):
+    """Apply the same rotations as `load_image`."""
+    axis = map.axis
+    map.axis = [1, 0, 0]
+    map.rotate(90)
+    map.axis = [0, 0, 1]
+    map.rotate(180)
+    map.axis = [0, 1, 0]
+    map.rotate(90)
+    map.axis = axis
+
+
+def test_load_image_healpy():
+    """Compare to the `healpy`-based transform in `starry.maps`."""
+    pytest.importorskip("healpy")
+    lmax = 8
+    image = starry.maps.image2array('earth')
+    y = starry.maps.load_map(image, lmax=lmax)
+    map0 = Map(lmax)
+    map0[:, :] = y / y[0]
+    rotate_to_observer(map0)
+    map = Map(lmax)
+    map.load_image('earth')
+    assert np.allclose(map.y, map0.y, atol=1e-10)
+
+
+def test_load_healpix_healpy():
+    """Compare to the `healpy`-based transform in `starry.maps`."""
+    hp = pytest.importorskip("healpy")
+    lmax = 6
+    nside = 16
+    theta, phi = hp.pix2ang(nside, np.arange(hp.nside2npix(nside)))
+    image = 1 + 0.1 * np.sin(theta) ** 2 * np.cos(phi) + 0.3 * np.cos(theta)
+    y = starry.maps.load_map(image, lmax=lmax, healpix=True)
+    map0 = Map(lmax)
+    map0[:, :] = y / y[0]
+    rotate_to_observer(map0)
+    map = Map(lmax)
+    map.load_healpix(image)
+    assert np.allclose(map.y, map0.y, atol=1e-10)
+
+
+def test_load_healpix_constant():
+    """A uniform HEALPix map has no structure."""
+    nside = 8
+    map = Map(5)
+    map.load_healpix(np.ones(12 * nside ** 2))
+    y = np.zeros(map.N)
+    y[0] = 1
+    assert np.allclose(map.y, y, atol=1e-10)
+
+
+def test_load_image_spectral():
+    """Loading a stack of images is the same as loading each one."""
+    nwav = 3
+    lmax = 5
+    image = starry.maps.image2array('earth')
+    images = np.array([image, image ** 2, np.sqrt(image)])
+    map = Map(lmax, nwav=nwav)
+    map.load_image(images)
+    map0 = Map(lmax, nwav=nwav)
+    for n in range(nwav):
+        map0.load_image(images[n], nwav=n)
+    assert np.allclose(map.y, map0.y, atol=1e-10)
+    map1 = Map(lmax)
+    map1.load_image(images[1])
+    assert np.allclose(map.y[:, 1], map1.y, atol=1e-10)
+
+
+if __name__ == "__main__":
+    test_load_image_healpy()
+    test_load_healpix_healpy()
+    test_load_healpix_constant()
+    test_load_image_spectral()
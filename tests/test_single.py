@@ -0,0 +1,45 @@
+"""Test the single precision maps against double precision."""
+import starry
+import numpy as np
+import pytest
+
+
+def test_single_flux():
+    """Check the occultation flux of a single precision map."""
+    for lmax, tol in [(2, 1e-6), (5, 1e-6), (10, 1e-5)]:
+        np.random.seed(lmax)
+        map64 = starry.Map(lmax)
+        map32 = starry.Map(lmax, single=True)
+        y = np.random.randn((lmax + 1) ** 2) * 0.1
+        y[0] = 1
+        map64[:, :] = y
+        map32[:, :] = y
+        map64.axis = map32.axis = [1, 2, 3]
+        assert map32.precision == "single"
+        ro = np.linspace(0.01, 2, 10)
+        xo = np.linspace(-1.5, 1.5, 100)
+        for r in ro:
+            f64 = map64.flux(theta=30, xo=xo, yo=0.2, ro=r)
+            f32 = map32.flux(theta=30, xo=xo, yo=0.2, ro=r)
+            assert np.allclose(f32, f64, atol=tol * map64.flux())
+
+
+def test_single_limb_darkened():
+    """Check the flux of a single precision limb-darkened map."""
+    map64 = starry.Map(4)
+    map32 = starry.Map(4, single=True)
+    map64[:] = map32[:] = [0.4, 0.26, 0.1, 0.05]
+    xo = np.linspace(-1.5, 1.5, 100)
+    for ro in [0.01, 0.1, 0.5, 1.5]:
+        f64 = map64.flux(xo=xo, yo=0.3, ro=ro)
+        f32, grad32 = map32.flux(xo=xo, yo=0.3, ro=ro, gradient=True)
+        assert np.allclose(f32, f64, atol=1e-6)
+        assert np.all(np.isfinite(grad32["xo"]))
+
+
+def test_single_unsupported():
+    """Single precision is only available for monochromatic maps."""
+    with pytest.raises(ValueError):
+        starry.Map(2, nwav=3, single=True)
+    with pytest.raises(ValueError):
+        starry.Map(2, multi=True, single=True)
@@ -1,6 +1,7 @@
 """Test slice indexing of the map."""
 import starry
 import numpy as np
+import pytest
 
 
 def test_scalar():
@@ -84,6 +85,62 @@ def test_spectral():
     map.reset()
 
 
+def test_incremental():
+    """Single coefficient and batched updates match a full update."""
+    np.random.seed(0)
+    y = np.zeros(36)
+    y[:25] = np.random.randn(25)
+    y[0] = 1
+    y[2] = 0
+    map1 = starry.Map(5)
+    map1.axis = [1, 2, 3]
+    map1[1] = 0.4
+    for l in range(5):
+        for m in range(-l, l + 1):
+            map1[l, m] = y[l * l + l + m] + 1
+    for l in range(5):
+        for m in range(-l, l + 1):
+            map1[l, m] = y[l * l + l + m]
+    map2 = starry.Map(5)
+    map2.axis = [1, 2, 3]
+    with map2.batch():
+        for l in range(5):
+            for m in range(-l, l + 1):
+                map2[l, m] = y[l * l + l + m]
+        map2[1] = 0.4
+    map3 = starry.Map(5)
+    map3.axis = [1, 2, 3]
+    map3[:, :] = y
+    map3[1] = 0.4
+    for map in map1, map2:
+        assert np.allclose(map.p, map3.p)
+        assert np.allclose(map.g, map3.g)
+        assert np.allclose(map.flux(theta=30, xo=0.3, ro=0.1),
+                           map3.flux(theta=30, xo=0.3, ro=0.1))
+
+
+def test_batch_exception():
+    """A setter that throws inside a batch must not leave it open."""
+    map = starry.Map(3)
+    with pytest.raises(IndexError):
+        map.add_gaussian(lmax=5)
+    map[1, 0] = 0.5
+    map2 = starry.Map(3)
+    map2[1, 0] = 0.5
+    assert np.allclose(map.p, map2.p)
+    assert np.allclose(map.flux(xo=0.3, ro=0.1), map2.flux(xo=0.3, ro=0.1))
+    with pytest.raises(IndexError):
+        map.load_image(np.ones((10, 20)), lmax=5)
+    with pytest.raises(ZeroDivisionError):
+        with map.batch():
+            map[1, 0] = 0.3
+            1 / 0
+    map2[1, 0] = 0.3
+    assert np.allclose(map.p, map2.p)
+
+
 if __name__ == "__main__":
     test_scalar()
     test_spectral()
+    test_incremental()
+    test_batch_exception()
@@ -0,0 +1,101 @@
+"""Test the chunked light curve evaluation."""
+from starry.kepler import Primary, Secondary, System
+import numpy as np
+import pytest
+
+
+def get_system():
+    """Instantiate a simple star-planet system."""
+    star = Primary()
+    star[1] = 0.4
+    star[2] = 0.26
+    planet = Secondary(lmax=1)
+    planet[1, 0] = 0.5
+    planet.lambda0 = 270
+    planet.r = 0.0916
+    planet.L = 5e-3
+    planet.inc = 87
+    planet.a = 11.12799
+    planet.prot = 4.3
+    planet.porb = 4.3
+    planet.tref = 2.0
+    return System(star, planet), planet
+
+
+def test_stream():
+    """Compare `compute_stream` to a single call to `compute`."""
+    system, planet = get_system()
+    time = np.linspace(1, 5.3, 1000)
+    system.compute(time, gradient=True)
+    flux = np.array(system.lightcurve)
+    grad = dict((k, np.array(v)) for k, v in system.gradient.items())
+    x = np.array(planet.x)
+
+    # Write into a pre-allocated array
+    out = np.empty_like(time)
+    assert system.compute_stream(time, out, chunk_size=77) == len(time)
+    assert np.allclose(out, flux)
+
+    # Pass chunks from a generator to a callable sink
+    chunks = []
+
+    def sink(start, lightcurve, gradient=None, positions=None):
+        chunks.append((start, np.array(lightcurve),
+                       np.array(gradient["b.r"]),
+                       np.array(positions[0][0])))
+
+    def gen():
+        for i in range(0, len(time), 300):
+            yield time[i:i + 300]
+
+    system.compute_stream(gen(), sink, gradient=True, positions=True)
+    assert [c[0] for c in chunks] == [0, 300, 600, 900]
+    assert np.allclose(np.concatenate([c[1] for c in chunks]), flux)
+    assert np.allclose(np.concatenate([c[2] for c in chunks]), grad["b.r"])
+    assert np.allclose(np.concatenate([c[3] for c in chunks]), x)
+
+
+def test_stream_conversions():
+    """Time arrays that need a conversion to contiguous doubles."""
+    system, _ = get_system()
+    time = np.linspace(1, 5.3, 1000)
+    system.compute(time[::2])
+    flux = np.array(system.lightcurve)
+
+    # A strided slice
+    out = np.empty(500)
+    system.compute_stream(time[::2], out, chunk_size=77)
+    assert np.allclose(out, flux)
+
+    # Python lists from a generator
+    def gen():
+        for i in range(0, 1000, 200):
+            yield list(time[i:i + 200:2])
+
+    out = np.empty(500)
+    system.compute_stream(gen(), out)
+    assert np.allclose(out, flux)
+
+    # Integer times
+    itime = np.arange(1, 6)
+    system.compute(itime.astype(float))
+    out = np.empty(5)
+    system.compute_stream(itime, out)
+    assert np.allclose(out, system.lightcurve)
+
+
+def test_stream_array_sink():
+    """Gradients and positions need a callable sink."""
+    system, _ = get_system()
+    time = np.linspace(1, 5.3, 100)
+    out = np.empty_like(time)
+    with pytest.raises(ValueError):
+        system.compute_stream(time, out, gradient=True)
+    with pytest.raises(ValueError):
+        system.compute_stream(time, out, positions=True)
+
+
+if __name__ == "__main__":
+    test_stream()
+    test_stream_conversions()
+    test_stream_array_sink()